@@ -0,0 +1,234 @@
+// Host benchmark for sentence time stamps and the clock estimator
+//
+// First the driver: sentences of a recorded capture are injected a few
+// milliseconds apart, into two drivers at once with one sentence split across
+// the other's, and every queued sentence must carry its own first and last
+// byte stamps, the epochs the stamp of their first sentence.
+//
+// Then ClockEstimator against a simulated receiver: the UTC of the capture's
+// epochs, a local crystal off by DRIFT_PPB, an output delay and the wait for
+// the next Poll() as latency, with the application now and then too busy to
+// poll. The fitted local time of each fix must stay within a few
+// milliseconds of the truth, the closer the more often Poll() runs, and much
+// closer than the last arrival, across midnight and after a jump of the
+// receiver's time.
+//
+// Usage: clock_sync_benchmark [capture.txt]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+#define DRIFT_PPB 35000       // local crystal 35 ppm fast
+#define OUTPUT_DELAY_US 42000  // UTC second to the first byte leaving the module
+#define SETTLE_EPOCHS 32       // epochs before the error is counted
+#define DRIFT_TOLERANCE 10000  // ppb, 10 us over the second between two fixes
+#define GAP_MS 2               // between injected sentences
+
+// sentences of the capture, one string each
+static bool Load(const char *path, std::vector<std::string> *sentences) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f)) {
+        // the logger ran some sentences together on one line, take them apart
+        for (char *s = strchr(line, '$'); s;) {
+            char *next = strchr(s + 1, '$');
+            std::string sentence = next ? std::string(s, next - s) : std::string(s);
+            while (!sentence.empty() && (sentence.back() == '\r' || sentence.back() == '\n')) sentence.pop_back();
+            if (sentence.size() >= 7) sentences->push_back(sentence + "\r\n");
+            s = next;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+static void Inject(Adafruit_GPS &gps, const std::string &s) {
+    gps.Inject(s.data(), s.size());
+    gps.Poll();
+}
+
+struct Result {
+    double maxUs = 0, meanUs = 0;          // fitted local time of the fixes against the truth
+    double lastMaxUs = 0, lastMeanUs = 0;  // the same from the last arrival alone
+    gps_clock_t estimate = {};
+};
+
+// the capture's epochs through a simulated receiver and application
+static Result Simulate(const std::vector<uint32_t> &utc, uint32_t shiftMs, uint32_t pollUs, uint32_t busyPercent,
+                       uint32_t jumpAt) {
+    ClockEstimator clock;
+    Result r;
+    const uint64_t boot = 123456789;  // local time of UTC midnight before the capture
+    uint32_t counted = 0;
+    srand(1);
+    for (size_t i = 0; i < utc.size(); i++) {
+        const uint32_t utcMs = (utc[i] + shiftMs + (i >= jumpAt ? 2000 : 0)) % 86400000;
+        const uint64_t sinceMidnight = (uint64_t)(utc[i] + shiftMs) * 1000;  // the local clock does not jump
+        const uint64_t truth = boot + sinceMidnight + sinceMidnight * DRIFT_PPB / 1000000000 + OUTPUT_DELAY_US;
+        uint64_t arrival = truth + rand() % pollUs;
+        if ((uint32_t)(rand() % 100) < busyPercent) arrival += rand() % 50000;
+        clock.Add(utcMs, arrival);
+        uint64_t fitted;
+        if (i < SETTLE_EPOCHS || (i >= jumpAt && i < jumpAt + SETTLE_EPOCHS) || !clock.ToLocal(utcMs, &fitted))
+            continue;
+        // ToUtc() has to give the UTC back
+        uint64_t back;
+        clock.ToUtc(fitted, &back);
+        if (back != (uint64_t)utcMs * 1000) {
+            printf("ToUtc(ToLocal(%u ms)) is %llu us\n", (unsigned)utcMs, (unsigned long long)back);
+            exit(1);
+        }
+        const double error = fabs((double)(int64_t)(fitted - truth));
+        const double last = fabs((double)(int64_t)(arrival - truth));
+        r.maxUs = fmax(r.maxUs, error);
+        r.meanUs += error;
+        r.lastMaxUs = fmax(r.lastMaxUs, last);
+        r.lastMeanUs += last;
+        counted++;
+    }
+    r.meanUs /= counted;
+    r.lastMeanUs /= counted;
+    r.estimate = clock.Estimate();
+    return r;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+
+    std::vector<std::string> sentences;
+    if (!Load(path, &sentences)) {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+
+    // two drivers, A's third sentence split around one of B's
+    Adafruit_GPS a(nullptr), b(nullptr);
+    const std::string &split = sentences[2];
+    Inject(a, sentences[0]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(GAP_MS));
+    Inject(a, sentences[1]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(GAP_MS));
+    Inject(a, split.substr(0, 20));
+    std::this_thread::sleep_for(std::chrono::milliseconds(GAP_MS));
+    Inject(b, sentences[3]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(GAP_MS));
+    Inject(a, split.substr(20));
+    char line[MAXLINELENGTH];
+    nmea_stamp_t stampA[3], stampB;
+    for (nmea_stamp_t &stamp : stampA)
+        if (!a.TryPopSentence(line, sizeof(line), &stamp)) {
+            printf("A did not queue three sentences\n");
+            return 1;
+        }
+    if (!b.TryPopSentence(line, sizeof(line), &stampB)) {
+        printf("B did not queue its sentence\n");
+        return 1;
+    }
+    const uint64_t gapUs = GAP_MS * 1000;
+    if (!stampA[0].firstUs || stampA[0].firstUs != stampA[0].lastUs || stampA[1].firstUs < stampA[0].lastUs + gapUs ||
+        stampA[2].lastUs < stampB.firstUs + gapUs || stampA[2].firstUs + gapUs > stampB.firstUs ||
+        stampB.firstUs != stampB.lastUs) {
+        printf("sentence stamps are not the driver's own: A %llu..%llu %llu..%llu %llu..%llu, B %llu..%llu\n",
+               (unsigned long long)stampA[0].firstUs, (unsigned long long)stampA[0].lastUs,
+               (unsigned long long)stampA[1].firstUs, (unsigned long long)stampA[1].lastUs,
+               (unsigned long long)stampA[2].firstUs, (unsigned long long)stampA[2].lastUs,
+               (unsigned long long)stampB.firstUs, (unsigned long long)stampB.lastUs);
+        return 1;
+    }
+
+    // every epoch carries the stamp of its first sentence, fixes feed the estimator. The replay runs much faster
+    // than the capture's UTC, so the driver's fit keeps starting over; it has to match one fed with the same
+    Adafruit_GPS gps(nullptr);
+    ClockEstimator reference;
+    std::vector<uint32_t> utc;  // UTC of the capture's fixes, for the simulation
+    uint64_t epochFirstUs = 0;
+    uint32_t sequence = 0, stamped = 0;
+    for (const std::string &s : sentences) {
+        gps.Inject(s.data(), s.size());
+        gps.Poll();
+        nmea_stamp_t stamp;
+        size_t len;
+        while ((len = gps.TryPopSentence(line, sizeof(line), &stamp))) {
+            if (!strncmp(line + 3, "GGA", 3)) epochFirstUs = stamp.firstUs;
+            gps.Parse(line, len, &stamp);
+            gps_fix_t fix;
+            if (gps.FixSequence() == sequence || !gps.ReadFix(&fix)) continue;
+            sequence = gps.FixSequence();
+            if (fix.receivedUs != epochFirstUs) {
+                printf("epoch %u stamped %llu, its GGA was read at %llu\n", (unsigned)fix.timeMs,
+                       (unsigned long long)fix.receivedUs, (unsigned long long)epochFirstUs);
+                return 1;
+            }
+            stamped++;
+            if (!fix.fix) continue;
+            utc.push_back(fix.timeMs);
+            reference.Add(fix.timeMs, fix.receivedUs);
+        }
+    }
+    const gps_clock_t &driver = gps.ClockSync().Estimate(), &fed = reference.Estimate();
+    if (utc.size() < 100 || driver.samples != fed.samples || driver.resets != fed.resets ||
+        driver.offsetUs != fed.offsetUs) {
+        printf("the driver's estimator did not see the %zu fixes\n", utc.size());
+        return 1;
+    }
+    printf("%s: %u epochs stamped, %zu fixes\n\n", path, (unsigned)stamped, utc.size());
+
+    // the estimator against a known clock
+    struct {
+        const char *name;
+        uint32_t shiftMs;  // moves the capture in the day
+        uint32_t pollUs;   // Poll() interval
+        uint32_t busyPercent;
+        uint32_t jumpAt;
+        uint32_t toleranceUs;  // how far the fitted local time of a fix may be off
+    } kRuns[] = {
+        {"Poll() every 1 ms", 0, 1000, 0, UINT32_MAX, 1000},
+        {"Poll() every 5 ms", 0, 5000, 0, UINT32_MAX, 2000},
+        {"Poll() every 20 ms", 0, 20000, 0, UINT32_MAX, 6000},
+        {"every 5 ms, 10% busy", 0, 5000, 10, UINT32_MAX, 3000},
+        {"  across midnight", 86400000 - 600000 - utc[0], 5000, 10, UINT32_MAX, 3000},
+        {"  UTC jumps 2 s", 0, 5000, 10, (uint32_t)utc.size() / 2, 3000},
+    };
+    printf("%-22s %13s %13s %13s %9s %8s %7s\n", "", "fit max/mean", "last max/mean", "drift ppb", "jitter",
+           "latency", "resets");
+    for (const auto &run : kRuns) {
+        const Result r = Simulate(utc, run.shiftMs, run.pollUs, run.busyPercent, run.jumpAt);
+        printf("%-22s %6.0f/%-6.0f %6.0f/%-6.0f %6d/%-6d %6u us %5u us %7u\n", run.name, r.maxUs, r.meanUs,
+               r.lastMaxUs, r.lastMeanUs, (int)r.estimate.driftPpb, DRIFT_PPB, (unsigned)r.estimate.jitterUs,
+               (unsigned)r.estimate.latencyUs, (unsigned)r.estimate.resets);
+        const int32_t driftError = r.estimate.driftPpb - DRIFT_PPB;
+        if (r.maxUs > run.toleranceUs || r.meanUs > r.lastMeanUs / 2 || abs(driftError) > DRIFT_TOLERANCE ||
+            r.estimate.resets != (run.jumpAt == UINT32_MAX ? 0 : 1)) {
+            printf("%s: the fit is off\n", run.name);
+            return 1;
+        }
+    }
+
+    // cost per epoch, a fit every GPS_CLOCK_WINDOW of them
+    ClockEstimator clock;
+    const uint32_t rounds = 1000000;
+    uint64_t local = 1000000;
+    uint32_t fits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        local += 1000000 + rand() % 5000;
+        fits += clock.Add(i * 1000 % 86400000, local);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("\nAdd():  %.1f ns per epoch with %u fits, ClockEstimator is %zu bytes\n", seconds * 1e9 / rounds,
+           (unsigned)fits, sizeof(ClockEstimator));
+    return 0;
+}
@@ -0,0 +1,339 @@
+// Host benchmark for the EPO upload
+//
+// Reads an EPO file from disk through an EpoSource and uploads it to a
+// simulated module that decodes every $PMTK721 sentence back into a record,
+// checks its checksum, stores it and acknowledges it STORE_MS later. The
+// module loses an acknowledgement now and then and fails to store one record,
+// so both kinds of resend are taken. Fails unless the module ends up holding
+// exactly the records of the segments that were asked for, then reports the
+// characters and the modelled time a day and the whole file take at 100 kHz
+// I2C, and the cost of formatting a record.
+//
+// The same day is then uploaded through EPO_StartUpload() and Poll() while a
+// recorded NMEA capture is replayed, followed by AidTime() and AidPosition()
+// from its first fix, to show the capture is parsed in full meanwhile.
+//
+// Usage: epo_upload_benchmark [EPO.DAT] [capture.txt]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+#define TIMEOUT_MS 100     // acknowledgement timeout in the simulation
+#define RETRIES 2          // resends before a record fails
+#define STORE_MS 5         // time the module takes to store a record before it acknowledges, assumed
+#define US_PER_CHAR 90     // 100 kHz I2C, 8 bits and an ACK per character
+#define LOST_ACK_EVERY 37  // every so many records the acknowledgement is lost
+#define FAILED_RECORD 10   // this record is answered with flag 2 the first time
+#define DAY_SEGMENTS 4     // six hour segments in a day
+#define NOW_HOURS 30       // "now" for the upload, hours after the file starts
+#define NO_ACK -1
+
+// The file on disk, read a record at a time as it would be from an SD card
+class FileSource : public EpoSource {
+   public:
+    explicit FileSource(FILE *f) : mFile(f) {
+        fseek(mFile, 0, SEEK_END);
+        mSize = (size_t)ftell(mFile);
+    }
+    size_t Size() override { return mSize; }
+    bool Read(uint32_t offset, uint8_t *buf, size_t len) override {
+        mReads++;
+        return fseek(mFile, offset, SEEK_SET) == 0 && fread(buf, 1, len, mFile) == len;
+    }
+    unsigned long mReads = 0;
+
+   private:
+    FILE *mFile;
+    size_t mSize;
+};
+
+static uint8_t HexDigit(char c) { return c <= '9' ? c - '0' : c - 'A' + 10; }
+
+// $PMTK001,<cmd>,<flag>*hh
+static std::string AckFor(int cmd, int flag) {
+    char ack[32];
+    snprintf(ack, sizeof(ack), "$PMTK001,%d,%d", cmd, flag);
+    uint8_t cs = 0;
+    for (const char *p = ack + 1; *p; p++) cs ^= (uint8_t)*p;
+    snprintf(ack + strlen(ack), 8, "*%02X\r\n", cs);
+    return ack;
+}
+
+// The module side: decodes $PMTK721 back into records, placed by the GPS hour and PRN in word 0
+struct MockModule {
+    uint32_t fileHour;
+    std::vector<uint8_t> image;  // what the module holds, laid out like the file
+    unsigned received = 0, bad = 0;
+    bool loseAcks = true;
+    bool failedOnce = false;
+
+    MockModule(uint32_t hour, size_t size) : fileHour(hour), image(size, 0) {}
+
+    // the flag to acknowledge with, NO_ACK if the acknowledgement gets lost
+    int Take(const char *s, size_t len) {
+        received++;
+        std::string line(s, len);
+        uint8_t cs = 0;
+        size_t star = line.find('*');
+        for (size_t i = 1; i < star; i++) cs ^= (uint8_t)line[i];
+        if (strncmp(s, "$PMTK721,", 9) || star == std::string::npos || star + 5 != len ||
+            cs != (HexDigit(line[star + 1]) << 4 | HexDigit(line[star + 2])) || star != 9 + 2 + 18 * 9) {
+            bad++;
+            return 2;
+        }
+        uint8_t b[EPO_RECORD_BYTES];
+        for (int w = 0; w < 18; w++) {
+            const uint32_t v = (uint32_t)strtoul(line.c_str() + 12 + w * 9, NULL, 16);
+            for (int i = 0; i < 4; i++) b[w * 4 + i] = (uint8_t)(v >> (8 * i));
+        }
+        const uint32_t hour = b[0] | b[1] << 8 | b[2] << 16;
+        if (b[3] != (HexDigit(line[9]) << 4 | HexDigit(line[10])) || b[3] < 1 || b[3] > EPO_SATELLITES ||
+            hour < fileHour) {
+            bad++;
+            return 2;
+        }
+        const size_t at = ((hour - fileHour) / EPO_SEGMENT_HOURS * EPO_SATELLITES + b[3] - 1) * EPO_RECORD_BYTES;
+        if (at + EPO_RECORD_BYTES > image.size()) {
+            bad++;
+            return 2;
+        }
+        if (received == FAILED_RECORD && !failedOnce) {
+            failedOnce = true;
+            return 2;
+        }
+        memcpy(&image[at], b, sizeof(b));
+        return loseAcks && received % LOST_ACK_EVERY == 0 ? NO_ACK : 3;
+    }
+};
+
+struct Upload {
+    epo_upload_stats_t stats;
+    pmtk_result_t result;
+    double modelledSeconds;
+};
+
+// stop and wait against the module, on a simulated clock
+static Upload Simulate(EpoSource &source, MockModule &module, uint32_t gpsHour, uint16_t segments) {
+    EpoLoader loader(TIMEOUT_MS, RETRIES);
+    Upload u = {};
+    if (!loader.Begin(source, gpsHour, segments)) {
+        u.result = PMTK_RESULT_UNKNOWN;
+        return u;
+    }
+    uint64_t nowUs = 0;
+    while (loader.Active()) {
+        size_t len;
+        const char *s = loader.Due((uint32_t)(nowUs / 1000), &len);
+        if (!s) {  // waiting for a lost acknowledgement to time out
+            nowUs += 1000;
+            continue;
+        }
+        nowUs += len * US_PER_CHAR;
+        const int flag = module.Take(s, len);
+        if (flag == NO_ACK) continue;
+        const std::string ack = AckFor(721, flag);
+        nowUs += STORE_MS * 1000 + ack.size() * US_PER_CHAR;
+        loader.Acknowledge(ack.c_str());
+    }
+    u.stats = loader.Stats();
+    u.result = loader.Result();
+    u.modelledSeconds = nowUs / 1e6;
+    return u;
+}
+
+// the records of slots [first, end) that hold a satellite must be in the module, nothing else
+static bool SameRecords(const std::vector<uint8_t> &file, const std::vector<uint8_t> &image, size_t first,
+                        size_t end) {
+    for (size_t slot = 0; slot < file.size() / EPO_RECORD_BYTES; slot++) {
+        const uint8_t *want = &file[slot * EPO_RECORD_BYTES];
+        const uint8_t *got = &image[slot * EPO_RECORD_BYTES];
+        static const uint8_t kEmpty[EPO_RECORD_BYTES] = {0};
+        const bool uploaded = slot >= first && slot < end && want[3] != 0;
+        if (memcmp(got, uploaded ? want : kEmpty, EPO_RECORD_BYTES)) return false;
+    }
+    return true;
+}
+
+static void PrintDate(uint32_t gpsHour) {
+    // days since 1970-01-01 back to a civil date, Howard Hinnant's civil_from_days
+    const int64_t z = gpsHour / 24 + 3657 + 719468;
+    const int64_t era = z / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    printf("%04d-%02u-%02u %02u:00", (int)(yoe + era * 400 + (m <= 2)), m, d, gpsHour % 24);
+}
+
+struct Receiver {
+    Adafruit_GPS *gps;
+    size_t parsed = 0;  // capture sentences, not acknowledgements
+};
+
+static void ParseSentence(char *nmea, size_t len, void *ctx) {
+    Receiver *rx = (Receiver *)ctx;
+    if (strncmp(nmea, "$PMTK", 5)) rx->parsed++;
+    rx->gps->Parse(nmea, len);
+}
+
+int main(int argc, char **argv) {
+    const char *epoPath = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/archive/EPO.DAT";
+    const char *capturePath = argc > 2 ? argv[2] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+
+    FILE *f = fopen(epoPath, "rb");
+    if (!f) {
+        printf("Could not open %s\n", epoPath);
+        return 1;
+    }
+    FileSource source(f);
+    std::vector<uint8_t> file(source.Size());
+    if (file.size() < EPO_SEGMENT_BYTES || !source.Read(0, file.data(), file.size())) {
+        printf("%s is not an EPO file\n", epoPath);
+        return 1;
+    }
+    const uint32_t fileHour = file[0] | file[1] << 8 | file[2] << 16;
+    const uint32_t segments = (uint32_t)(file.size() / EPO_SEGMENT_BYTES);
+    const uint32_t now = fileHour + NOW_HOURS;
+    printf("%s: %u segments from ", epoPath, segments);
+    PrintDate(fileHour);
+    printf(" to ");
+    PrintDate(fileHour + segments * EPO_SEGMENT_HOURS);
+    printf(", now is ");
+    PrintDate(now);
+    printf("\n");
+
+    // a day from now, with lost acknowledgements and a record the module fails to store
+    MockModule module(fileHour, file.size());
+    const Upload day = Simulate(source, module, now, DAY_SEGMENTS);
+    const size_t first = (now - fileHour) / EPO_SEGMENT_HOURS * EPO_SATELLITES;
+    const size_t expectedResends = (day.stats.records + day.stats.resends) / LOST_ACK_EVERY + 1;
+    if (day.result != PMTK_RESULT_SUCCESS || module.bad ||
+        !SameRecords(file, module.image, first, first + DAY_SEGMENTS * EPO_SATELLITES) ||
+        day.stats.resends != expectedResends || day.stats.records + day.stats.skipped != day.stats.slots) {
+        printf("the day did not arrive intact: result %d, %u bad sentences, %u of %u records, %u resends\n",
+               (int)day.result, module.bad, (unsigned)day.stats.records, (unsigned)day.stats.slots,
+               (unsigned)day.stats.resends);
+        return 1;
+    }
+
+    // the whole file, no faults
+    MockModule whole(fileHour, file.size());
+    whole.loseAcks = false;
+    whole.failedOnce = true;
+    const unsigned long readsBefore = source.mReads;
+    const Upload all = Simulate(source, whole, 0, 0);
+    if (all.result != PMTK_RESULT_SUCCESS || !SameRecords(file, whole.image, 0, file.size() / EPO_RECORD_BYTES)) {
+        printf("the whole file did not arrive intact\n");
+        return 1;
+    }
+    const unsigned long reads = source.mReads - readsBefore;
+
+    // a module that does not take $PMTK721, and a file that has run out
+    EpoLoader loader(TIMEOUT_MS, RETRIES);
+    loader.Begin(source, now, 1);
+    size_t len;
+    loader.Due(0, &len);
+    loader.Acknowledge(AckFor(721, 1).c_str());
+    const bool rejected = loader.Result() == PMTK_RESULT_UNSUPPORTED && !loader.Active();
+    const bool stale = !loader.Begin(source, fileHour + segments * EPO_SEGMENT_HOURS, 0);
+    if (!rejected || !stale) {
+        printf("a rejected upload or an out of date file was not reported\n");
+        return 1;
+    }
+
+    // cost of formatting and accounting for a record
+    EpoMemorySource memory(file.data(), file.size());
+    const int rounds = 20;
+    unsigned long formatted = 0;
+    const std::string ack = AckFor(721, 3);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        loader.Begin(memory);
+        while (loader.Active())
+            if (loader.Due(0, &len)) {
+                formatted++;
+                loader.Acknowledge(ack.c_str());
+            }
+    }
+    const double formatSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("a day, 4 segments:  %u of %u slots hold a satellite, %u characters in %u sentences, %u resent\n",
+           (unsigned)day.stats.records, (unsigned)day.stats.slots, (unsigned)day.stats.bytes, module.received,
+           (unsigned)day.stats.resends);
+    printf("                    %.1f s at 100 kHz I2C with %d ms to store a record, %.1f s of it waiting for "
+           "lost acknowledgements\n",
+           day.modelledSeconds, STORE_MS, (double)(expectedResends - 1) * TIMEOUT_MS / 1000);
+    printf("the whole file:     %u records, %u characters, %.1f s, read from disk in %lu pieces of %d bytes\n",
+           (unsigned)all.stats.records, (unsigned)all.stats.bytes, all.modelledSeconds, reads, EPO_RECORD_BYTES);
+    printf("formatting:         %.0f ns per record, EpoLoader is %zu bytes\n", formatSeconds * 1e9 / formatted,
+           sizeof(EpoLoader));
+
+    // through the driver while a capture is replayed
+    std::vector<std::string> lines;
+    FILE *cf = fopen(capturePath, "r");
+    if (!cf) {
+        printf("Could not open %s\n", capturePath);
+        return 1;
+    }
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), cf))
+        if (line[0] == '$') lines.push_back(line);
+    fclose(cf);
+
+    Adafruit_GPS gps(nullptr);
+    Receiver rx{&gps};
+    if (!gps.EPO_StartUpload(memory, now, DAY_SEGMENTS)) {
+        printf("EPO_StartUpload() refused the file\n");
+        return 1;
+    }
+    uint32_t bytes = 0;
+    uint16_t timeTicket = 0, positionTicket = 0, acked = 0;
+    size_t uploadedBy = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        gps.Inject(lines[i].c_str(), lines[i].size());
+        gps.Poll(ParseSentence, &rx);
+        // the module: acknowledge every record and aiding command as it goes out
+        if (gps.EPO_UploadStats().bytes != bytes) {
+            bytes = gps.EPO_UploadStats().bytes;
+            gps.Inject(ack.c_str(), ack.size());
+        }
+        if (gps.EPO_UploadResult() == PMTK_RESULT_SUCCESS && !uploadedBy) uploadedBy = i + 1;
+        if (uploadedBy && !timeTicket && gps.mFix && gps.mYear) {
+            timeTicket = gps.AidTime(2000 + gps.mYear, gps.mMonth, gps.mDay, gps.mHour, gps.mMinute, gps.mSeconds);
+            positionTicket = gps.AidPosition(gps.mLatitude_fixed, gps.mLongitude_fixed, (int32_t)gps.Altitude(),
+                                             2000 + gps.mYear, gps.mMonth, gps.mDay, gps.mHour, gps.mMinute,
+                                             gps.mSeconds);
+        }
+        for (uint16_t t : {timeTicket, positionTicket})
+            if (t && t != acked && gps.CommandResult(t) == PMTK_RESULT_SENT) {
+                const std::string aid = AckFor(t == timeTicket ? 740 : 741, 3);
+                gps.Inject(aid.c_str(), aid.size());
+                acked = t;
+            }
+    }
+    for (int i = 0; i < 4; i++) gps.Poll(ParseSentence, &rx);
+    if (gps.EPO_UploadResult() != PMTK_RESULT_SUCCESS || gps.EPO_UploadStats().records != day.stats.records ||
+        gps.CommandResult(timeTicket) != PMTK_RESULT_SUCCESS ||
+        gps.CommandResult(positionTicket) != PMTK_RESULT_SUCCESS || rx.parsed != lines.size()) {
+        printf("through the driver: upload %d, time aid %d, position aid %d, %zu of %zu sentences parsed\n",
+               (int)gps.EPO_UploadResult(), (int)gps.CommandResult(timeTicket),
+               (int)gps.CommandResult(positionTicket), rx.parsed, lines.size());
+        return 1;
+    }
+    printf("through Poll():     %u records uploaded by sentence %zu, time and position aided, all %zu sentences "
+           "of %s parsed\n",
+           (unsigned)gps.EPO_UploadStats().records, uploadedBy, rx.parsed, capturePath);
+    return 0;
+}
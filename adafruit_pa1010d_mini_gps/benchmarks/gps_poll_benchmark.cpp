@@ -0,0 +1,103 @@
+// Host benchmark for the GPS receive path
+//
+// Replays a recorded NMEA capture through the receive ring and compares the
+// legacy one-character-per-call ReadData() loop against Poll(), which
+// assembles every pending sentence in a single call.
+//
+// Usage: gps_poll_benchmark [capture.txt] [repetitions]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <ctime>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+#define FEED_CHUNK (GPS_RX_RING_SIZE / 2)  // bytes injected per round, roughly one drain worth of data
+
+struct BenchResult {
+    uint64_t calls = 0;
+    uint64_t sentences = 0;
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+};
+
+static bool LoadFile(const char *path, std::vector<char> &out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    char chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) out.insert(out.end(), chunk, chunk + n);
+    fclose(f);
+    return true;
+}
+
+static void CountSentence(char *nmea, size_t len, void *ctx) {
+    (void)nmea;
+    (void)len;
+    (*(uint64_t *)ctx)++;
+}
+
+template <typename Drain>
+static BenchResult Run(const std::vector<char> &capture, int repetitions, Drain drain) {
+    Adafruit_GPS gps(nullptr);  // no bus, bytes only arrive through Inject()
+    BenchResult result;
+
+    auto wallStart = std::chrono::steady_clock::now();
+    std::clock_t cpuStart = std::clock();
+    for (int r = 0; r < repetitions; r++) {
+        size_t offset = 0;
+        while (offset < capture.size()) {
+            size_t len = min((size_t)FEED_CHUNK, capture.size() - offset);
+            offset += gps.Inject(&capture[offset], len);
+            drain(gps, result);
+        }
+    }
+    result.cpuSeconds = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return result;
+}
+
+static void Report(const char *name, const BenchResult &r) {
+    printf("%-10s %10llu calls %8llu sentences %12.0f calls/s %9.1f ns CPU/sentence\n", name,
+           (unsigned long long)r.calls, (unsigned long long)r.sentences, r.calls / r.wallSeconds,
+           r.sentences ? r.cpuSeconds * 1e9 / r.sentences : 0.0);
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 20;
+
+    std::vector<char> capture;
+    if (!LoadFile(path, capture) || capture.empty()) {
+        printf("Could not read %s\n", path);
+        return 1;
+    }
+    printf("%s: %zu bytes x %d\n", path, capture.size(), repetitions);
+
+    BenchResult before = Run(capture, repetitions, [](Adafruit_GPS &gps, BenchResult &r) {
+        while (gps.Available()) {
+            gps.ReadData();
+            r.calls++;
+            if (gps.NewNMEAreceived()) {
+                gps.LastNMEA();
+                r.sentences++;
+            }
+        }
+    });
+
+    BenchResult after = Run(capture, repetitions, [](Adafruit_GPS &gps, BenchResult &r) {
+        gps.Poll(CountSentence, &r.sentences);
+        r.calls++;
+    });
+
+    Report("ReadData", before);
+    Report("Poll", after);
+    return 0;
+}
@@ -0,0 +1,172 @@
+// Host benchmark for the LOCUS dump reader
+//
+// Logs every GGA with a fix of a recorded NMEA capture into a simulated
+// LOCUS flash (16 byte records, a 64 byte header per 4 KB sector, erased
+// 0xFF after the last record) and writes it out as the $PMTKLOX lines
+// PMTK_LOCUS_DUMP produces, with one line corrupted and one lost on the
+// way. The dump is fed through Inject() and Poll() after
+// LOCUS_StartDump(), and must come back as exactly the records of the
+// intact lines, with the damage counted, before the cost per character and
+// the size of the reader are reported.
+//
+// Usage: locus_dump_benchmark [capture.txt] [dump_out.txt]
+//
+// With dump_out.txt the generated dump is saved as well, for locus_decode.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+#define CORRUPT_LINE 5  // a character of this line is changed, its checksum fails
+#define LOST_LINE 9     // this line never arrives
+#define FEED_CHUNK 256  // bytes injected per Poll(), less than the receive ring
+
+// days since 1970-01-01 of a civil date, Howard Hinnant's days_from_civil
+static int64_t DaysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+static void AppendSentence(std::string &out, const char *body) {
+    uint8_t cs = 0;
+    for (const char *p = body; *p; p++) cs ^= (uint8_t)*p;
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", cs);
+    out += '$';
+    out += body;
+    out += tail;
+}
+
+struct Collected {
+    std::vector<locus_record_t> records;
+};
+
+static void Collect(const locus_record_t *r, void *ctx) { ((Collected *)ctx)->records.push_back(*r); }
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+    const char *dumpPath = argc > 2 ? argv[2] : NULL;
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+    // what the module would have logged: one record per GGA with a fix, once the date is known
+    Adafruit_GPS parser(nullptr);
+    std::vector<uint8_t> flash;
+    std::vector<locus_record_t> logged;
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f)) {
+        if (strlen(line) >= MAXLINELENGTH || !parser.Parse(line)) continue;
+        if (strcmp(parser.thisSentence, "GGA") || !parser.mFix || !parser.mYear) continue;
+        if (flash.size() % LOCUS_SECTOR_BYTES == 0)
+            for (int i = 0; i < LOCUS_HEADER_BYTES; i++) flash.push_back((uint8_t)(i * 37 + 1));  // not records
+        locus_record_t r;
+        r.utc = (uint32_t)(DaysFromCivil(2000 + parser.mYear, parser.mMonth, parser.mDay) * 86400 +
+                           parser.mHour * 3600 + parser.mMinute * 60 + parser.mSeconds);
+        r.fix = parser.mFixquality;
+        const float lat = parser.mLatitude_fixed / 1e7f, lon = parser.mLongitude_fixed / 1e7f;
+        r.heightM = (int16_t)lround(parser.Altitude());
+        r.latitude = (int32_t)lrintf(lat * 1e7f);
+        r.longitude = (int32_t)lrintf(lon * 1e7f);
+        uint8_t b[LOCUS_RECORD_BYTES];
+        memcpy(b, &r.utc, 4);
+        b[4] = r.fix;
+        memcpy(b + 5, &lat, 4);
+        memcpy(b + 9, &lon, 4);
+        memcpy(b + 13, &r.heightM, 2);
+        b[15] = 0;
+        for (int i = 0; i < LOCUS_RECORD_BYTES - 1; i++) b[15] ^= b[i];
+        flash.insert(flash.end(), b, b + LOCUS_RECORD_BYTES);
+        logged.push_back(r);
+    }
+    fclose(f);
+    if (logged.empty()) {
+        printf("No GGA with a fix and a date in %s\n", path);
+        return 1;
+    }
+    flash.resize((flash.size() + LOCUS_SECTOR_BYTES - 1) / LOCUS_SECTOR_BYTES * LOCUS_SECTOR_BYTES, 0xFF);
+
+    // the dump, and the records the reader should return from it
+    const size_t lines = flash.size() / LOCUS_LINE_BYTES + (flash.size() % LOCUS_LINE_BYTES != 0);
+    std::string dump;
+    std::vector<locus_record_t> expected;
+    char body[16 + LOCUS_LINE_BYTES * 9 / 4];
+    snprintf(body, sizeof(body), "PMTKLOX,0,%zu", lines);
+    AppendSentence(dump, body);
+    size_t next = 0;
+    for (size_t n = 0; n < lines; n++) {
+        const size_t start = n * LOCUS_LINE_BYTES, end = min(start + LOCUS_LINE_BYTES, flash.size());
+        int len = snprintf(body, sizeof(body), "PMTKLOX,1,%zu", n);
+        for (size_t i = start; i < end; i += 4)
+            len += snprintf(body + len, sizeof(body) - len, ",%02X%02X%02X%02X", flash[i], flash[i + 1],
+                            flash[i + 2], flash[i + 3]);
+        for (size_t i = start; i < end; i += LOCUS_RECORD_BYTES) {
+            if (i % LOCUS_SECTOR_BYTES < LOCUS_HEADER_BYTES || next >= logged.size()) continue;
+            if (n != CORRUPT_LINE && n != LOST_LINE) expected.push_back(logged[next]);
+            next++;
+        }
+        if (n == LOST_LINE) continue;
+        const size_t at = dump.size();
+        AppendSentence(dump, body);
+        if (n == CORRUPT_LINE) dump[at + 20] ^= 0x01;
+    }
+    AppendSentence(dump, "PMTKLOX,2");
+    AppendSentence(dump, "PMTK001,622,3");
+    if (dumpPath) {
+        FILE *out = fopen(dumpPath, "wb");
+        if (!out || fwrite(dump.data(), 1, dump.size(), out) != dump.size()) {
+            printf("Could not write %s\n", dumpPath);
+            return 1;
+        }
+        fclose(out);
+    }
+
+    // through the driver, as it would arrive
+    Adafruit_GPS gps(nullptr);
+    Collected collected;
+    uint16_t ticket = gps.LOCUS_StartDump(Collect, &collected);
+    gps.Poll();  // sends PMTK_LOCUS_DUMP
+    auto start = std::chrono::steady_clock::now();
+    for (size_t at = 0; at < dump.size();) {
+        at += gps.Inject(dump.data() + at, min((size_t)FEED_CHUNK, dump.size() - at));
+        gps.Poll();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    while (gps.TryPopSentence(line, sizeof(line))) {
+    }
+
+    const locus_dump_stats_t &s = gps.LOCUS_DumpStats();
+    bool same = collected.records.size() == expected.size();
+    for (size_t i = 0; same && i < expected.size(); i++)
+        same = !memcmp(&collected.records[i], &expected[i], sizeof(locus_record_t));
+    printf("%s: %zu fixes logged into %zu bytes of flash, dumped as %zu lines, %zu characters\n", path,
+           logged.size(), flash.size(), lines, dump.size());
+    printf("%u lines (%u missing, %u bad), %u records (%u bad, %u empty), dump %s, command %s\n", (unsigned)s.lines,
+           (unsigned)s.missingLines, (unsigned)s.badLines, (unsigned)s.records, (unsigned)s.badRecords,
+           (unsigned)s.emptyRecords, s.done ? "complete" : "cut short",
+           gps.CommandResult(ticket) == PMTK_RESULT_SUCCESS ? "acknowledged" : "not acknowledged");
+    if (!same || !s.done || s.missingLines != 2 || s.badLines != 1 || s.badRecords ||
+        gps.CommandResult(ticket) != PMTK_RESULT_SUCCESS) {
+        printf("the dump did not decode to the %zu records of the intact lines\n", expected.size());
+        return 1;
+    }
+    printf("all %zu records of the intact lines decoded, %.1f ns per character through Poll(), "
+           "LocusReader is %zu bytes\n",
+           expected.size(), seconds * 1e9 / dump.size(), sizeof(LocusReader));
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Host benchmark for Build()
+//
+// Replays the GGA and RMC sentences of a recorded NMEA capture through
+// Parse() and after each one builds GGA, RMC and GLL from the parsed
+// values three ways: with Build() into a buffer, with Build() streaming to
+// an NmeaSink that copies what it is given, and with the sprintf() formats
+// and checksum pass Build() used before. The streamed sentence must be the
+// same bytes as the buffered one, and the sprintf() one must agree field by
+// field, numbers to within one unit of their last digit or the float
+// precision sprintf() was given, before sentences built per second are
+// reported. Build() takes coordinates from
+// the fixed point values, which keep more digits than a float DDDMM.mmmm.
+//
+// Usage: nmea_build_benchmark [capture.txt] [repetitions]
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+static const char *kTypes[] = {"GGA", "RMC", "GLL"};
+#define TYPE_COUNT (sizeof(kTypes) / sizeof(kTypes[0]))
+
+// what Build() did before NmeaWriter, for the GPS sentences
+static char *SprintfBuild(Adafruit_GPS &g, char *nmea, const char *type) {
+    char *p = nmea + sprintf(nmea, "$GP%s,", type);
+    const double time = (double)g.mHour * 10000L + g.mMinute * 100L + g.mSeconds + g.mMilliseconds / 1000.;
+    if (!strcmp(type, "GGA"))
+        sprintf(p, "%09.2f,%09.4f,%c,%010.4f,%c,%d,%02d,%f,%f,M,%f,M,,", time, (double)g.Latitude(), g.mLat,
+                (double)g.Longitude(), g.mLon, g.mFixquality, g.mSatellites, (double)g.HDOP(), (double)g.Altitude(),
+                (double)g.Geoidheight());
+    else if (!strcmp(type, "GLL"))
+        sprintf(p, "%09.4f,%c,%010.4f,%c,%09.2f,A", (double)g.Latitude(), g.mLat, (double)g.Longitude(), g.mLon,
+                time);
+    else
+        sprintf(p, "%09.2f,A,%09.4f,%c,%010.4f,%c,%f,%f,%06d,%f,%c", time, (double)g.Latitude(), g.mLat,
+                (double)g.Longitude(), g.mLon, (double)g.Speed(), (double)g.Angle(),
+                g.mDay * 10000 + g.mMonth * 100 + g.mYear, (double)g.mMagvariation, g.mMag);
+    char cs = 0;
+    for (size_t i = 1; nmea[i]; i++) cs ^= nmea[i];
+    sprintf(nmea + strlen(nmea), "*%02X\r\n", cs);
+    return nmea;
+}
+
+// gathers a streamed sentence, as a transmit ring would
+class CopySink : public NmeaSink {
+   public:
+    bool Write(const char *data, size_t len) override {
+        if (mLen + len >= sizeof(mBuf)) return false;
+        memcpy(mBuf + mLen, data, len);
+        mLen += len;
+        return true;
+    }
+    char mBuf[MAXLINELENGTH * 2];
+    size_t mLen = 0;
+};
+
+// same fields, numbers within one unit of their last digit or of float precision
+static bool SameSentence(const char *a, const char *b) {
+    while (*a && *b) {
+        size_t la = strcspn(a, ",*\r"), lb = strcspn(b, ",*\r");
+        if (la != lb || strncmp(a, b, la)) {
+            const char *dot = (const char *)memchr(a, '.', la);
+            if (!dot) return false;
+            const double va = strtod(a, NULL);
+            const double unit = fmax(pow(10, -(double)(a + la - dot - 1)), fabs(va) * 2 * FLT_EPSILON);
+            if (fabs(va - strtod(b, NULL)) > unit * 1.01) return false;
+        }
+        a += la;
+        b += lb;
+        if (*a != *b) return false;
+        if (*a == '*' || *a == '\r') return true;  // the checksums differ with the digits
+        if (*a) a++, b++;
+    }
+    return *a == *b;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 20;
+
+    std::vector<std::string> sentences;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f))
+        if (strlen(line) > 7 && (!strncmp(line + 3, "GGA", 3) || !strncmp(line + 3, "RMC", 3)))
+            sentences.push_back(line);
+    fclose(f);
+    if (sentences.empty()) {
+        printf("No GGA or RMC sentences in %s\n", path);
+        return 1;
+    }
+
+    Adafruit_GPS gps(nullptr);
+    char buff[MAXLINELENGTH * 2], built[MAXLINELENGTH], reference[MAXLINELENGTH * 2];
+    double writerTime[TYPE_COUNT] = {0}, sinkTime[TYPE_COUNT] = {0}, sprintfTime[TYPE_COUNT] = {0};
+    CopySink sink;
+    unsigned long long count = 0, lengths = 0;
+    for (int r = 0; r < repetitions; r++) {
+        for (const std::string &s : sentences) {
+            memcpy(buff, s.c_str(), s.size() + 1);
+            gps.Parse(buff);
+            count++;
+            for (size_t t = 0; t < TYPE_COUNT; t++) {
+                auto start = std::chrono::steady_clock::now();
+                size_t len = gps.Build(built, sizeof(built), "GP", kTypes[t]);
+                auto mid = std::chrono::steady_clock::now();
+                sink.mLen = 0;
+                size_t streamed = gps.Build(sink, "GP", kTypes[t]);
+                auto streamEnd = std::chrono::steady_clock::now();
+                SprintfBuild(gps, reference, kTypes[t]);
+                auto end = std::chrono::steady_clock::now();
+                writerTime[t] += std::chrono::duration<double>(mid - start).count();
+                sinkTime[t] += std::chrono::duration<double>(streamEnd - mid).count();
+                sprintfTime[t] += std::chrono::duration<double>(end - streamEnd).count();
+                lengths += len;
+                if (r > 0) continue;
+                if (len == 0 || !SameSentence(built, reference)) {
+                    printf("Build() and sprintf() disagree:\n  %s  %s", built, reference);
+                    return 1;
+                }
+                if (streamed != len || sink.mLen != len || memcmp(sink.mBuf, built, len)) {
+                    printf("Build() to a sink differs:\n  %s  %.*s", built, (int)sink.mLen, sink.mBuf);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("%s: %zu GGA/RMC sentences x %d, all built sentences agree, %.1f characters on average\n", path,
+           sentences.size(), repetitions, (double)lengths / (count * TYPE_COUNT));
+    printf("%-5s %18s %18s %18s\n", "", "Build() /s", "Build(sink) /s", "sprintf() /s");
+    for (size_t t = 0; t < TYPE_COUNT; t++)
+        printf("%-5s %18.0f %18.0f %18.0f\n", kTypes[t], count / writerTime[t], count / sinkTime[t],
+               count / sprintfTime[t]);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Host benchmark for the sentence framing done by Adafruit_GPS::Check()
+//
+// Verifies the checksum and splits the fields of every sentence in the
+// recorded NMEA captures two ways: the previous byte at a time code (find
+// the end, walk back to the '*', XOR forward, strchr() the first comma and
+// Split() the fields) and the single pass NmeaFields::Scan(). Both must agree
+// on every sentence before the timings are reported.
+//
+// Usage: nmea_checksum_benchmark [capture.txt ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+#define REPETITIONS 50
+
+static const char *kDefaultCaptures[] = {
+    GPS_TOOLS_DIR "/nmea_241126_133042.txt",
+    GPS_TOOLS_DIR "/archive/nmea_241125_223541.txt",
+    GPS_TOOLS_DIR "/archive/nmea_data.txt",
+    GPS_TOOLS_DIR "/archive/nmea_log.txt",
+};
+
+static bool LoadLines(const char *path, std::vector<std::string> &out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '$' || line[0] == '!') out.push_back(line);
+    }
+    fclose(f);
+    return true;
+}
+
+// the framing Check() and Parse() did before Scan(), byte at a time in several passes
+static uint8_t ReferenceFrame(const char *nmea, NmeaFields &fields, const char **star) {
+    const char *ast = nmea;
+    while (*ast) ast++;
+    while (*ast != '*' && ast > nmea) ast--;
+    uint8_t sum = 0;
+    for (const char *p1 = nmea + 1; p1 < ast; p1++) sum ^= *p1;
+    *star = *ast == '*' ? ast : NULL;
+    const char *p = strchr(nmea, ',');
+    fields.Split(p ? p + 1 : "");
+    return sum;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::string> lines;
+    size_t bytes = 0;
+    int files = argc > 1 ? argc - 1 : (int)(sizeof(kDefaultCaptures) / sizeof(kDefaultCaptures[0]));
+    for (int i = 0; i < files; i++) {
+        const char *path = argc > 1 ? argv[i + 1] : kDefaultCaptures[i];
+        if (!LoadLines(path, lines)) printf("Could not read %s\n", path);
+    }
+    if (lines.empty()) return 1;
+    for (const std::string &line : lines) bytes += line.size();
+
+    // sentences are copied into a buffer like the one Poll() hands out, so Scan() sees the same alignment; heap
+    // buffers of the exact size let ASan catch a read past the NUL
+    std::vector<std::vector<char>> buffers;
+    for (const std::string &line : lines) buffers.emplace_back(line.c_str(), line.c_str() + line.size() + 1);
+
+    NmeaFields reference, scanned;
+    for (const std::vector<char> &b : buffers) {
+        const char *star;
+        uint8_t sum = ReferenceFrame(b.data(), reference, &star);
+        nmea_scan_t scan;
+        scanned.Scan(b.data(), b.size() - 1, &scan);
+        bool same = scan.star == star && (!star || scan.sum == sum) && scanned.Count() == reference.Count();
+        for (uint8_t i = 0; same && i < reference.Count(); i++)
+            same = scanned[i].len == reference[i].len && !memcmp(scanned[i].str, reference[i].str, reference[i].len);
+        if (!same) {
+            printf("Scan() disagrees on %s\n", b.data());
+            return 1;
+        }
+    }
+
+    volatile uint32_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPETITIONS; r++) {
+        for (const std::vector<char> &b : buffers) {
+            const char *star;
+            sink += ReferenceFrame(b.data(), reference, &star) + reference.Count();
+        }
+    }
+    double before = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPETITIONS; r++) {
+        for (const std::vector<char> &b : buffers) {
+            nmea_scan_t scan;
+            sink += scanned.Scan(b.data(), b.size() - 1, &scan) + scan.sum;
+        }
+    }
+    double after = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double total = (double)lines.size() * REPETITIONS;
+    printf("%zu sentences, %zu bytes x %d, results identical\n", lines.size(), bytes, REPETITIONS);
+    printf("%-10s %8.1f ns/sentence %8.1f MB/s\n", "byte-wise", before * 1e9 / total, bytes * REPETITIONS / before / 1e6);
+    printf("%-10s %8.1f ns/sentence %8.1f MB/s\n", "Scan()", after * 1e9 / total, bytes * REPETITIONS / after / 1e6);
+    return 0;
+}
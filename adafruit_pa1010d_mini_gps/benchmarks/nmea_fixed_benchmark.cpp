@@ -0,0 +1,103 @@
+// Host benchmark for the NMEA_FIXED_POINT build
+//
+// Parses only the GGA, RMC, GLL and GSA sentences of a recorded NMEA capture
+// and reports CPU cycles per sentence for each type. The same source is built
+// twice, nmea_fixed_benchmark_float against the default library and
+// nmea_fixed_benchmark_fixed against a copy built with NMEA_FIXED_POINT, so
+// the two outputs can be compared side by side.
+//
+// Usage: nmea_fixed_benchmark_float|fixed [capture.txt] [repetitions]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT "cycles"
+static inline uint64_t Cycles() { return __rdtsc(); }
+#else
+#define CYCLE_UNIT "ns"
+static inline uint64_t Cycles() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+static const char *kTypes[] = {"GGA", "RMC", "GLL", "GSA"};
+#define TYPE_COUNT (sizeof(kTypes) / sizeof(kTypes[0]))
+
+struct Sentence {
+    std::string text;
+    size_t type;
+};
+
+static bool LoadSentences(const char *path, std::vector<Sentence> &out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (strlen(line) < 7) continue;
+        for (size_t t = 0; t < TYPE_COUNT; t++)
+            if (!strncmp(line + 3, kTypes[t], 3)) out.push_back({line, t});
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 50;
+
+    std::vector<Sentence> sentences;
+    if (!LoadSentences(path, sentences) || sentences.empty()) {
+        printf("Could not read GGA/RMC/GLL/GSA sentences from %s\n", path);
+        return 1;
+    }
+
+    Adafruit_GPS gps(nullptr);
+    char buff[MAXLINELENGTH * 2];
+    uint64_t cycles[TYPE_COUNT] = {0};
+    uint64_t count[TYPE_COUNT] = {0};
+    uint64_t parsed = 0;
+
+    for (int r = 0; r < repetitions; r++) {
+        for (const Sentence &s : sentences) {
+            memcpy(buff, s.text.c_str(), s.text.size() + 1);
+            uint64_t start = Cycles();
+            bool ok = gps.Parse(buff);
+            cycles[s.type] += Cycles() - start;
+            count[s.type]++;
+            if (ok) parsed++;
+        }
+    }
+
+#ifdef NMEA_FIXED_POINT
+    const char *mode = "fixed";
+#else
+    const char *mode = "float";
+#endif
+    printf("%s: %zu sentences x %d, %llu parsed, %s build\n", path, sentences.size(), repetitions,
+           (unsigned long long)parsed, mode);
+    uint64_t totalCycles = 0, totalCount = 0;
+    for (size_t t = 0; t < TYPE_COUNT; t++) {
+        if (!count[t]) continue;
+        printf("%-6s %-4s %9llu sentences %8.1f %s/sentence\n", mode, kTypes[t], (unsigned long long)count[t],
+               (double)cycles[t] / count[t], CYCLE_UNIT);
+        totalCycles += cycles[t];
+        totalCount += count[t];
+    }
+    printf("%-6s all  %9llu sentences %8.1f %s/sentence\n", mode, (unsigned long long)totalCount,
+           (double)totalCycles / totalCount, CYCLE_UNIT);
+    return 0;
+}
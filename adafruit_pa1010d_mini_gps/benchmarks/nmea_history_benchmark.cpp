@@ -0,0 +1,81 @@
+// Host benchmark for the data value history in nmea_history_t
+//
+// Appends the same stream of values to a history two ways: the previous
+// shift-everything-down-by-one update and the circular Push(), then reads
+// the history back for plotting with CopyOut(). Both histories must hold
+// the same values oldest first before the timings are reported.
+//
+// Usage: nmea_history_benchmark [appends]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <vector>
+
+#define DEFAULT_APPENDS 2000000
+#define COPY_REPETITIONS 100000
+
+static const unsigned kSizes[] = {10, 64, 192, 1024};
+
+// the update NewDataValue() did before the history became circular
+static void ShiftAppend(int16_t *data, unsigned n, int16_t v) {
+    for (unsigned i = 0; i < n - 1; i++) data[i] = data[i + 1];
+    data[n - 1] = v;
+}
+
+int main(int argc, char **argv) {
+    unsigned appends = argc > 1 ? (unsigned)atoi(argv[1]) : DEFAULT_APPENDS;
+    if (appends == 0) return 1;
+
+    // a slowly wandering value, like a smoothed reading scaled into an int16
+    std::vector<int16_t> values(appends);
+    uint32_t seed = 12345;
+    int16_t v = 0;
+    for (unsigned i = 0; i < appends; i++) {
+        seed = seed * 1664525 + 1013904223;
+        v += (int16_t)((seed >> 28) & 7) - 3;
+        values[i] = v;
+    }
+
+    printf("%u appends per history size\n", appends);
+    printf("%6s %14s %14s %14s\n", "n", "shift ns/add", "Push() ns/add", "CopyOut() ns");
+    volatile int32_t sink = 0;
+    for (unsigned n : kSizes) {
+        std::vector<int16_t> shifted(n, 0), ring(n, 0), out(n);
+        nmea_history_t hist;
+        hist.data = ring.data();
+        hist.n = n;
+
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < appends; i++) ShiftAppend(shifted.data(), n, values[i]);
+        double shift = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink += shifted[n / 2];
+
+        start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < appends; i++) hist.Push(values[i]);
+        double push = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        unsigned i = 0;
+        for (int16_t h : hist) {
+            if (h != shifted[i++]) {
+                printf("histories differ at n = %u, element %u\n", n, i - 1);
+                return 1;
+            }
+        }
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < COPY_REPETITIONS; r++) {
+            sink += hist.CopyOut(out.data(), n);
+            hist.head = (hist.head + 1) % n;  // move the split point so both block copies get exercised
+        }
+        double copy = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        sink += out[0];
+
+        printf("%6u %14.2f %14.2f %14.1f\n", n, shift * 1e9 / appends, push * 1e9 / appends,
+               copy * 1e9 / COPY_REPETITIONS);
+    }
+    return 0;
+}
@@ -0,0 +1,385 @@
+// Host benchmark for the NMEA output controller
+//
+// Replays a recorded NMEA capture through a simulated module that sends only
+// the sentences and at the update period the driver last asked for, and
+// acknowledges every command. Each second of the capture is one fix cycle;
+// faster rates repeat it with the time stamps moved on, slower ones skip
+// cycles, and GLL is made up from GGA as the capture has none.
+//
+// First the PMTK314 commands are checked against the fixed ones in
+// Adafruit_PMTK.hpp, then the bytes per second of each Subscribe() at 1 Hz are
+// measured against the module out of the box and against the estimate. Last
+// the speed in RMC is rewritten to stand, walk, drive and stand again, and
+// the rate policy must follow it with PMTK220 and the baud rate, faster at
+// once and slower after its hold, and stay within a byte budget when given
+// one, without taking a ticket of the application's command queue.
+//
+// Usage: nmea_output_benchmark [capture.txt]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+#define TOLERANCE 0.15  // how far a measured rate may be from the estimate
+#define BUDGET 150      // bytes per second for the budget run
+
+typedef std::vector<std::string> Cycle;  // the sentences of one second, VTG last
+
+// "*hh" and CR LF after the body
+static std::string Seal(const std::string &body) {
+    uint8_t cs = 0;
+    for (size_t i = 1; i < body.size(); i++) cs ^= (uint8_t)body[i];
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", cs);
+    return body + tail;
+}
+
+static std::string Body(const std::string &s) { return s.substr(0, s.find('*')); }
+
+static std::string Field(const std::string &s, int index) {
+    const std::string body = Body(s);
+    size_t start = 0;
+    for (int i = 0; i < index; i++) start = body.find(',', start) + 1;
+    return body.substr(start, body.find(',', start) - start);
+}
+
+static std::string SetField(const std::string &s, int index, const std::string &value) {
+    std::string body = Body(s);
+    size_t start = 0;
+    for (int i = 0; i < index; i++) start = body.find(',', start) + 1;
+    size_t end = body.find(',', start);
+    body.replace(start, (end == std::string::npos ? body.size() : end) - start, value);
+    return Seal(body);
+}
+
+// hhmmss.sss moved offsetMs into the second
+static std::string Retime(const std::string &time, uint16_t offsetMs) {
+    char ms[6];  // room for any uint16_t
+    snprintf(ms, sizeof(ms), "%03u", offsetMs);
+    return time.substr(0, 7) + ms;
+}
+
+static bool Is(const std::string &s, const char *type) { return s.compare(3, 3, type) == 0; }
+
+// The module side: turns a capture cycle into the sentences of one fix for its current settings
+struct Module {
+    uint8_t sentences = GPS_NMEA_GGA | GPS_NMEA_GSA | GPS_NMEA_RMC | GPS_NMEA_VTG | GPS_NMEA_GSV;  // out of the box
+    uint8_t gsvEvery = 5;
+    uint16_t periodMs = 1000;
+    uint32_t fixes = 0;
+    Cycle gsv;  // last GSV group seen, sent again when GSV is due more often than the capture has it
+
+    void Fix(const Cycle &cycle, uint16_t offsetMs, const char *knots, Cycle *out) {
+        Cycle group;
+        for (const std::string &s : cycle)
+            if (Is(s, "GSV")) group.push_back(s);
+        if (!group.empty()) gsv = group;
+        for (const std::string &s : cycle) {
+            if (Is(s, "GGA")) {
+                const std::string gga = SetField(s, 1, Retime(Field(s, 1), offsetMs));
+                if (sentences & GPS_NMEA_GGA) out->push_back(gga);
+                if (sentences & GPS_NMEA_GLL) {
+                    std::string gll = "$GNGLL";
+                    for (int i : {2, 3, 4, 5, 1}) gll += "," + Field(gga, i);
+                    out->push_back(Seal(gll + ",A,D"));
+                }
+            } else if (Is(s, "GSA")) {
+                if (sentences & GPS_NMEA_GSA) out->push_back(Seal(Body(s)));
+            } else if (Is(s, "RMC")) {
+                if ((sentences & GPS_NMEA_GSV) && fixes % gsvEvery == 0)
+                    for (const std::string &g : gsv) out->push_back(Seal(Body(g)));
+                std::string rmc = SetField(s, 1, Retime(Field(s, 1), offsetMs));
+                if (knots) rmc = SetField(rmc, 7, knots);
+                if (sentences & GPS_NMEA_RMC) out->push_back(rmc);
+            } else if (Is(s, "VTG")) {
+                if (sentences & GPS_NMEA_VTG) out->push_back(Seal(Body(s)));
+            }
+        }
+        fixes++;
+    }
+};
+
+static void ParseSentence(char *nmea, size_t len, void *ctx) { ((Adafruit_GPS *)ctx)->Parse(nmea, len); }
+
+// Feed the sentences of a fix, then answer the commands the driver sends meanwhile and take up what it asked for
+static void Deliver(Adafruit_GPS &gps, Module &module, const Cycle &fix, bool followDriver) {
+    for (const std::string &s : fix) {
+        gps.Inject(s.c_str(), s.size());
+        gps.Poll(ParseSentence, &gps);
+    }
+    for (int i = 0; i < GPS_PMTK_QUEUE_SLOTS && gps.CommandsPending(); i++) {
+        for (const char *id : {"314", "220", "251"}) {
+            const std::string ack = Seal(std::string("$PMTK001,") + id + ",3");
+            gps.Inject(ack.c_str(), ack.size());
+        }
+        gps.Poll(ParseSentence, &gps);
+    }
+    if (!followDriver) return;
+    const gps_output_stats_t &asked = gps.OutputStats();
+    if (asked.sentences) module.sentences = asked.sentences;
+    module.gsvEvery = asked.gsvEvery;
+    module.periodMs = asked.periodMs;
+}
+
+static size_t Bytes(const Cycle &fix) {
+    size_t n = 0;
+    for (const std::string &s : fix) n += s.size();
+    return n;
+}
+
+struct Phase {
+    const char *name;
+    const char *knots;  // RMC speed over ground written into the capture
+    size_t seconds;
+    uint16_t periodMs;  // what kGpsRatePolicyDefault should settle on
+};
+
+static const Phase kPhases[] = {
+    {"standing", "0.10", 600, 5000},
+    {"walking", "3.00", 300, 1000},
+    {"driving", "40.00", 300, 200},
+    {"standing", "0.10", 0, 5000},  // the rest of the capture
+};
+
+struct PhaseResult {
+    size_t bytes = 0;
+    size_t seconds = 0;
+    uint16_t periodMs = 0;    // settled on at the end of the phase
+    uint32_t baud = 0;        // asked for at the end of the phase
+    uint32_t estimated = 0;   // OutputStats() at the end of the phase
+    uint32_t measured = 0;    // the driver's own count, averaged over the settled phase
+    uint32_t fastestMs = 0;   // shortest period seen during the phase
+    uint32_t lagEpochs = 0;   // epochs published from the start of the phase until its period was taken
+};
+
+// the capture with the speed profile of kPhases, through a driver following policy
+static bool RunPolicy(const std::vector<Cycle> &cycles, uint8_t wants, const gps_rate_policy_t &policy,
+                      PhaseResult *results, uint32_t *changes) {
+    Adafruit_GPS gps(nullptr);
+    Module module;
+    gps.SetRatePolicy(&policy);
+    gps.Subscribe(wants);
+    Deliver(gps, module, Cycle(), true);
+
+    size_t c = 0;
+    for (size_t p = 0; p < sizeof(kPhases) / sizeof(kPhases[0]); p++) {
+        const Phase &phase = kPhases[p];
+        const size_t end = phase.seconds ? min(c + phase.seconds, cycles.size()) : cycles.size();
+        PhaseResult &r = results[p];
+        r.seconds = end - c;
+        r.fastestMs = UINT32_MAX;
+        const uint32_t firstEpoch = gps.FixSequence();
+        uint32_t samples = 0, settledEpochs = 0;
+        uint64_t measuredSum = 0;
+        bool settled = false;
+        for (; c < end; c++) {
+            if (c % max(module.periodMs / 1000, 1) != 0) continue;
+            for (uint16_t offset = 0; offset < 1000; offset += module.periodMs) {
+                Cycle fix;
+                module.Fix(cycles[c], offset, phase.knots, &fix);
+                r.bytes += Bytes(fix);
+                Deliver(gps, module, fix, true);
+                r.fastestMs = min(r.fastestMs, (uint32_t)module.periodMs);
+                if (!settled && module.periodMs == phase.periodMs) {
+                    settled = true;
+                    r.lagEpochs = gps.FixSequence() - firstEpoch;
+                } else if (settled && ++settledEpochs * phase.periodMs > 2 * GPS_OUTPUT_WINDOW_MS) {
+                    measuredSum += gps.OutputStats().measuredBps;  // once the windows only hold this rate
+                    samples++;
+                }
+                if (module.periodMs > 1000) break;
+            }
+        }
+        const gps_output_stats_t &stats = gps.OutputStats();
+        r.periodMs = stats.periodMs;
+        r.baud = stats.baud;
+        r.estimated = stats.estimatedBps;
+        r.measured = samples ? (uint32_t)(measuredSum / samples) : stats.measuredBps;
+    }
+    *changes = gps.OutputStats().rateChanges;
+    // Parse() queued the rate changes on a queue of its own, the application's only ever gave out Subscribe()'s ticket
+    const uint16_t next = gps.QueueCommand(PMTK_Q_RELEASE);
+    if (next != 2) {
+        printf("the rate changes went through the application's command queue, next ticket %u\n", (unsigned)next);
+        return false;
+    }
+    return true;
+}
+
+static bool Near(double measured, double estimated) {
+    return measured >= estimated * (1 - TOLERANCE) && measured <= estimated * (1 + TOLERANCE);
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+
+    std::vector<Cycle> cycles(1);
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f)) {
+        // the logger ran some sentences together on one line, take them apart
+        for (char *s = strchr(line, '$'); s;) {
+            char *next = strchr(s + 1, '$');
+            std::string sentence = next ? std::string(s, next - s) : std::string(s);
+            if (sentence.size() >= 7) cycles.back().push_back(sentence);
+            if (sentence.size() >= 7 && Is(sentence, "VTG")) cycles.emplace_back();
+            s = next;
+        }
+    }
+    fclose(f);
+    cycles.pop_back();
+
+    // PMTK314 as the fixed commands have it
+    struct {
+        uint8_t sentences;
+        const char *command;
+    } kFixed[] = {
+        {GPS_NMEA_RMC, PMTK_SET_NMEA_OUTPUT_RMCONLY},
+        {GPS_NMEA_RMC | GPS_NMEA_GGA, PMTK_SET_NMEA_OUTPUT_RMCGGA},
+        {GPS_NMEA_RMC | GPS_NMEA_GGA | GPS_NMEA_GSA, PMTK_SET_NMEA_OUTPUT_RMCGGAGSA},
+        {0x3F, PMTK_SET_NMEA_OUTPUT_ALLDATA},
+        {0, PMTK_SET_NMEA_OUTPUT_OFF},
+    };
+    for (const auto &fixed : kFixed) {
+        char cmd[GPS_PMTK_COMMAND_SIZE];
+        if (!OutputController::Pmtk314(cmd, sizeof(cmd), fixed.sentences, 1) || strcmp(cmd, fixed.command)) {
+            printf("PMTK314 for 0x%02X is %s, not %s\n", fixed.sentences, cmd, fixed.command);
+            return 1;
+        }
+    }
+
+    // each subscription at 1 Hz against the module out of the box
+    struct {
+        const char *name;
+        uint8_t wants;
+        uint8_t sentences;
+    } kProfiles[] = {
+        {"out of the box", 0, 0},
+        {"all data", 0x3F, 0x3F},
+        {"position", GPS_WANT_POSITION, GPS_NMEA_RMC},
+        {"position, altitude", GPS_WANT_POSITION | GPS_WANT_ALTITUDE, GPS_NMEA_GGA},
+        {"position, velocity, date", GPS_WANT_POSITION | GPS_WANT_VELOCITY | GPS_WANT_DATE, GPS_NMEA_RMC},
+        {"the example", GPS_WANT_POSITION | GPS_WANT_DATE | GPS_WANT_VELOCITY | GPS_WANT_ALTITUDE,
+         GPS_NMEA_RMC | GPS_NMEA_GGA},
+        {"  and DOP", 0x1F, GPS_NMEA_RMC | GPS_NMEA_GGA | GPS_NMEA_GSA},
+        {"  and satellites", 0x3F, GPS_NMEA_RMC | GPS_NMEA_GGA | GPS_NMEA_GSA | GPS_NMEA_GSV},
+    };
+    printf("%s: %zu fix cycles\n", path, cycles.size());
+    printf("%-26s %-6s %10s %10s %8s\n", "at 1 Hz", "PMTK314", "measured", "estimated", "vs stock");
+    double outOfBox = 0;
+    for (const auto &profile : kProfiles) {
+        Adafruit_GPS gps(nullptr);
+        Module module;
+        if (profile.sentences == 0x3F && profile.wants == 0x3F) {
+            module.sentences = 0x3F;  // PMTK_SET_NMEA_OUTPUT_ALLDATA, GLL and VTG too
+            module.gsvEvery = 1;
+        } else if (profile.wants) {
+            gps.Subscribe(profile.wants);
+        }
+        Deliver(gps, module, Cycle(), profile.wants && profile.sentences != 0x3F);
+        if (profile.wants && profile.sentences != 0x3F && module.sentences != profile.sentences) {
+            printf("%s: subscribed to 0x%02X, not 0x%02X\n", profile.name, module.sentences, profile.sentences);
+            return 1;
+        }
+        size_t bytes = 0;
+        for (const Cycle &cycle : cycles) {
+            Cycle fix;
+            module.Fix(cycle, 0, nullptr, &fix);
+            bytes += Bytes(fix);
+            Deliver(gps, module, fix, false);
+        }
+        const double measured = (double)bytes / cycles.size();
+        const uint32_t estimated = OutputController::Estimate(module.sentences, 1000, module.gsvEvery);
+        if (!outOfBox) outOfBox = measured;
+        printf("%-26s 0x%02X   %10.0f %10u %7.0f%%\n", profile.name, module.sentences, measured, (unsigned)estimated,
+               measured * 100 / outOfBox);
+        if (!Near(measured, estimated)) {
+            printf("%s: %.0f bytes/s measured, %u estimated\n", profile.name, measured, (unsigned)estimated);
+            return 1;
+        }
+    }
+
+    // the rate follows the speed
+    const uint8_t wants = GPS_WANT_POSITION | GPS_WANT_DATE | GPS_WANT_VELOCITY | GPS_WANT_ALTITUDE;
+    gps_rate_policy_t policy = kGpsRatePolicyDefault;
+    policy.adjustBaud = true;
+    PhaseResult adaptive[4], budget[4];
+    uint32_t changes, budgetChanges;
+    if (!RunPolicy(cycles, wants, policy, adaptive, &changes)) return 1;
+    policy.budgetBytesPerSec = BUDGET;
+    policy.adjustBaud = false;
+    if (!RunPolicy(cycles, wants | GPS_WANT_DOP, policy, budget, &budgetChanges)) return 1;
+
+    printf("\nkGpsRatePolicyDefault, RMC and GGA, following the speed with PMTK220 and PMTK251:\n");
+    printf("%-9s %6s %7s %9s %10s %10s %7s %12s\n", "", "knots", "period", "measured", "estimated", "in driver",
+           "baud", "taken after");
+    for (size_t p = 0; p < 4; p++) {
+        const PhaseResult &r = adaptive[p];
+        const double measured = (double)r.bytes / r.seconds;
+        printf("%-9s %6s %5u ms %9.0f %10u %10u %7u %6u epochs\n", kPhases[p].name, kPhases[p].knots,
+               (unsigned)r.periodMs, measured, (unsigned)r.estimated, (unsigned)r.measured, (unsigned)r.baud,
+               (unsigned)r.lagEpochs);
+        // faster at once, slower only after the hold
+        const uint32_t lag = p && kPhases[p].periodMs < kPhases[p - 1].periodMs ? 1 : policy.holdEpochs;
+        if (r.periodMs != kPhases[p].periodMs || r.lagEpochs != lag || !Near(measured, r.estimated) ||
+            !Near(r.measured, r.estimated) || r.baud != OutputController::BaudFor(r.estimated)) {
+            printf("%s: period %u ms after %u epochs, %.0f bytes/s measured, %u in the driver, %u estimated\n",
+                   kPhases[p].name, (unsigned)r.periodMs, (unsigned)r.lagEpochs, measured, (unsigned)r.measured,
+                   (unsigned)r.estimated);
+            return 1;
+        }
+    }
+    if (changes != 4) {
+        printf("%u rate changes, 4 expected\n", (unsigned)changes);
+        return 1;
+    }
+
+    printf("\nthe same with GSA and a budget of %d bytes/s:\n", BUDGET);
+    printf("%-9s %6s %7s %9s %10s %10s\n", "", "knots", "period", "measured", "estimated", "in driver");
+    for (size_t p = 0; p < 4; p++) {
+        const PhaseResult &r = budget[p];
+        const double measured = (double)r.bytes / r.seconds;
+        printf("%-9s %6s %5u ms %9.0f %10u %10u, never faster than %u ms\n", kPhases[p].name, kPhases[p].knots,
+               (unsigned)r.periodMs, measured, (unsigned)r.estimated, (unsigned)r.measured, (unsigned)r.fastestMs);
+        if (r.estimated > BUDGET || measured > BUDGET * (1 + TOLERANCE) || (p && r.fastestMs < 2000)) {
+            printf("%s: over the budget\n", kPhases[p].name);
+            return 1;
+        }
+    }
+
+    // cost per epoch of following the speed, driving at 5 Hz with the sentences of each fix counted
+    OutputController controller;
+    controller.SetPolicy(&kGpsRatePolicyDefault);
+    controller.Commit(GPS_NMEA_RMC | GPS_NMEA_GGA, 200, 0);
+    std::vector<uint32_t> speeds(1024);
+    for (uint32_t &speed : speeds) speed = 15000 + rand() % 10000;
+    const uint32_t rounds = 10000000;
+    uint32_t changed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < rounds; i++) {
+        controller.Count(75);
+        controller.Count(72);
+        changed += controller.Epoch(i * 200 % 86400000, true, speeds[i % speeds.size()]);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (changed) {
+        printf("the rate changed while driving at a steady speed\n");
+        return 1;
+    }
+    printf("\nEpoch():  %.1f ns per epoch with two sentences counted, %u bytes/s, OutputController is %zu bytes\n",
+           seconds * 1e9 / rounds, (unsigned)controller.Stats().measuredBps, sizeof(OutputController));
+    return 0;
+}
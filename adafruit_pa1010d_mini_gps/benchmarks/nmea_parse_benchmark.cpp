@@ -0,0 +1,61 @@
+// Host benchmark for Adafruit_GPS::Parse
+//
+// Replays every sentence of a recorded NMEA capture through Check() and
+// Parse() and reports how many sentences per second the parser sustains.
+//
+// Usage: nmea_parse_benchmark [capture.txt] [repetitions]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+static bool LoadLines(const char *path, std::vector<std::string> &out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0]) out.push_back(line);
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 50;
+
+    std::vector<std::string> lines;
+    if (!LoadLines(path, lines) || lines.empty()) {
+        printf("Could not read %s\n", path);
+        return 1;
+    }
+
+    Adafruit_GPS gps(nullptr);
+    char buff[MAXLINELENGTH * 2];
+    uint64_t parsed = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; r++) {
+        for (const std::string &line : lines) {
+            memcpy(buff, line.c_str(), line.size() + 1);
+            if (gps.Parse(buff)) parsed++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t total = (uint64_t)lines.size() * repetitions;
+    printf("%s: %zu sentences x %d\n", path, lines.size(), repetitions);
+    printf("%llu sentences (%llu parsed) in %.3f s, %.0f sentences/s, %.1f ns/sentence\n", (unsigned long long)total,
+           (unsigned long long)parsed, seconds, total / seconds, seconds * 1e9 / total);
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Host benchmark for the table driven trigonometry in fast_trig.hpp
+//
+// First checks FastSinCos() and FastAtan2() against the C library over the
+// whole circle in steps of a thousandth of a degree and fails if either one
+// is off by more than FAST_TRIG_SIN_ERROR or FAST_TRIG_ATAN_ERROR_DEG. Then
+// reports CPU cycles per call for both against sin()/cos() and the
+// asin()/acos() based boatAngle() they replace, and per NewDataValue() of
+// a compound angle (NMEA_COG) and of a plain value (NMEA_SOG). A host FPU
+// makes the C library look far cheaper than the soft float of the M0+.
+//
+// Usage: nmea_trig_benchmark [calls]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <vector>
+
+#include "fast_trig.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT "cycles"
+static inline uint64_t Cycles() { return __rdtsc(); }
+#else
+#define CYCLE_UNIT "ns"
+static inline uint64_t Cycles() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+#endif
+
+#define DEFAULT_CALLS 1000000
+#define SWEEP_STEPS 360000  // a thousandth of a degree
+
+// the boatAngle() the compound angles were smoothed with before FastAtan2()
+static float AsinAcosAngle(float s, float c) {
+    float sAng = asinf(s) * (float)RAD_TO_DEG;
+    float cAng = acosf(c) * (float)RAD_TO_DEG;
+    if (cAng < 45) return sAng;
+    if (cAng > 135) return sAng > 0 ? 180 - sAng : -180 - sAng;
+    return sAng < 0 ? -cAng : cAng;
+}
+
+int main(int argc, char **argv) {
+    unsigned calls = argc > 1 ? (unsigned)atoi(argv[1]) : DEFAULT_CALLS;
+    if (calls == 0) return 1;
+
+    double sinErr = 0, atanErr = 0;
+    for (int i = -SWEEP_STEPS; i <= SWEEP_STEPS; i++) {
+        const double deg = i * 360.0 / SWEEP_STEPS;
+        float s, c;
+        FastSinCos((float)deg, &s, &c);
+        sinErr = fmax(sinErr, fmax(fabs(s - sin(deg / RAD_TO_DEG)), fabs(c - cos(deg / RAD_TO_DEG))));
+        if (i < -SWEEP_STEPS / 2 || i > SWEEP_STEPS / 2) continue;
+        // a smoothed pair is shorter than 1, and the ratio must not care
+        const double r = 0.05 + 0.95 * (i & 0xFF) / 255.0;
+        const double a = FastAtan2((float)(r * sin(deg / RAD_TO_DEG)), (float)(r * cos(deg / RAD_TO_DEG)));
+        double e = fabs(a - deg);
+        if (e > 180) e = 360 - e;  // -180 and 180 are the same direction
+        atanErr = fmax(atanErr, e);
+    }
+    printf("FastSinCos() max error %.2e (bound %.0e), FastAtan2() max error %.2e degrees (bound %.0e)\n", sinErr,
+           FAST_TRIG_SIN_ERROR, atanErr, FAST_TRIG_ATAN_ERROR_DEG);
+    if (sinErr > FAST_TRIG_SIN_ERROR || atanErr > FAST_TRIG_ATAN_ERROR_DEG) {
+        printf("error bound exceeded\n");
+        return 1;
+    }
+
+    // course like input: a slowly turning heading with some noise
+    std::vector<float> angles(calls), sines(calls), cosines(calls);
+    uint32_t seed = 12345;
+    for (unsigned i = 0; i < calls; i++) {
+        seed = seed * 1664525 + 1013904223;
+        angles[i] = fmodf(i * 0.01f + (seed >> 24) * 0.05f, 360.0f);
+        sines[i] = 0.9f * sinf(angles[i] / (float)RAD_TO_DEG);
+        cosines[i] = 0.9f * cosf(angles[i] / (float)RAD_TO_DEG);
+    }
+
+    volatile float sink = 0;
+    uint64_t start = Cycles();
+    for (unsigned i = 0; i < calls; i++) {
+        const float rad = angles[i] / (float)RAD_TO_DEG;
+        sink += sinf(rad) + cosf(rad);
+    }
+    const double libSinCos = (double)(Cycles() - start) / calls;
+
+    start = Cycles();
+    for (unsigned i = 0; i < calls; i++) {
+        float s, c;
+        FastSinCos(angles[i], &s, &c);
+        sink += s + c;
+    }
+    const double fastSinCos = (double)(Cycles() - start) / calls;
+
+    start = Cycles();
+    for (unsigned i = 0; i < calls; i++) sink += AsinAcosAngle(sines[i] / 0.9f, cosines[i] / 0.9f);
+    const double libAngle = (double)(Cycles() - start) / calls;
+
+    start = Cycles();
+    for (unsigned i = 0; i < calls; i++) sink += FastAtan2(sines[i], cosines[i]);
+    const double fastAngle = (double)(Cycles() - start) / calls;
+
+    Adafruit_GPS gps(nullptr);
+    start = Cycles();
+    for (unsigned i = 0; i < calls; i++) gps.NewDataValue(NMEA_COG, angles[i]);
+    const double compound = (double)(Cycles() - start) / calls;
+
+    start = Cycles();
+    for (unsigned i = 0; i < calls; i++) gps.NewDataValue(NMEA_SOG, angles[i]);
+    const double plain = (double)(Cycles() - start) / calls;
+    sink += gps.getSmoothed(NMEA_COG) + gps.getSmoothed(NMEA_SOG);
+
+    printf("%u calls, " CYCLE_UNIT " per call\n", calls);
+    printf("%-28s %10s %10s\n", "", "libm", "table");
+    printf("%-28s %10.1f %10.1f\n", "sin + cos", libSinCos, fastSinCos);
+    printf("%-28s %10.1f %10.1f\n", "angle of sin, cos", libAngle, fastAngle);
+    printf("%-28s %21.1f\n", "NewDataValue(NMEA_COG)", compound);
+    printf("%-28s %21.1f\n", "NewDataValue(NMEA_SOG)", plain);
+    return 0;
+}
@@ -0,0 +1,255 @@
+// Host benchmark for the PMTK command queue
+//
+// Replays a recorded NMEA capture and sends a PMTK command every
+// COMMAND_EVERY sentences, with a simulated module that acknowledges it
+// ACK_DELAY sentences after it goes out, rejects one command and never
+// answers another. Done two ways: with QueueCommand() and Poll(), which
+// keeps parsing while the acknowledgement is outstanding, and with
+// SendCommand() followed by WaitForSentence(), which swallows the sentences
+// that arrive while it waits. LOCUS_StartLogger(), LOCUS_ReadStatus(),
+// Wakeup() and LOCUS_StopLogger() then go through the queue while the
+// capture keeps arriving. Fails unless every queued command completes with
+// the result the module gave it and the $PMTKLOG status is decoded, then
+// reports the sentences each way parsed and the cost of Poll() with
+// commands in flight.
+//
+// Usage: pmtk_queue_benchmark [capture.txt] [repetitions]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+#define COMMAND_EVERY 200  // sentences between commands
+#define ACK_DELAY 3        // sentences between a command going out and its acknowledgement
+#define TIMEOUT_MS 2       // short, the replay runs far faster than the module talks
+#define NO_ACK -1
+
+struct Scripted {
+    const char *cmd;
+    int flag;  // what the module answers, NO_ACK for nothing
+    pmtk_result_t expect;
+};
+
+static const Scripted kScript[] = {
+    {PMTK_SET_NMEA_UPDATE_1HZ, 3, PMTK_RESULT_SUCCESS},
+    {PMTK_SET_NMEA_OUTPUT_RMCGGA, 3, PMTK_RESULT_SUCCESS},
+    {PMTK_API_SET_FIX_CTL_1HZ, 3, PMTK_RESULT_SUCCESS},
+    {PGCMD_ANTENNA, NO_ACK, PMTK_RESULT_SUCCESS},        // not a PMTK command, nothing to wait for
+    {"$PMTK397,0.20", 1, PMTK_RESULT_UNSUPPORTED},       // rejected
+    {PMTK_Q_RELEASE, NO_ACK, PMTK_RESULT_TIMEOUT},       // answered with $PMTK705 only
+};
+#define SCRIPT_COUNT (sizeof(kScript) / sizeof(kScript[0]))
+
+struct Outcome {
+    std::vector<const Scripted *> sent;  // by ticket
+    unsigned completed = 0;
+    unsigned wrong = 0;
+};
+
+static void CommandDone(uint16_t ticket, pmtk_result_t result, void *ctx) {
+    Outcome *o = (Outcome *)ctx;
+    o->completed++;
+    if (ticket >= o->sent.size() || o->sent[ticket]->expect != result) o->wrong++;
+}
+
+struct Receiver {
+    Adafruit_GPS *gps;
+    size_t parsed = 0;  // capture sentences, not acknowledgements
+};
+
+static bool IsCapture(const char *nmea) { return strncmp(nmea, "$PMTK", 5) != 0; }
+
+static void ParseSentence(char *nmea, size_t len, void *ctx) {
+    Receiver *rx = (Receiver *)ctx;
+    if (IsCapture(nmea)) rx->parsed++;
+    rx->gps->Parse(nmea, len);
+}
+
+// <body>*hh CR LF
+static std::string WithChecksum(const char *body) {
+    char line[MAXLINELENGTH];
+    uint8_t cs = 0;
+    for (const char *p = body + 1; *p; p++) cs ^= (uint8_t)*p;
+    snprintf(line, sizeof(line), "%s*%02X\r\n", body, cs);
+    return line;
+}
+
+// $PMTK001,<cmd>,<flag>*hh
+static std::string AckFor(const char *cmd, int flag) {
+    char ack[32];
+    snprintf(ack, sizeof(ack), "$PMTK001,%d,%d", atoi(cmd + 5), flag);
+    return WithChecksum(ack);
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    std::vector<std::string> lines;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f))
+        if (line[0] == '$') lines.push_back(line);
+    fclose(f);
+    std::vector<std::string> stream;
+    for (int r = 0; r < repetitions; r++) stream.insert(stream.end(), lines.begin(), lines.end());
+
+    // QueueCommand() and Poll()
+    Adafruit_GPS gps(nullptr);
+    gps.SetCommandTimeout(TIMEOUT_MS, 1);
+    Outcome outcome;
+    outcome.sent.push_back(NULL);  // tickets start at 1
+    Receiver rx{&gps};
+    size_t inFlight = 1, since = 0;
+    double pollTime = 0, pollMax = 0;
+    unsigned long long polls = 0;
+    auto poll = [&](bool timed) {
+        auto start = std::chrono::steady_clock::now();
+        gps.Poll(ParseSentence, &rx);
+        const double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (timed) {
+            pollTime += t;
+            pollMax = t > pollMax ? t : pollMax;
+            polls++;
+        }
+        // the module: acknowledge the command in flight ACK_DELAY sentences after it went out
+        while (inFlight < outcome.sent.size()) {
+            const pmtk_result_t r = gps.CommandResult((uint16_t)inFlight);
+            if (r != PMTK_RESULT_SENT && r != PMTK_RESULT_QUEUED) {
+                inFlight++;
+                since = 0;
+                continue;
+            }
+            if (r == PMTK_RESULT_SENT && ++since == ACK_DELAY && outcome.sent[inFlight]->flag != NO_ACK) {
+                std::string ack = AckFor(outcome.sent[inFlight]->cmd, outcome.sent[inFlight]->flag);
+                gps.Inject(ack.c_str(), ack.size());
+            }
+            break;
+        }
+    };
+    for (size_t i = 0; i < stream.size(); i++) {
+        if (i / COMMAND_EVERY >= outcome.sent.size()) {
+            const Scripted *s = &kScript[(outcome.sent.size() - 1) % SCRIPT_COUNT];
+            // a timeout takes milliseconds, many sentences at replay speed, so the queue can fill up
+            while (!gps.QueueCommand(s->cmd, CommandDone, &outcome)) poll(false);
+            outcome.sent.push_back(s);
+        }
+        gps.Inject(stream[i].c_str(), stream[i].size());
+        poll(true);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (gps.CommandsPending() && std::chrono::steady_clock::now() < deadline) poll(false);
+    const unsigned queued = (unsigned)outcome.sent.size() - 1;
+    if (outcome.completed != queued || outcome.wrong) {
+        printf("%u of %u queued commands completed, %u with the wrong result\n", outcome.completed, queued,
+               outcome.wrong);
+        return 1;
+    }
+
+    // SendCommand() and WaitForSentence(), the sentences go on arriving while it waits
+    Adafruit_GPS blocking(nullptr);
+    size_t blockingParsed = 0, swallowed = 0, longest = 0;
+    unsigned sent = 0;
+    auto drain = [&]() {
+        while (blocking.NewNMEAreceived()) {
+            char *nmea = blocking.LastNMEA();
+            if (IsCapture(nmea)) blockingParsed++;
+            blocking.Parse(nmea);
+        }
+    };
+    for (size_t i = 0; i < stream.size();) {
+        const Scripted *s = &kScript[sent % SCRIPT_COUNT];
+        if (i / COMMAND_EVERY >= sent + 1 && s->cmd[1] == 'P' && s->cmd[2] == 'M') {
+            blocking.SendCommand(reinterpret_cast<const uint8_t *>(s->cmd), strlen(s->cmd));
+            sent++;
+            size_t n = 0;
+            for (; n < MAXWAITSENTENCE && i < stream.size(); n++, i++) {
+                if (n == ACK_DELAY && s->flag != NO_ACK) {
+                    std::string ack = AckFor(s->cmd, s->flag);
+                    blocking.Inject(ack.c_str(), ack.size());
+                }
+                blocking.Inject(stream[i].c_str(), stream[i].size());
+            }
+            char wait[16];
+            snprintf(wait, sizeof(wait), "$PMTK001,%d,", atoi(s->cmd + 5));
+            const size_t before = blockingParsed;
+            if (n == MAXWAITSENTENCE) blocking.WaitForSentence(wait);
+            while (blocking.Available()) blocking.ReadData();
+            drain();
+            const size_t lost = n - (blockingParsed - before);
+            swallowed += lost;
+            longest = lost > longest ? lost : longest;
+            continue;
+        }
+        if (i / COMMAND_EVERY >= sent + 1) sent++;  // nothing to wait for
+        blocking.Inject(stream[i].c_str(), stream[i].size());
+        while (blocking.Available()) blocking.ReadData();
+        drain();
+        i++;
+    }
+
+    // the LOCUS commands and Wakeup() are queued the same way, the status query is answered with $PMTKLOG only
+    Adafruit_GPS locus(nullptr);
+    locus.SetCommandTimeout(TIMEOUT_MS, 1);
+    Receiver locusRx{&locus};
+    locus.Standby();
+    const uint16_t tickets[] = {locus.LOCUS_StartLogger(), locus.LOCUS_ReadStatus(), locus.Wakeup(),
+                                locus.LOCUS_StopLogger()};
+    const char *replies[] = {"$PMTK001,185,3", "$PMTKLOG,456,0,11,31,2,0,0,0,3769,46", "$PMTK001,0,3",
+                             "$PMTK001,185,3"};
+    const size_t locusCommands = sizeof(tickets) / sizeof(tickets[0]);
+    size_t answering = 0;
+    since = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        locus.Inject(lines[i].c_str(), lines[i].size());
+        locus.Poll(ParseSentence, &locusRx);
+        for (; answering < locusCommands; answering++, since = 0) {
+            const pmtk_result_t r = locus.CommandResult(tickets[answering]);
+            if (r == PMTK_RESULT_QUEUED) break;
+            if (r != PMTK_RESULT_SENT) continue;
+            if (++since == ACK_DELAY) {
+                std::string reply = WithChecksum(replies[answering]);
+                locus.Inject(reply.c_str(), reply.size());
+            }
+            break;
+        }
+    }
+    deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (locus.CommandsPending() && std::chrono::steady_clock::now() < deadline) locus.Poll(ParseSentence, &locusRx);
+    locus_status_t status;
+    for (size_t t = 0; t < locusCommands; t++) {
+        if (!tickets[t] || locus.CommandResult(tickets[t]) != PMTK_RESULT_SUCCESS) {
+            printf("LOCUS command %zu did not complete, result %d\n", t, (int)locus.CommandResult(tickets[t]));
+            return 1;
+        }
+    }
+    if (!locus.LOCUS_Status(&status) || status.serial != 456 || status.records != 3769 || status.percent != 46) {
+        printf("$PMTKLOG status not decoded\n");
+        return 1;
+    }
+
+    printf("%s: %zu sentences x %d, a command every %d sentences, acknowledged %d sentences later\n", path,
+           lines.size(), repetitions, COMMAND_EVERY, ACK_DELAY);
+    printf("QueueCommand():     %u commands, all completed as the module answered, %zu of %zu sentences parsed\n",
+           queued, rx.parsed, stream.size());
+    printf("                    Poll() %.2f us on average, %.1f us at most, over %llu calls\n",
+           pollTime * 1e6 / polls, pollMax * 1e6, polls);
+    printf("WaitForSentence():  %u commands, %zu of %zu sentences parsed, %zu swallowed, up to %zu by one wait\n",
+           sent, blockingParsed, stream.size(), swallowed, longest);
+    printf("LOCUS, Wakeup():    %zu commands, all completed, log %u with %u records, %zu of %zu sentences parsed\n",
+           locusCommands, status.serial, status.records, locusRx.parsed, lines.size());
+    return 0;
+}
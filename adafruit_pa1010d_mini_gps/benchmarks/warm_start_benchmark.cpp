@@ -0,0 +1,165 @@
+// Host benchmark for the warm start state
+//
+// Replays a recorded NMEA capture through Poll() with a state store in RAM,
+// as the first run after flashing, saving whenever StateDue() asks, and checks
+// that snapshots were due on the first fix and then every
+// GPS_STATE_SAVE_INTERVAL_S of GPS time, and that the last one, saved with
+// SaveState(), holds the last fix. A second driver then starts from that store
+// through Init(), with a clock ten minutes on, and must restore it, report its
+// age and queue both time and position aiding; without a clock the state is
+// restored but nothing is queued, and a damaged store is ignored. Reports the time to first fix the driver saw
+// and the cost of Poll() with the tracking on.
+//
+// Usage: warm_start_benchmark [capture.txt]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Adafruit_GPS.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifndef GPS_TOOLS_DIR
+#define GPS_TOOLS_DIR "tools"
+#endif
+
+#define OFF_S 600  // how long the board was off before the second start
+
+// Keeps the state the way a flash sector would, saves are counted
+class RamStore : public GpsStateStore {
+   public:
+    bool Load(gps_warm_state_t *state) override {
+        if (!mSaved) return false;
+        memcpy(state, mBytes, sizeof(*state));
+        return true;
+    }
+    bool Save(const gps_warm_state_t &state) override {
+        memcpy(mBytes, &state, sizeof(state));
+        mSaved = true;
+        mSaves.push_back(state.utc);
+        return true;
+    }
+    uint8_t mBytes[sizeof(gps_warm_state_t)];
+    bool mSaved = false;
+    std::vector<uint32_t> mSaves;
+};
+
+struct Clock {
+    uint32_t utc;
+};
+
+static uint32_t ClockNow(void *ctx) { return ((Clock *)ctx)->utc; }
+
+struct Replay {
+    Adafruit_GPS *gps;
+    uint32_t firstFixUtc = 0;  // what the snapshots should follow
+    uint32_t lastFixUtc = 0;
+    uint32_t expectedSaves = 0;
+    uint32_t lastSave = 0;
+};
+
+static void ParseSentence(char *nmea, size_t len, void *ctx) {
+    Replay *r = (Replay *)ctx;
+    const uint32_t before = r->gps->FixSequence();
+    r->gps->Parse(nmea, len);
+    if (r->gps->StateDue()) r->gps->SaveState();  // the application's job, where blocking on flash is fine
+    gps_fix_t fix;
+    if (r->gps->FixSequence() == before || !r->gps->ReadFix(&fix) || !fix.fix || !fix.date) return;
+    const uint32_t utc = (uint32_t)CivilDays(2000 + fix.date % 100, fix.date / 100 % 100, fix.date / 10000) * 86400 +
+                         fix.timeMs / 1000;
+    if (!r->firstFixUtc) r->firstFixUtc = utc;
+    r->lastFixUtc = utc;
+    if (!r->expectedSaves || utc - r->lastSave >= GPS_STATE_SAVE_INTERVAL_S) {
+        r->expectedSaves++;
+        r->lastSave = utc;
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : GPS_TOOLS_DIR "/nmea_241126_133042.txt";
+
+    std::vector<std::string> lines;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        printf("Could not open %s\n", path);
+        return 1;
+    }
+    char line[MAXLINELENGTH * 2];
+    while (fgets(line, sizeof(line), f))
+        if (line[0] == '$') lines.push_back(line);
+    fclose(f);
+
+    // first run, nothing saved yet
+    RamStore store;
+    Adafruit_GPS gps(nullptr);
+    gps.SetStateStore(&store);
+    gps.Init(0x10);
+    if (gps.TimeToFirstFix().restored || gps.CommandsPending()) {
+        printf("an empty store was restored\n");
+        return 1;
+    }
+    Replay replay{&gps};
+    double pollTime = 0;
+    for (const std::string &l : lines) {
+        gps.Inject(l.c_str(), l.size());
+        auto start = std::chrono::steady_clock::now();
+        gps.Poll(ParseSentence, &replay);
+        pollTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    const size_t periodic = store.mSaves.size();
+    gps.SaveState();  // powering down
+    gps_fix_t last;
+    gps.ReadFix(&last);
+    const gps_warm_state_t &saved = gps.WarmState();
+    const gps_ttff_t first = gps.TimeToFirstFix();
+    if (!replay.firstFixUtc || periodic != replay.expectedSaves || store.mSaves[0] != replay.firstFixUtc ||
+        saved.utc != replay.lastFixUtc || saved.latitude != last.latitude || saved.longitude != last.longitude ||
+        saved.altitudeM != last.altitudeMm / 1000 || !first.ttffMs) {
+        printf("snapshots: %zu taken, %u expected, the last at %u for a fix at %u\n", periodic,
+               (unsigned)replay.expectedSaves, (unsigned)saved.utc, (unsigned)replay.lastFixUtc);
+        return 1;
+    }
+
+    // second run, ten minutes later with a clock
+    Clock clock{saved.utc + OFF_S};
+    Adafruit_GPS warm(nullptr);
+    warm.SetStateStore(&store, ClockNow, &clock);
+    warm.Init(0x10);
+    const gps_ttff_t &t = warm.TimeToFirstFix();
+    const uint32_t almanacAge = saved.almanacUtc ? clock.utc - saved.almanacUtc : 0;
+    if (!t.restored || !t.aided || t.stateAgeS != OFF_S || t.almanacAgeS != almanacAge ||
+        warm.CommandsPending() != 2 || memcmp(&warm.WarmState(), &saved, sizeof(saved))) {
+        printf("the warm start did not restore and aid: restored %d, aided %d, age %u s, %zu commands\n",
+               (int)t.restored, (int)t.aided, (unsigned)t.stateAgeS, warm.CommandsPending());
+        return 1;
+    }
+
+    // without a clock, and from a damaged store
+    Adafruit_GPS noClock(nullptr);
+    noClock.SetStateStore(&store);
+    noClock.Init(0x10);
+    store.mBytes[1] ^= 0x40;
+    Adafruit_GPS damaged(nullptr);
+    damaged.SetStateStore(&store);
+    damaged.Init(0x10);
+    if (!noClock.TimeToFirstFix().restored || noClock.TimeToFirstFix().aided || noClock.CommandsPending() ||
+        noClock.TimeToFirstFix().stateAgeS || damaged.TimeToFirstFix().restored || damaged.CommandsPending()) {
+        printf("a start without a clock or from a damaged store was not handled\n");
+        return 1;
+    }
+
+    printf("%s: %zu sentences, first fix after %u epochs without one, %u ms into the replay\n", path, lines.size(),
+           (unsigned)first.searchEpochs, (unsigned)first.ttffMs);
+    printf("snapshots:   %zu, on the first fix and every %d s of GPS time, the last one by SaveState() holds the "
+           "last fix\n",
+           periodic, GPS_STATE_SAVE_INTERVAL_S);
+    printf("almanac:     %s\n", saved.almanacUtc ? "tracked long enough for a whole one" : "never tracked long enough");
+    printf("warm start:  restored %u s old, time and position aiding queued by Init(), none without a clock, a "
+           "damaged store ignored\n",
+           (unsigned)t.stateAgeS);
+    printf("Poll():      %.2f us per sentence with the tracking on, the state is %zu bytes\n",
+           pollTime * 1e6 / lines.size(), sizeof(gps_warm_state_t));
+    return 0;
+}
@@ -8,10 +8,13 @@
 #include <stdio.h>
 
 #include <Adafruit_GPS.hpp>
+#include <gps_flash_store.hpp>
 //#include "utils.hpp"
 #include <string.h>
 // Connect to the GPS on the hardware I2C port
 Adafruit_GPS GPS(i2c0);
+// Keeps the last fix in flash, so the next start is aided with it
+GpsFlashStore gpsStore;
 
 // Set GPSECHO to 'false' to turn off echoing the GPS data to the Serial console
 // Set to 'true' if you want to debug and listen to the raw GPS sentences
@@ -19,24 +22,30 @@ Adafruit_GPS GPS(i2c0);
 
 uint32_t timer = millis();
 
+// kGpsRatePolicyDefault without its 5 Hz step
+const gps_rate_policy_t ratePolicy = {5000, 1000, 1000, 500, 10000, 0, 5, false};
+
+// Called from ReadData() when the GPS answers a queued command, or gives up on it
+void CommandDone(uint16_t ticket, pmtk_result_t result, void* ctx) {
+    if (result != PMTK_RESULT_SUCCESS) printf("Command %u failed: %d\n", ticket, (int)result);
+}
+
 void setup() {
-    GPS.Init(0x10);  // The I2C address to use is 0x10
-    // uncomment this line to turn on RMC (recommended minimum) and GGA (mFix
-    // data) including mAltitude
-    GPS.SendCommand(reinterpret_cast<const uint8_t*>(PMTK_SET_NMEA_OUTPUT_ALLDATA),
-                    strlen(PMTK_SET_NMEA_OUTPUT_ALLDATA));
-    // uncomment this line to turn on only the "minimum recommended" data
-    // GPS.sendCommand(PMTK_SET_NMEA_OUTPUT_RMCONLY);
-    // For parsing data, we don't suggest using anything but either RMC only or
-    // RMC+GGA since the parser doesn't care about other sentences at this time
-    // Set the update rate
-    GPS.SendCommand(reinterpret_cast<const uint8_t*>(PMTK_SET_NMEA_UPDATE_1HZ),
-                    strlen(PMTK_SET_NMEA_UPDATE_1HZ));  // 1 Hz update rate
-    // For the parsing code to work nicely and have time to sort thru the data,
-    // and print it out we don't suggest using anything higher than 1 Hz
+    GPS.SetStateStore(&gpsStore);  // before Init(); add a clock callback to aid the GPS with the saved fix
+    GPS.Init(0x10);                // The I2C address to use is 0x10
+    // Commands are queued and sent by ReadData() one at a time, each once the
+    // GPS has acknowledged the one before, so setup does not wait for them
+    // Slow down to one update every 5 s while standing still and back to 1 Hz
+    // once moving. For the parsing code to work nicely and have time to sort
+    // thru the data, and print it out we don't suggest anything higher than 1 Hz
+    GPS.SetRatePolicy(&ratePolicy);
+    // Only ask for the sentences that carry what loop() prints: RMC for the
+    // date, speed and angle and GGA for the altitude and satellites, less than
+    // half the bytes the GPS sends out of the box
+    GPS.Subscribe(GPS_WANT_POSITION | GPS_WANT_DATE | GPS_WANT_VELOCITY | GPS_WANT_ALTITUDE, CommandDone);
 
     // Request updates on mAntenna status, comment out to keep quiet
-    GPS.SendCommand(reinterpret_cast<const uint8_t*>(PGCMD_ANTENNA), strlen(PGCMD_ANTENNA));
+    GPS.QueueCommand(PGCMD_ANTENNA);
 
     sleep_ms(1000);
 
@@ -58,27 +67,40 @@ void loop()  // run over and over again
     if (GPS.NewNMEAreceived()) {
         // a tricky thing here is if we print the NMEA sentence, or data
         // we end up not listening and catching other sentences!
-        // so be very wary if using OUTPUT_ALLDATA and trying to print out data
-        printf("%s\n", GPS.LastNMEA());    // this also sets the newNMEAreceived()
-                                           // flag to false
-        if (!GPS.Parse(GPS.LastNMEA())) {  // this also sets the
-                                           // newNMEAreceived() flag to false
-            return;                        // we can fail to parse a sentence in which case we should
-                                           // just wait for another
+        // so be very wary if subscribing to a lot and trying to print out data
+        printf("%s\n", GPS.LastNMEA());  // this also sets the newNMEAreceived()
+                                         // flag to false
+        // the stamp of when the sentence was read feeds ClockSync()
+        if (!GPS.Parse(GPS.LastNMEA(), &GPS.SentenceStamp())) {
+            return;  // we can fail to parse a sentence in which case we should
+                     // just wait for another
         }
     }
 
+    // Save the last fix when a snapshot is due; the flash erase blocks for a
+    // while, which is fine here in the main loop but not inside Parse()
+    if (GPS.StateDue()) GPS.SaveState();
+
     // approximately every 2 mSeconds or so, print out the current stats
     if (millis() - timer > 2000) {
         timer = millis();  // reset the timer
         printf("\nTime: %02d:%02d:%02d.%03d\n", GPS.mHour, GPS.mMinute, GPS.mSeconds, GPS.mMilliseconds);
         printf("Date: %02d/%02d/20%d\n", GPS.mDay, GPS.mMonth, GPS.mYear);
         printf("Fix: %d quality: %d\n", (int)GPS.mFix, (int)GPS.mFixquality);
+        const gps_ttff_t &ttff = GPS.TimeToFirstFix();
+        if (ttff.ttffMs) printf("First fix after %.1f s%s\n", ttff.ttffMs / 1000.0, ttff.aided ? ", aided" : "");
+        const gps_output_stats_t &output = GPS.OutputStats();
+        printf("NMEA: every %u ms, %u bytes/s\n", (unsigned)output.periodMs, (unsigned)output.measuredBps);
+        // How the Pico's clock runs against GPS time, fitted from when each fix
+        // was read; ClockSync().ToUtc() gives other sensors' samples GPS time
+        const gps_clock_t &clock = GPS.ClockSync().Estimate();
+        if (clock.samples)
+            printf("Clock: %+.1f ppm, jitter %u us\n", clock.driftPpb / 1000.0, (unsigned)clock.jitterUs);
         if (GPS.mFix) {
-            printf("Location: %.4f %c, %.4f %c\n", GPS.mLatitude, GPS.mLat, GPS.mLongitude, GPS.mLon);
-            printf("Speed (knots): %f\n", GPS.mSpeed);
-            printf("Angle: %f\n", GPS.mAngle);
-            printf("Altitude: %f\n", GPS.mAltitude);
+            printf("Location: %.4f %c, %.4f %c\n", GPS.Latitude(), GPS.mLat, GPS.Longitude(), GPS.mLon);
+            printf("Speed (knots): %f\n", GPS.Speed());
+            printf("Angle: %f\n", GPS.Angle());
+            printf("Altitude: %f\n", GPS.Altitude());
             printf("Satellites: %d\n", (int)GPS.mSatellites);
         }
     }
@@ -0,0 +1,82 @@
+// Host decoder for captured LOCUS dumps
+//
+// Memory maps each capture of the $PMTKLOX lines a PMTK_LOCUS_DUMP produces,
+// runs every character through the LocusReader the firmware uses and writes
+// the valid records as a binary stream of nmea_fix_record_t (see
+// nmea_log.hpp), the same format nmea_replay writes from live data. Other
+// sentences in the capture are ignored. Reports what the reader counted per
+// dump: lines, missing and bad lines, and good, bad and empty records.
+//
+// Usage: locus_decode [-o fixes.bin] dump.txt [dump.txt ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nmea_log.hpp"
+
+struct Output {
+    FILE *out = NULL;
+    uint64_t written = 0;
+};
+
+static void WriteRecord(const locus_record_t *record, void *ctx) {
+    Output *o = (Output *)ctx;
+    if (!o->out) return;
+    nmea_fix_record_t r = NmeaFixRecord(*record);
+    o->written += fwrite(&r, sizeof(r), 1, o->out);
+}
+
+static void Usage() { printf("Usage: locus_decode [-o fixes.bin] dump.txt [dump.txt ...]\n"); }
+
+int main(int argc, char **argv) {
+    const char *outPath = NULL;
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (!strcmp(argv[first], "-o") && first + 1 < argc)
+            outPath = argv[++first];
+        else {
+            Usage();
+            return 1;
+        }
+    }
+    if (first >= argc) {
+        Usage();
+        return 1;
+    }
+
+    Output output;
+    if (outPath) {
+        output.out = fopen(outPath, "wb");
+        if (!output.out) {
+            printf("Could not create %s\n", outPath);
+            return 1;
+        }
+        nmea_fix_header_t header = {NMEA_FIX_MAGIC, NMEA_FIX_VERSION, sizeof(nmea_fix_record_t)};
+        fwrite(&header, sizeof(header), 1, output.out);
+    }
+
+    int failed = 0;
+    for (int f = first; f < argc; f++) {
+        NmeaLog log;
+        if (!log.Open(argv[f])) {
+            printf("Could not map %s\n", argv[f]);
+            failed++;
+            continue;
+        }
+        LocusReader reader;
+        reader.Begin(WriteRecord, &output);
+        for (size_t i = 0; i < log.Size(); i++) reader.Put(log.Data()[i]);
+        const locus_dump_stats_t &s = reader.Stats();
+        printf("%s: %u of %u lines (%u missing, %u bad), %u records (%u bad, %u empty)%s\n", argv[f],
+               (unsigned)s.lines, (unsigned)s.expectedLines, (unsigned)s.missingLines, (unsigned)s.badLines,
+               (unsigned)s.records, (unsigned)s.badRecords, (unsigned)s.emptyRecords,
+               s.done ? "" : ", no $PMTKLOX,2, the dump is cut short");
+        if (!s.done || s.missingLines || s.badLines) failed++;
+    }
+    if (output.out) {
+        fclose(output.out);
+        printf("%llu fixes written to %s\n", (unsigned long long)output.written, outPath);
+    }
+    return failed ? 2 : 0;
+}
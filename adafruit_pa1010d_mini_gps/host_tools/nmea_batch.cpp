@@ -0,0 +1,312 @@
+// Parallel batch processing of recorded NMEA captures
+//
+// Splits every capture into chunks at sentence boundaries, parses the chunks
+// in parallel with std::execution::par, each with its own Adafruit_GPS, and
+// merges the per-epoch results back in file order. An epoch is one receiver
+// time stamp: the GGA/RMC that carry it and the GSA/GSV that follow. From the
+// merged series it derives the time to first fix of every acquisition.
+//
+// Writes <prefix>_epochs.csv (time, fix, satellites in use and in view, mean
+// SNR, DOP) and <prefix>_ttff.csv, plus <prefix>_epochs.bin as a packed array
+// of nmea_epoch_record_t with -b.
+//
+// Usage: nmea_batch [-o prefix] [-c chunk_kb] [-b] capture.txt [capture.txt ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nmea_log.hpp"
+
+#define NMEA_EPOCH_MAGIC 0x45504D4E  ///< "NMPE" little endian, first word of an epoch stream
+#define NMEA_EPOCH_VERSION 1         ///< bumped whenever nmea_epoch_record_t changes
+#define DAY_MS 86400000UL            ///< time of day wraps at midnight
+#define MAX_EPOCH_STEP_MS 10000      ///< longer steps between epochs are receiver clock corrections
+
+#define EPOCH_HAS_TIME 0x01  ///< a GGA or RMC set the time of the epoch
+#define EPOCH_HAS_GGA 0x02   ///< fix quality and satellites in use are valid
+#define EPOCH_HAS_GSA 0x04   ///< DOP values are valid
+#define EPOCH_HAS_GSV 0x08   ///< satellites in view and SNR are valid
+
+/// one epoch as written to <prefix>_epochs.bin, 24 bytes
+typedef struct {
+    uint32_t timeMs;      ///< GPS time of day in milliseconds
+    uint32_t date;        ///< ddmmyy from the last RMC, 0 if none yet
+    uint16_t pdopX100;    ///< position dilution of precision times 100
+    uint16_t hdopX100;    ///< horizontal dilution of precision times 100
+    uint16_t vdopX100;    ///< vertical dilution of precision times 100
+    uint16_t snrSum;      ///< sum of the SNR of every satellite reporting one, dB-Hz
+    uint8_t snrCount;     ///< satellites reporting an SNR
+    uint8_t satsInView;   ///< satellites in view over all talkers
+    uint8_t satsUsed;     ///< satellites in use from GGA
+    uint8_t fixQuality;   ///< 0 invalid, 1 GPS, 2 DGPS
+    uint8_t fix3d;        ///< 1 no fix, 2 2D, 3 3D from GSA
+    uint8_t have;         ///< EPOCH_HAS_ flags
+    uint16_t file;        ///< index of the capture on the command line
+} nmea_epoch_record_t;
+
+static_assert(sizeof(nmea_epoch_record_t) == 24, "epoch records are written to disk as 24 bytes");
+
+/// a slice of one capture, cut at a line boundary
+struct Chunk {
+    uint16_t file;
+    const char *begin;
+    const char *end;
+    // results
+    nmea_epoch_record_t orphan{};        ///< GSA/GSV seen before the first time stamp of the chunk
+    std::vector<nmea_epoch_record_t> epochs;
+    uint64_t sentences = 0;
+    uint64_t parsed = 0;
+};
+
+/// merge the fields b has into a
+static void MergeEpoch(nmea_epoch_record_t &a, const nmea_epoch_record_t &b) {
+    if (b.have & EPOCH_HAS_GGA) {
+        a.fixQuality = b.fixQuality;
+        a.satsUsed = b.satsUsed;
+    }
+    if (b.have & EPOCH_HAS_GSA) {
+        a.fix3d = b.fix3d;
+        a.pdopX100 = b.pdopX100;
+        a.hdopX100 = b.hdopX100;
+        a.vdopX100 = b.vdopX100;
+    }
+    if (b.have & EPOCH_HAS_GSV) {
+        a.satsInView += b.satsInView;
+        a.snrSum += b.snrSum;
+        a.snrCount += b.snrCount;
+    }
+    if (b.date) a.date = b.date;
+    a.have |= b.have;
+}
+
+/// take satellites in view and SNR straight from the fields of every GSV, rather than from the table Adafruit_GPS
+/// assembles, so that a group cut in two by a chunk boundary still adds up when the chunks are merged
+static bool AddGsv(Adafruit_GPS &gps, const char *line, size_t len, nmea_epoch_record_t &epoch) {
+    NmeaFields f;
+    nmea_scan_t scan;
+    f.Scan(line, len, &scan);
+    if (!scan.star || !scan.star[1]) return false;
+    if (((gps.ParseHex(scan.star[1]) << 4) | gps.ParseHex(scan.star[2])) != scan.sum) return false;
+    // 0 total messages, 1 message number, 2 satellites in view, then PRN, elevation, azimuth, SNR per satellite
+    if (NmeaParseLong(f[1]) == 1) epoch.satsInView += NmeaParseLong(f[2]);
+    for (uint8_t i = 6; i < f.Count(); i += 4) {
+        if (NmeaIsEmpty(f[i])) continue;
+        epoch.snrSum += NmeaParseLong(f[i]);
+        epoch.snrCount++;
+    }
+    epoch.have |= EPOCH_HAS_GSV;
+    return true;
+}
+
+static void ProcessChunk(Chunk &chunk) {
+    Adafruit_GPS gps(nullptr);
+    nmea_epoch_record_t *current = &chunk.orphan;
+    char buff[MAXLINELENGTH];
+    NmeaLog::ForEachSentence(chunk.begin, chunk.end, [&](const char *line, size_t len) {
+        if (len >= sizeof(buff)) return;
+        memcpy(buff, line, len);
+        buff[len] = 0;
+        chunk.sentences++;
+        if (len > 6 && !memcmp(buff + 3, "GSV", 3)) {
+            chunk.parsed += AddGsv(gps, buff, len, *current);
+            return;
+        }
+        if (!gps.Parse(buff, len)) return;
+        chunk.parsed++;
+        bool gga = !strcmp(gps.thisSentence, "GGA"), rmc = !strcmp(gps.thisSentence, "RMC");
+        if (gga || rmc) {
+            uint32_t t = gps.MillisecondsOfDay();
+            if (current == &chunk.orphan || current->timeMs != t) {
+                chunk.epochs.push_back({});
+                current = &chunk.epochs.back();
+                current->timeMs = t;
+                current->file = chunk.file;
+                current->have = EPOCH_HAS_TIME;
+            }
+            if (gga) {
+                current->fixQuality = gps.mFixquality;
+                current->satsUsed = gps.mSatellites;
+                current->have |= EPOCH_HAS_GGA;
+            } else {
+                current->date = gps.mDay * 10000 + gps.mMonth * 100 + gps.mYear;
+            }
+        } else if (!strcmp(gps.thisSentence, "GSA")) {
+            current->fix3d = gps.mFixquality_3d;
+            current->pdopX100 = (uint16_t)lround(gps.PDOP() * 100.0);
+            current->hdopX100 = (uint16_t)lround(gps.HDOP() * 100.0);
+            current->vdopX100 = (uint16_t)lround(gps.VDOP() * 100.0);
+            current->have |= EPOCH_HAS_GSA;
+        }
+    });
+}
+
+static void Usage() { printf("Usage: nmea_batch [-o prefix] [-c chunk_kb] [-b] capture.txt [capture.txt ...]\n"); }
+
+int main(int argc, char **argv) {
+    std::string prefix = "nmea";
+    size_t chunkSize = 1 << 20;
+    bool binary = false;
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (!strcmp(argv[first], "-o") && first + 1 < argc)
+            prefix = argv[++first];
+        else if (!strcmp(argv[first], "-c") && first + 1 < argc)
+            chunkSize = (size_t)atoi(argv[++first]) * 1024;
+        else if (!strcmp(argv[first], "-b"))
+            binary = true;
+        else {
+            Usage();
+            return 1;
+        }
+    }
+    if (first >= argc || chunkSize == 0) {
+        Usage();
+        return 1;
+    }
+
+    // map every capture and cut it into chunks that end on a line boundary
+    std::vector<std::unique_ptr<NmeaLog>> logs;
+    std::vector<Chunk> chunks;
+    uint64_t bytes = 0;
+    for (int f = first; f < argc; f++) {
+        logs.emplace_back(new NmeaLog);
+        NmeaLog &log = *logs.back();
+        if (!log.Open(argv[f])) printf("Could not map %s\n", argv[f]);
+        const char *p = log.Data(), *end = log.Data() + log.Size();
+        bytes += log.Size();
+        while (p < end) {
+            const char *cut = p + min(chunkSize, (size_t)(end - p));
+            if (cut < end) {
+                const char *eol = (const char *)memchr(cut, '\n', end - cut);
+                cut = eol ? eol + 1 : end;
+            }
+            Chunk chunk;
+            chunk.file = (uint16_t)(f - first);
+            chunk.begin = p;
+            chunk.end = cut;
+            chunks.push_back(std::move(chunk));
+            p = cut;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::for_each(std::execution::par, chunks.begin(), chunks.end(), ProcessChunk);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // merge in order: a chunk's orphan belongs to the last epoch before it, and an epoch cut in two by a chunk
+    // boundary shows up as the same time stamp twice in a row
+    std::vector<nmea_epoch_record_t> epochs;
+    uint64_t sentences = 0, parsed = 0;
+    for (const Chunk &chunk : chunks) {
+        sentences += chunk.sentences;
+        parsed += chunk.parsed;
+        bool sameFile = !epochs.empty() && epochs.back().file == chunk.file;
+        if (sameFile) MergeEpoch(epochs.back(), chunk.orphan);
+        for (const nmea_epoch_record_t &e : chunk.epochs) {
+            if (sameFile && epochs.back().timeMs == e.timeMs)
+                MergeEpoch(epochs.back(), e);
+            else
+                epochs.push_back(e);
+            sameFile = true;
+        }
+    }
+    // dates only arrive with RMC, carry them forward
+    for (size_t i = 1; i < epochs.size(); i++)
+        if (!epochs[i].date && epochs[i].file == epochs[i - 1].file) epochs[i].date = epochs[i - 1].date;
+
+    std::string path = prefix + "_epochs.csv";
+    FILE *csv = fopen(path.c_str(), "w");
+    if (!csv) {
+        printf("Could not create %s\n", path.c_str());
+        return 1;
+    }
+    fprintf(csv, "file,date,time_ms,fix_quality,sats_used,sats_in_view,mean_snr,fix_3d,pdop,hdop,vdop\n");
+    for (const nmea_epoch_record_t &e : epochs) {
+        // columns whose sentence did not arrive in this epoch are left empty rather than written as 0
+        char gga[16] = "", gsa[32] = "", gsv[16] = "";
+        if (e.have & EPOCH_HAS_GGA)
+            snprintf(gga, sizeof(gga), "%u,%u", e.fixQuality, e.satsUsed);
+        else
+            strcpy(gga, ",");
+        if (e.have & EPOCH_HAS_GSA)
+            snprintf(gsa, sizeof(gsa), "%u,%.2f,%.2f,%.2f", e.fix3d, e.pdopX100 / 100.0, e.hdopX100 / 100.0,
+                     e.vdopX100 / 100.0);
+        else
+            strcpy(gsa, ",,,");
+        if (e.have & EPOCH_HAS_GSV)
+            snprintf(gsv, sizeof(gsv), "%u,%.1f", e.satsInView, e.snrCount ? (double)e.snrSum / e.snrCount : 0.0);
+        else
+            strcpy(gsv, ",");
+        fprintf(csv, "%s,%06u,%u,%s,%s,%s\n", argv[first + e.file], e.date, e.timeMs, gga, gsv, gsa);
+    }
+    fclose(csv);
+
+    // time to first fix: every run of epochs without a fix that ends in one is an acquisition. The receiver free
+    // runs its clock until it has decoded GPS time and then jumps, so a step longer than MAX_EPOCH_STEP_MS counts as
+    // one ordinary epoch interval instead of the size of the jump
+    path = prefix + "_ttff.csv";
+    FILE *ttff = fopen(path.c_str(), "w");
+    if (!ttff) {
+        printf("Could not create %s\n", path.c_str());
+        return 1;
+    }
+    fprintf(ttff, "file,acquisition,search_start_ms,fix_ms,epochs,ttff_s\n");
+    unsigned acquisitions = 0, perFile = 0, searchEpochs = 0;
+    const nmea_epoch_record_t *searchStart = NULL;
+    uint32_t searchMs = 0, stepMs = 1000;
+    for (size_t i = 0; i < epochs.size(); i++) {
+        const nmea_epoch_record_t &e = epochs[i];
+        if (i == 0 || e.file != epochs[i - 1].file) {
+            searchStart = NULL;
+            perFile = 0;
+            stepMs = 1000;
+        } else {
+            uint32_t step = (e.timeMs + DAY_MS - epochs[i - 1].timeMs) % DAY_MS;
+            if (step && step <= MAX_EPOCH_STEP_MS) stepMs = step;
+            if (searchStart) searchMs += stepMs;
+        }
+        if (!(e.have & EPOCH_HAS_GGA)) continue;
+        if (e.fixQuality == 0) {
+            if (!searchStart) {
+                searchStart = &e;
+                searchMs = searchEpochs = 0;
+            }
+            searchEpochs++;
+        } else if (searchStart) {
+            fprintf(ttff, "%s,%u,%u,%u,%u,%.3f\n", argv[first + e.file], ++perFile, searchStart->timeMs, e.timeMs,
+                    searchEpochs, searchMs / 1000.0);
+            acquisitions++;
+            searchStart = NULL;
+        }
+    }
+    fclose(ttff);
+
+    if (binary) {
+        path = prefix + "_epochs.bin";
+        FILE *bin = fopen(path.c_str(), "wb");
+        if (!bin) {
+            printf("Could not create %s\n", path.c_str());
+            return 1;
+        }
+        nmea_fix_header_t header = {NMEA_EPOCH_MAGIC, NMEA_EPOCH_VERSION, sizeof(nmea_epoch_record_t)};
+        fwrite(&header, sizeof(header), 1, bin);
+        fwrite(epochs.data(), sizeof(nmea_epoch_record_t), epochs.size(), bin);
+        fclose(bin);
+    }
+
+    printf("%d files, %zu chunks on %u hardware threads, %llu sentences (%llu parsed) %.2f MB in %.3f s, %.1f MB/s\n",
+           argc - first, chunks.size(), std::thread::hardware_concurrency(), (unsigned long long)sentences,
+           (unsigned long long)parsed, bytes / 1e6, seconds, bytes / seconds / 1e6);
+    printf("%zu epochs to %s_epochs.csv, %u acquisitions to %s_ttff.csv\n", epochs.size(), prefix.c_str(),
+           acquisitions, prefix.c_str());
+    return 0;
+}
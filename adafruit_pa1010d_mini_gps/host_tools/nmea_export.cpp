@@ -0,0 +1,365 @@
+// Streaming track export of recorded NMEA captures
+//
+// Runs every capture through Adafruit_GPS::Parse() and writes the position of
+// every GGA with a fix as a KML, GPX or GeoJSON track. Memory use does not
+// depend on the size of the capture: points are collected in a window of at
+// most -w points, simplified with Douglas-Peucker to the tolerance given by
+// -t and written out, keeping the last point as the anchor of the next window.
+// The output therefore grows with the complexity of the path, not with the
+// number of samples. A lost fix or a new capture starts a new track segment.
+//
+// The format follows the extension of the output file unless -f is given.
+//
+// Usage: nmea_export [-f kml|gpx|geojson] [-t tolerance_m] [-w window] -o track.kml capture.txt [capture.txt ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "nmea_log.hpp"
+
+#define EXPORT_OUT_BUFFER (256 * 1024)  ///< stdio buffer of the output file
+#define EXPORT_DEFAULT_WINDOW 4096      ///< points simplified at once
+#define METRES_PER_E7_DEG 0.0111319491  ///< length of 1/10000000 degree of latitude on the WGS84 equator
+
+typedef enum { EXPORT_KML, EXPORT_GPX, EXPORT_GEOJSON } export_format_t;
+
+/// print a fixed point angle in 1/10000000 degree without going through a float, so no digits are invented
+static void PrintE7(FILE *out, int32_t v) {
+    int64_t a = v < 0 ? -(int64_t)v : v;
+    fprintf(out, "%s%lld.%07lld", v < 0 ? "-" : "", (long long)(a / 10000000), (long long)(a % 10000000));
+}
+
+/// print millimetres as metres
+static void PrintMm(FILE *out, int32_t v) {
+    int64_t a = v < 0 ? -(int64_t)v : v;
+    fprintf(out, "%s%lld.%03lld", v < 0 ? "-" : "", (long long)(a / 1000), (long long)(a % 1000));
+}
+
+/*!
+    @brief Writes track segments to a file in one of the supported formats
+*/
+class TrackWriter {
+   public:
+    TrackWriter(FILE *out, export_format_t format) : mOut(out), mFormat(format) {}
+
+    /// document header
+    void Begin() {
+        switch (mFormat) {
+            case EXPORT_KML:
+                fprintf(mOut,
+                        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                        "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n<Document>\n");
+                break;
+            case EXPORT_GPX:
+                fprintf(mOut,
+                        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                        "<gpx version=\"1.1\" creator=\"nmea_export\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n"
+                        "<trk>\n");
+                break;
+            case EXPORT_GEOJSON:
+                fprintf(mOut, "{\"type\":\"FeatureCollection\",\"features\":[");
+                break;
+        }
+    }
+
+    /// start a segment, name is the capture it came from
+    void BeginSegment(const char *name) {
+        mSegments++;
+        mFirstPoint = true;
+        switch (mFormat) {
+            case EXPORT_KML:
+                fprintf(mOut,
+                        "<Placemark><name>%s %u</name><LineString><altitudeMode>absolute</altitudeMode>"
+                        "<coordinates>\n",
+                        name, mSegments);
+                break;
+            case EXPORT_GPX:
+                fprintf(mOut, "<trkseg>\n");
+                break;
+            case EXPORT_GEOJSON:
+                fprintf(mOut,
+                        "%s\n{\"type\":\"Feature\",\"properties\":{\"name\":\"%s %u\"},"
+                        "\"geometry\":{\"type\":\"LineString\",\"coordinates\":[",
+                        mSegments > 1 ? "," : "", name, mSegments);
+                break;
+        }
+    }
+
+    /// one track point
+    void Point(const nmea_fix_record_t &p) {
+        mPoints++;
+        switch (mFormat) {
+            case EXPORT_KML:
+                PrintE7(mOut, p.longitude);
+                fputc(',', mOut);
+                PrintE7(mOut, p.latitude);
+                fputc(',', mOut);
+                PrintMm(mOut, p.altitudeMm);
+                fputc('\n', mOut);
+                break;
+            case EXPORT_GPX:
+                fprintf(mOut, "<trkpt lat=\"");
+                PrintE7(mOut, p.latitude);
+                fprintf(mOut, "\" lon=\"");
+                PrintE7(mOut, p.longitude);
+                fprintf(mOut, "\"><ele>");
+                PrintMm(mOut, p.altitudeMm);
+                fprintf(mOut, "</ele>");
+                // GGA carries no date, it is only known once an RMC has been seen
+                if (p.date)
+                    fprintf(mOut, "<time>20%02u-%02u-%02uT%02u:%02u:%02u.%03uZ</time>", p.date % 100,
+                            p.date / 100 % 100, p.date / 10000, p.timeMs / 3600000, p.timeMs / 60000 % 60,
+                            p.timeMs / 1000 % 60, p.timeMs % 1000);
+                fprintf(mOut, "</trkpt>\n");
+                break;
+            case EXPORT_GEOJSON:
+                fprintf(mOut, "%s[", mFirstPoint ? "" : ",");
+                PrintE7(mOut, p.longitude);
+                fputc(',', mOut);
+                PrintE7(mOut, p.latitude);
+                fputc(',', mOut);
+                PrintMm(mOut, p.altitudeMm);
+                fputc(']', mOut);
+                break;
+        }
+        mFirstPoint = false;
+    }
+
+    /// close the current segment
+    void EndSegment() {
+        switch (mFormat) {
+            case EXPORT_KML:
+                fprintf(mOut, "</coordinates></LineString></Placemark>\n");
+                break;
+            case EXPORT_GPX:
+                fprintf(mOut, "</trkseg>\n");
+                break;
+            case EXPORT_GEOJSON:
+                fprintf(mOut, "]}}");
+                break;
+        }
+    }
+
+    /// document trailer
+    void End() {
+        switch (mFormat) {
+            case EXPORT_KML:
+                fprintf(mOut, "</Document>\n</kml>\n");
+                break;
+            case EXPORT_GPX:
+                fprintf(mOut, "</trk>\n</gpx>\n");
+                break;
+            case EXPORT_GEOJSON:
+                fprintf(mOut, "\n]}\n");
+                break;
+        }
+    }
+
+    /// @return Points written so far
+    uint64_t Points() const { return mPoints; }
+    /// @return Segments started so far
+    unsigned Segments() const { return mSegments; }
+
+   private:
+    FILE *mOut;
+    export_format_t mFormat;
+    unsigned mSegments = 0;
+    uint64_t mPoints = 0;
+    bool mFirstPoint = true;
+};
+
+/*!
+    @brief Douglas-Peucker over a bounded window of points, feeding a TrackWriter
+*/
+class TrackSimplifier {
+   public:
+    TrackSimplifier(TrackWriter &writer, double toleranceM, size_t window)
+        : mWriter(writer), mToleranceM(toleranceM), mWindow(window < 3 ? 3 : window) {
+        mPoints.reserve(mWindow);
+        mKeep.reserve(mWindow);
+    }
+
+    /// add a point to the open segment, opening one if needed
+    void Add(const nmea_fix_record_t &p, const char *name) {
+        if (!mOpen) {
+            mWriter.BeginSegment(name);
+            mWriter.Point(p);
+            mPoints.assign(1, p);
+            mOpen = true;
+            return;
+        }
+        // a stationary receiver repeats the same position, those never survive simplification
+        const nmea_fix_record_t &last = mPoints.back();
+        if (mToleranceM > 0 && p.latitude == last.latitude && p.longitude == last.longitude &&
+            p.altitudeMm == last.altitudeMm)
+            return;
+        mPoints.push_back(p);
+        if (mPoints.size() == mWindow) Flush();
+    }
+
+    /// write what is left of the open segment and close it
+    void End() {
+        if (!mOpen) return;
+        Flush();
+        mWriter.EndSegment();
+        mOpen = false;
+    }
+
+   private:
+    /// simplify the window, write every kept point after the anchor and keep the last one as the next anchor
+    void Flush() {
+        size_t n = mPoints.size();
+        if (n < 2) return;
+        mKeep.assign(n, mToleranceM <= 0);
+        mKeep[0] = mKeep[n - 1] = true;
+        if (mToleranceM > 0) Simplify(n);
+        for (size_t i = 1; i < n; i++)
+            if (mKeep[i]) mWriter.Point(mPoints[i]);
+        nmea_fix_record_t anchor = mPoints[n - 1];
+        mPoints.assign(1, anchor);
+    }
+
+    /// iterative Douglas-Peucker on mPoints[0, n), marks survivors in mKeep
+    void Simplify(size_t n) {
+        // local equirectangular projection around the anchor, plenty for the tolerances used on a track
+        double kx = METRES_PER_E7_DEG * cos(mPoints[0].latitude * 1e-7 * M_PI / 180.0);
+        double ky = METRES_PER_E7_DEG;
+        double tol2 = mToleranceM * mToleranceM;
+        mStack.clear();
+        mStack.push_back({0, n - 1});
+        while (!mStack.empty()) {
+            std::pair<size_t, size_t> span = mStack.back();
+            mStack.pop_back();
+            if (span.second - span.first < 2) continue;
+            const nmea_fix_record_t &a = mPoints[span.first];
+            const nmea_fix_record_t &b = mPoints[span.second];
+            double bx = (double)(b.longitude - a.longitude) * kx, by = (double)(b.latitude - a.latitude) * ky;
+            double len2 = bx * bx + by * by;
+            double worst = -1;
+            size_t worstAt = 0;
+            for (size_t i = span.first + 1; i < span.second; i++) {
+                double px = (double)(mPoints[i].longitude - a.longitude) * kx;
+                double py = (double)(mPoints[i].latitude - a.latitude) * ky;
+                // distance to the segment a-b, clamped to its ends so loops back over a are not lost
+                double t = len2 > 0 ? (px * bx + py * by) / len2 : 0;
+                t = t < 0 ? 0 : (t > 1 ? 1 : t);
+                double dx = px - t * bx, dy = py - t * by;
+                double d2 = dx * dx + dy * dy;
+                if (d2 > worst) {
+                    worst = d2;
+                    worstAt = i;
+                }
+            }
+            if (worst <= tol2) continue;
+            mKeep[worstAt] = true;
+            mStack.push_back({span.first, worstAt});
+            mStack.push_back({worstAt, span.second});
+        }
+    }
+
+    TrackWriter &mWriter;
+    double mToleranceM;
+    size_t mWindow;
+    bool mOpen = false;
+    std::vector<nmea_fix_record_t> mPoints;  ///< mPoints[0] is the anchor, already written
+    std::vector<bool> mKeep;
+    std::vector<std::pair<size_t, size_t>> mStack;
+};
+
+static void Usage() {
+    printf("Usage: nmea_export [-f kml|gpx|geojson] [-t tolerance_m] [-w window] -o track.kml capture.txt "
+           "[capture.txt ...]\n");
+}
+
+/// pick the format from a name or a file extension
+static bool ParseFormat(const char *s, export_format_t *format) {
+    const char *dot = strrchr(s, '.');
+    if (dot) s = dot + 1;
+    if (!strcmp(s, "kml"))
+        *format = EXPORT_KML;
+    else if (!strcmp(s, "gpx"))
+        *format = EXPORT_GPX;
+    else if (!strcmp(s, "geojson") || !strcmp(s, "json"))
+        *format = EXPORT_GEOJSON;
+    else
+        return false;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const char *outPath = NULL, *formatName = NULL;
+    double toleranceM = 1.0;
+    size_t window = EXPORT_DEFAULT_WINDOW;
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (!strcmp(argv[first], "-o") && first + 1 < argc)
+            outPath = argv[++first];
+        else if (!strcmp(argv[first], "-f") && first + 1 < argc)
+            formatName = argv[++first];
+        else if (!strcmp(argv[first], "-t") && first + 1 < argc)
+            toleranceM = atof(argv[++first]);
+        else if (!strcmp(argv[first], "-w") && first + 1 < argc)
+            window = (size_t)atoi(argv[++first]);
+        else {
+            Usage();
+            return 1;
+        }
+    }
+    export_format_t format;
+    if (first >= argc || !outPath || !ParseFormat(formatName ? formatName : outPath, &format)) {
+        Usage();
+        return 1;
+    }
+
+    FILE *out = fopen(outPath, "w");
+    if (!out) {
+        printf("Could not create %s\n", outPath);
+        return 1;
+    }
+    setvbuf(out, NULL, _IOFBF, EXPORT_OUT_BUFFER);
+
+    TrackWriter writer(out, format);
+    TrackSimplifier track(writer, toleranceM, window);
+    uint64_t sentences = 0, fixes = 0, bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    writer.Begin();
+    for (int f = first; f < argc; f++) {
+        NmeaLog log;
+        if (!log.Open(argv[f])) {
+            printf("Could not map %s\n", argv[f]);
+            continue;
+        }
+        bytes += log.Size();
+        const char *name = strrchr(argv[f], '/');
+        name = name ? name + 1 : argv[f];
+        Adafruit_GPS gps(nullptr);
+        char buff[MAXLINELENGTH];
+        log.ForEachSentence([&](const char *line, size_t len) {
+            if (len >= sizeof(buff)) return;
+            memcpy(buff, line, len);
+            buff[len] = 0;
+            sentences++;
+            if (!gps.Parse(buff, len) || strcmp(gps.thisSentence, "GGA")) return;
+            if (gps.mFixquality == 0) {
+                track.End();
+                return;
+            }
+            track.Add(NmeaFixRecord(gps, gps.thisSentence), name);
+            fixes++;
+        });
+        track.End();
+    }
+    writer.End();
+    fclose(out);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%llu sentences, %.2f MB in %.3f s, %.1f MB/s\n", (unsigned long long)sentences, bytes / 1e6, seconds,
+           bytes / seconds / 1e6);
+    printf("%llu fixes, %llu points in %u segments written to %s\n", (unsigned long long)fixes,
+           (unsigned long long)writer.Points(), writer.Segments(), outPath);
+    return 0;
+}
@@ -0,0 +1,184 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef NMEA_LOG_HPP_
+#define NMEA_LOG_HPP_
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Adafruit_GPS.hpp>
+
+#define NMEA_FIX_MAGIC 0x58464D4E  ///< "NMFX" little endian, first word of a fix stream
+#define NMEA_FIX_VERSION 1         ///< bumped whenever nmea_fix_record_t changes
+
+/// header at the start of a binary fix stream
+typedef struct {
+    uint32_t magic;    ///< NMEA_FIX_MAGIC
+    uint16_t version;  ///< NMEA_FIX_VERSION
+    uint16_t size;     ///< sizeof(nmea_fix_record_t)
+} nmea_fix_header_t;
+
+/// one fix as written by nmea_replay, little endian and 32 bytes so streams can be mapped as an array
+typedef struct {
+    uint32_t timeMs;       ///< GPS time of day in milliseconds
+    uint32_t date;         ///< ddmmyy as received
+    int32_t latitude;      ///< degrees * 10000000, negative south
+    int32_t longitude;     ///< degrees * 10000000, negative west
+    int32_t altitudeMm;    ///< altitude above MSL in millimetres
+    uint32_t speedMms;     ///< speed over ground in millimetres per second
+    uint16_t courseCdeg;   ///< course in hundredths of a degree
+    uint16_t hdopX100;     ///< horizontal dilution of precision times 100
+    uint8_t fix;           ///< 1 if the receiver reported a fix
+    uint8_t fixQuality;    ///< 0 invalid, 1 GPS, 2 DGPS
+    uint8_t satellites;    ///< satellites in use
+    char sentence;         ///< last letter of the sentence that produced the record, 'A' GGA, 'C' RMC, 'L' GLL,
+                           ///< 'X' for a record from a LOCUS dump ($PMTKLOX)
+} nmea_fix_record_t;
+
+static_assert(sizeof(nmea_fix_record_t) == 32, "fix records are written to disk as 32 bytes");
+
+/*!
+    @brief Snapshot the fix state of a parser into a record
+    @param gps Parser that just parsed sentence
+    @param sentence Three letter sentence ID that was parsed
+    @return The record
+*/
+inline nmea_fix_record_t NmeaFixRecord(Adafruit_GPS &gps, const char *sentence) {
+    nmea_fix_record_t r;
+    r.timeMs = gps.MillisecondsOfDay();
+    r.date = gps.mDay * 10000 + gps.mMonth * 100 + gps.mYear;
+    r.latitude = gps.mLatitude_fixed;
+    r.longitude = gps.mLongitude_fixed;
+    r.altitudeMm = (int32_t)lround(gps.Altitude() * 1000.0);
+    r.speedMms = (uint32_t)lround(gps.Speed() * 1852000.0 / 3600.0);
+    r.courseCdeg = (uint16_t)lround(gps.Angle() * 100.0);
+    r.hdopX100 = (uint16_t)lround(gps.HDOP() * 100.0);
+    r.fix = gps.mFix;
+    r.fixQuality = gps.mFixquality;
+    r.satellites = gps.mSatellites;
+    r.sentence = sentence[2];
+    return r;
+}
+
+/*!
+    @brief Convert a record from a LOCUS dump into the record live data produces. LOCUS keeps no speed, course,
+    DOP or satellite count, those are 0.
+    @param l The LOCUS record
+    @return The record
+*/
+inline nmea_fix_record_t NmeaFixRecord(const locus_record_t &l) {
+    // civil date from days since 1970-01-01, proleptic Gregorian, after Howard Hinnant's days_from_civil inverse
+    const uint32_t z = l.utc / 86400 + 719468;
+    const uint32_t era = z / 146097, doe = z - era * 146097;
+    const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100), mp = (5 * doy + 2) / 153;
+    const uint32_t day = doy - (153 * mp + 2) / 5 + 1, month = mp < 10 ? mp + 3 : mp - 9;
+    const uint32_t year = yoe + era * 400 + (month <= 2);
+
+    nmea_fix_record_t r = {};
+    r.timeMs = l.utc % 86400 * 1000;
+    r.date = day * 10000 + month * 100 + year % 100;
+    r.latitude = l.latitude;
+    r.longitude = l.longitude;
+    r.altitudeMm = l.heightM * 1000;
+    r.fix = l.fix != 0;
+    r.fixQuality = l.fix == 2 ? 2 : l.fix != 0;
+    r.sentence = 'X';
+    return r;
+}
+
+/*!
+    @brief Read only memory map of an NMEA capture, walked one sentence at a time
+*/
+class NmeaLog {
+   public:
+    NmeaLog() = default;
+    NmeaLog(const NmeaLog &) = delete;
+    NmeaLog &operator=(const NmeaLog &) = delete;
+    ~NmeaLog() { Close(); }
+
+    /*!
+        @brief Map a capture into memory
+        @param path File to map
+        @return false if the file can not be opened or mapped
+    */
+    bool Open(const char *path) {
+        Close();
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                madvise(map, st.st_size, MADV_SEQUENTIAL);
+                mData = (const char *)map;
+                mSize = st.st_size;
+            }
+        }
+        ::close(fd);
+        return mData != NULL;
+    }
+
+    /// unmap the capture
+    void Close() {
+        if (mData) munmap((void *)mData, mSize);
+        mData = NULL;
+        mSize = 0;
+    }
+
+    /// @return First byte of the capture
+    const char *Data() const { return mData; }
+    /// @return Size of the capture in bytes
+    size_t Size() const { return mSize; }
+
+    /*!
+        @brief Call fn(line, len) for every line in [begin, end) that starts with '$' or '!'. Line endings
+        are not included and the line is not terminated.
+        @param begin First byte to look at
+        @param end One past the last byte
+        @param fn Callable taking (const char *line, size_t len)
+    */
+    template <typename Fn>
+    static void ForEachSentence(const char *begin, const char *end, Fn fn) {
+        while (begin < end) {
+            const char *eol = (const char *)memchr(begin, '\n', end - begin);
+            if (!eol) eol = end;
+            size_t len = eol - begin;
+            while (len && (begin[len - 1] == '\r')) len--;
+            if (len && (begin[0] == '$' || begin[0] == '!')) fn(begin, len);
+            begin = eol + 1;
+        }
+    }
+
+    /// ForEachSentence() over the whole capture
+    template <typename Fn>
+    void ForEachSentence(Fn fn) const {
+        if (mData) ForEachSentence(mData, mData + mSize, fn);
+    }
+
+   private:
+    const char *mData = NULL;
+    size_t mSize = 0;
+};
+
+#endif
@@ -0,0 +1,152 @@
+// Host replay driver for recorded NMEA captures
+//
+// Memory maps each capture, runs every sentence through Adafruit_GPS::Parse()
+// and reports throughput and a latency histogram per sentence type. With -o
+// the fix state after every GGA, RMC and GLL is written as a binary stream of
+// nmea_fix_record_t (see nmea_log.hpp), which makes a compact reference to
+// diff parser changes against.
+//
+// Usage: nmea_replay [-o fixes.bin] [-r repetitions] capture.txt [capture.txt ...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+
+#include "nmea_log.hpp"
+
+#define LATENCY_BUCKETS 16  ///< log2 buckets starting at 32 ns, the last one is open ended
+#define LATENCY_FIRST 5     ///< log2 of the upper edge of the first bucket in ns
+
+struct LatencyHistogram {
+    uint64_t count = 0;
+    uint64_t parsed = 0;
+    uint64_t totalNs = 0;
+    uint64_t maxNs = 0;
+    uint64_t buckets[LATENCY_BUCKETS] = {0};
+
+    void Add(uint64_t ns, bool ok) {
+        count++;
+        parsed += ok;
+        totalNs += ns;
+        if (ns > maxNs) maxNs = ns;
+        uint8_t b = 0;
+        while (b < LATENCY_BUCKETS - 1 && ns >= (1ULL << (b + LATENCY_FIRST))) b++;
+        buckets[b]++;
+    }
+
+    /// upper edge of the bucket holding the given fraction of samples
+    uint64_t Percentile(double fraction) const {
+        uint64_t target = (uint64_t)(count * fraction), seen = 0;
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen > target) return b == LATENCY_BUCKETS - 1 ? maxNs : 1ULL << (b + LATENCY_FIRST);
+        }
+        return maxNs;
+    }
+};
+
+static void Usage() { printf("Usage: nmea_replay [-o fixes.bin] [-r repetitions] capture.txt [capture.txt ...]\n"); }
+
+int main(int argc, char **argv) {
+    const char *outPath = NULL;
+    int repetitions = 1;
+    int first = 1;
+    for (; first < argc && argv[first][0] == '-'; first++) {
+        if (!strcmp(argv[first], "-o") && first + 1 < argc)
+            outPath = argv[++first];
+        else if (!strcmp(argv[first], "-r") && first + 1 < argc)
+            repetitions = atoi(argv[++first]);
+        else {
+            Usage();
+            return 1;
+        }
+    }
+    if (first >= argc || repetitions < 1) {
+        Usage();
+        return 1;
+    }
+
+    FILE *out = NULL;
+    if (outPath) {
+        out = fopen(outPath, "wb");
+        if (!out) {
+            printf("Could not create %s\n", outPath);
+            return 1;
+        }
+        nmea_fix_header_t header = {NMEA_FIX_MAGIC, NMEA_FIX_VERSION, sizeof(nmea_fix_record_t)};
+        fwrite(&header, sizeof(header), 1, out);
+    }
+
+    std::map<std::string, LatencyHistogram> histograms;
+    uint64_t sentences = 0, parsed = 0, bytes = 0, fixes = 0, skipped = 0;
+    double seconds = 0;
+
+    for (int f = first; f < argc; f++) {
+        NmeaLog log;
+        if (!log.Open(argv[f])) {
+            printf("Could not map %s\n", argv[f]);
+            continue;
+        }
+        for (int r = 0; r < repetitions; r++) {
+            Adafruit_GPS gps(nullptr);  // fresh state per pass so every pass writes the same fixes
+            char buff[MAXLINELENGTH];
+            auto start = std::chrono::steady_clock::now();
+            log.ForEachSentence([&](const char *line, size_t len) {
+                if (len >= sizeof(buff)) {
+                    skipped++;
+                    return;
+                }
+                memcpy(buff, line, len);
+                buff[len] = 0;
+                auto t0 = std::chrono::steady_clock::now();
+                bool ok = gps.Parse(buff, len);
+                uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0)
+                                  .count();
+                // key by the whole address field, so e.g. GLGSV shows up apart from GPGSV
+                const char *comma = (const char *)memchr(buff, ',', len);
+                size_t idLen = comma ? min((size_t)(comma - buff - 1), (size_t)8) : 0;
+                histograms[idLen ? std::string(buff + 1, idLen) : "?"].Add(ns, ok);
+                sentences++;
+                bytes += len;
+                if (!ok) return;
+                parsed++;
+                if (out && r == 0 && (!strcmp(gps.thisSentence, "GGA") || !strcmp(gps.thisSentence, "RMC") ||
+                                      !strcmp(gps.thisSentence, "GLL"))) {
+                    nmea_fix_record_t record = NmeaFixRecord(gps, gps.thisSentence);
+                    fwrite(&record, sizeof(record), 1, out);
+                    fixes++;
+                }
+            });
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    if (out) fclose(out);
+    if (!sentences) return 1;
+
+    printf("%llu sentences (%llu parsed, %llu too long) %.2f MB in %.3f s\n", (unsigned long long)sentences,
+           (unsigned long long)parsed, (unsigned long long)skipped, bytes / 1e6, seconds);
+    printf("%.0f sentences/s, %.1f MB/s\n", sentences / seconds, bytes / seconds / 1e6);
+    if (outPath) printf("%llu fixes written to %s\n", (unsigned long long)fixes, outPath);
+
+    printf("\n%-8s %9s %9s %8s %8s %8s %8s  latency histogram, ns upper edge: count\n", "address", "count", "parsed",
+           "mean ns", "p50", "p99", "max");
+    for (const auto &entry : histograms) {
+        const LatencyHistogram &h = entry.second;
+        printf("%-8s %9llu %9llu %8.0f %8llu %8llu %8llu ", entry.first.c_str(), (unsigned long long)h.count,
+               (unsigned long long)h.parsed, (double)h.totalNs / h.count, (unsigned long long)h.Percentile(0.5),
+               (unsigned long long)h.Percentile(0.99), (unsigned long long)h.maxNs);
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+            if (!h.buckets[b]) continue;
+            if (b == LATENCY_BUCKETS - 1)
+                printf(" >%llu:%llu", 1ULL << (b + LATENCY_FIRST - 1), (unsigned long long)h.buckets[b]);
+            else
+                printf(" %llu:%llu", 1ULL << (b + LATENCY_FIRST), (unsigned long long)h.buckets[b]);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -42,17 +42,136 @@ bool Adafruit_GPS::Init(uint32_t aI2cAddress) {
     gpio_pull_up(I2C_SDA_PIN);
     gpio_pull_up(I2C_SCL_PIN);
 
+    mInitMs = millis();
+    mTtff = gps_ttff_t{};
+    mTrackingSince = 0;
+    mSavedUtc = 0;
+    mStateDue = false;
+    RestoreState();
     return true;
 }
 
+/*!
+    @brief Keep the last fix across power cycles. From now on a snapshot of
+    the position and UTC is due on the first fix and then every
+    GPS_STATE_SAVE_INTERVAL_S, see StateDue(), and Init() feeds what it finds
+    in the store back to the module as $PMTK740 and $PMTK741 aiding before the
+    first sentence arrives. Call before Init().
+    @param store Where the state is kept, e.g. a GpsFlashStore, NULL to stop
+    @param utcNow Optional clock for Init(), e.g. an RTC. Without one the
+    state is still restored into WarmState(), but the module is not aided:
+    its age is unknown, and the saved time could be hours or months old.
+    @param ctx Opaque pointer passed through to utcNow
+*/
+void Adafruit_GPS::SetStateStore(GpsStateStore *store, gps_utc_cb_t utcNow, void *ctx) {
+    mStateStore = store;
+    mUtcNow = utcNow;
+    mUtcCtx = ctx;
+}
+
+/*!
+    @brief Save the last fix to the store. The driver never saves by itself,
+    since a store may block for long, a flash erase with interrupts off, so
+    call this when StateDue() says a snapshot is due, or before powering down,
+    from the context that parses and outside interrupt handlers.
+    @return False without a store, without a fix since the state was last
+    restored, or if the store failed
+*/
+bool Adafruit_GPS::SaveState(void) {
+    if (!mStateStore || !mWarm.utc) return false;
+    mWarm.magic = GPS_STATE_MAGIC;
+    mWarm.version = GPS_STATE_VERSION;
+    mWarm.size = sizeof(mWarm);
+    if (mTtff.ttffMs) mWarm.ttffMs = mTtff.ttffMs;
+    if (mEpo.Result() == PMTK_RESULT_SUCCESS) mWarm.epoEndHour = mEpo.Stats().endHour;
+    mSavedUtc = mWarm.utc;
+    mStateDue = false;
+    return mStateStore->Save(mWarm);
+}
+
+/*!
+    @brief Is a periodic snapshot due? Set on the first fix after Init() and
+    then every GPS_STATE_SAVE_INTERVAL_S of GPS time, cleared by SaveState()
+    @return True if SaveState() should be called
+*/
+bool Adafruit_GPS::StateDue(void) { return mStateDue; }
+
+/*!
+    @brief The last fix and almanac time as they would be saved, or as Init()
+    restored them until there is a new fix
+    @return The state
+*/
+const gps_warm_state_t &Adafruit_GPS::WarmState(void) { return mWarm; }
+
+/*!
+    @brief How the start since Init() went: the time to the first fix and
+    whether a saved state aided it, as the driver saw it
+    @return The counters, ttffMs stays 0 until the first epoch with a fix
+*/
+const gps_ttff_t &Adafruit_GPS::TimeToFirstFix(void) { return mTtff; }
+
+/*!
+    @brief Load the saved state and, with a clock, queue it as aiding, called
+    by Init()
+*/
+void Adafruit_GPS::RestoreState(void) {
+    gps_warm_state_t saved;
+    if (!mStateStore || !mStateStore->Load(&saved)) return;
+    if (saved.magic != GPS_STATE_MAGIC || saved.version != GPS_STATE_VERSION || saved.size != sizeof(saved) ||
+        !saved.utc)
+        return;
+    mWarm = saved;
+    mTtff.restored = true;
+
+    // aiding with a stale time is worse than none, so only with a clock that is not behind the saved fix
+    const uint32_t utc = mUtcNow ? mUtcNow(mUtcCtx) : 0;
+    if (utc < saved.utc) return;
+    mTtff.stateAgeS = utc - saved.utc;
+    if (saved.almanacUtc) mTtff.almanacAgeS = utc - saved.almanacUtc;
+    // days since 1970-01-01 back to a civil date, Howard Hinnant's civil_from_days
+    const uint32_t z = utc / 86400 + 719468, doe = z % 146097;
+    const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100), mp = (5 * doy + 2) / 153;
+    const uint8_t day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1), month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    const uint16_t year = (uint16_t)(yoe + z / 146097 * 400 + (month <= 2));
+    const uint8_t hour = utc / 3600 % 24, minute = utc / 60 % 60, second = utc % 60;
+    AidTime(year, month, day, hour, minute, second);
+    mTtff.aided =
+        AidPosition(saved.latitude, saved.longitude, saved.altitudeM, year, month, day, hour, minute, second) != 0;
+    ServiceCommands();  // out before the module has sent anything
+}
+
+/*!
+    @brief Follow the epochs for the time to first fix, the almanac age and the
+    periodic snapshot, called for every published epoch. Only marks the
+    snapshot due, the application saves it with SaveState().
+*/
+void Adafruit_GPS::TrackFix(void) {
+    if (!mEpoch.fix) {
+        mTrackingSince = 0;
+        if (!mTtff.ttffMs) mTtff.searchEpochs++;
+        return;
+    }
+    if (!mTtff.ttffMs) mTtff.ttffMs = max((uint32_t)millis() - mInitMs, (uint32_t)1);
+    if (!mEpoch.date) return;  // no UTC yet
+    const uint32_t date = mEpoch.date;
+    const uint32_t utc = (uint32_t)CivilDays(2000 + date % 100, date / 100 % 100, date / 10000) * 86400 +
+                         mEpoch.timeMs / 1000;
+    if (!mTrackingSince) mTrackingSince = utc;
+    mWarm.utc = utc;
+    mWarm.latitude = mEpoch.latitude;
+    mWarm.longitude = mEpoch.longitude;
+    mWarm.altitudeM = mEpoch.altitudeMm / 1000;
+    if (utc - mTrackingSince >= GPS_ALMANAC_TRACK_S) mWarm.almanacUtc = utc;
+    if (mStateStore && (!mSavedUtc || (GPS_STATE_SAVE_INTERVAL_S && utc - mSavedUtc >= GPS_STATE_SAVE_INTERVAL_S)))
+        mStateDue = true;
+}
+
 /*!
     @brief Constructor when using I2C
     @param theWire Pointer to an I2C object
 */
 Adafruit_GPS::Adafruit_GPS(i2c_inst_t *aI2cInstance) {
-    mCurrentLine = mLine1;
-    mLastline = mLine2;
-
 #ifdef NMEA_EXTENSIONS
     data_init();
 #endif
@@ -65,7 +184,7 @@ Adafruit_GPS::Adafruit_GPS(i2c_inst_t *aI2cInstance) {
 */
 Adafruit_GPS::~Adafruit_GPS() {
 #ifdef NMEA_EXTENSIONS
-    for (int i = 0; i < (int)NMEA_MAX_INDEX; i++) removeHistory((nmea_index_t)i);  // to free any history mallocs
+    for (int i = 0; i < (int)NMEA_MAX_INDEX; i++) removeHistory((nmea_index_t)i);  // to return any history blocks
 #endif
 }
 
@@ -76,47 +195,171 @@ Adafruit_GPS::~Adafruit_GPS() {
     may overflow if there are frequent NMEA sentences. An 82 character NMEA
     sentence 10 times per second will require 820 calls per second, and
     once a loop() may not be enough. Check for newNMEAreceived() after at
-    least every 10 calls, or you may miss some short sentences.
+    least every 10 calls, or you may miss some short sentences. Prefer Poll(),
+    which does the same work for every pending byte in one call.
     @return The character that we received, or 0 if nothing was available
 */
 char Adafruit_GPS::ReadData(void) {
-    static uint32_t firstChar = 0;  // first character received in current sentence
-    uint32_t tStart = millis();     // as close as we can get to time char was sent
     char c = 0;
 
     if (mPaused || mNoComms) return c;
 
-    if (mI2c) {
-        if (mBuffIdx <= mBuffMax) {
-            c = mI2cBuffer[mBuffIdx];
-            mBuffIdx++;
-        } else {
-            uint8_t buffer[GPS_MAX_I2C_TRANSFER];
-            int bytes_read = i2c_read_blocking(mI2c, mI2cAddress, buffer, GPS_MAX_I2C_TRANSFER, false);
-
-            if (bytes_read == GPS_MAX_I2C_TRANSFER) {
-                // Got data!
-                mBuffMax = 0;
-                char curr_char = 0;
-                for (int i = 0; i < GPS_MAX_I2C_TRANSFER; i++) {
-                    curr_char = buffer[i];
-                    if ((curr_char == 0x0A) && (mLastChar != 0x0D)) {
-                        // Skip duplicate 0x0A's - but keep as part of a CRLF
-                        continue;
-                    }
-                    mLastChar = curr_char;
-                    mI2cBuffer[mBuffMax] = curr_char;
-                    mBuffMax++;
-                }
-                mBuffMax--;  // Back up to the last valid slot
-                if ((mBuffMax == 0) && (mI2cBuffer[0] == 0x0A)) {
-                    mBuffMax = -1;  // Ahh there was nothing to read after all
-                }
-                mBuffIdx = 0;
+    if (mRxRing.Empty()) {
+        ServiceCommands();
+        if (mI2c) ReadI2cChunk(GPS_MAX_I2C_TRANSFER);
+        return c;
+    }
+
+    mRxRing.Pop(c);
+    if (mLocusDumping) FeedLocus(c, mRxUs / 1000);
+    if (AssembleChar(c, mRxUs)) {
+        mOutput.Count(mLineLen);
+        MatchReply();
+        PublishSentence();
+    }
+    return c;
+}
+
+/*!
+    @brief Pull everything the PA1010D has buffered into the receive ring.
+
+    The module answers an I2C read with its pending NMEA bytes followed by
+    0x0A padding once it runs dry, so we keep issuing large reads until a
+    read comes back short of real data or the ring is full.
+    @return Number of bytes added to the receive ring
+*/
+size_t Adafruit_GPS::DrainAvailable(void) {
+    size_t total = 0;
+
+    if (mPaused || mNoComms || !mI2c) return total;
+
+    while (true) {
+        size_t request = min(mRxRing.Free(), (size_t)GPS_MAX_I2C_DRAIN);
+        if (request == 0) break;  // ring is full, leave the rest in the module
+        size_t stored = ReadI2cChunk(request);
+        total += stored;
+        if (stored < request) break;  // padding seen, the module has nothing more
+    }
+    return total;
+}
+
+/*!
+    @brief Drain the GPS device and assemble every complete sentence in one pass.
+
+    Replaces calling ReadData() once per character. Each finished sentence is
+    handed to onSentence if given, otherwise it is queued for
+    NewNMEAreceived()/LastNMEA() and TryPopSentence(). Queued PMTK commands
+    are sent, matched to their acknowledgements and retried from here.
+    @param onSentence Optional callback run for every complete sentence
+    @param ctx Opaque pointer passed through to onSentence
+    @return Number of complete sentences assembled
+*/
+uint16_t Adafruit_GPS::Poll(nmea_sentence_cb_t onSentence, void *ctx) {
+    uint16_t sentences = 0;
+
+    if (mPaused || mNoComms) return sentences;
+
+    ServiceCommands();
+    sentences += AssembleRx(onSentence, ctx);  // what ReadData() or Inject() left
+
+    // as DrainAvailable(), but each read is assembled before the next so its bytes keep their own time stamp,
+    // and a ring's worth at most, so a module that keeps sending cannot hold us here
+    for (size_t total = 0; mI2c && total < GPS_RX_RING_SIZE;) {
+        size_t request = min(mRxRing.Free(), (size_t)GPS_MAX_I2C_DRAIN);
+        if (request == 0) break;  // ring is full, leave the rest in the module
+        size_t stored = ReadI2cChunk(request);
+        total += stored;
+        sentences += AssembleRx(onSentence, ctx);
+        if (stored < request) break;  // padding seen, the module has nothing more
+    }
+    ServiceCommands();  // the next command can go as soon as the last one is acknowledged
+    return sentences;
+}
+
+/*!
+    @brief Assemble every byte in the receive ring, all stamped with the
+    time they were read
+    @param onSentence Optional callback run for every complete sentence
+    @param ctx Opaque pointer passed through to onSentence
+    @return Number of complete sentences assembled
+*/
+uint16_t Adafruit_GPS::AssembleRx(nmea_sentence_cb_t onSentence, void *ctx) {
+    uint16_t sentences = 0;
+    const uint64_t tUs = mRxUs;
+    char c;
+    while (mRxRing.Pop(c)) {
+        if (mLocusDumping) FeedLocus(c, tUs / 1000);
+        if (AssembleChar(c, tUs)) {
+            sentences++;
+            mOutput.Count(mLineLen);
+            MatchReply();
+            if (onSentence) {
+                mParseStamp = mLineStamp;  // the callback parses right here, in this context
+                onSentence(mCurrentLine, mLineLen, ctx);
+            } else {
+                PublishSentence();
             }
-            return c;
         }
     }
+    return sentences;
+}
+
+/*!
+    @brief Push raw NMEA bytes obtained some other way (UART DMA, a log file
+    replay) into the receive ring. They are assembled by the next Poll() or
+    ReadData() calls exactly like bytes read from the bus, stamped with the
+    time they were injected.
+    @param data Pointer to the bytes
+    @param len Number of bytes
+    @return Number of bytes accepted, less than len if the ring is full
+*/
+size_t Adafruit_GPS::Inject(const char *data, size_t len) {
+    mRxUs = time_us_64();
+    return mRxRing.Write(data, len);
+}
+
+/*!
+    @brief Number of received bytes still waiting in the receive ring
+    @return Pending byte count
+*/
+size_t Adafruit_GPS::Available(void) { return mRxRing.Size(); }
+
+/*!
+    @brief Issue one I2C read and move the real NMEA bytes into the receive ring.
+    @param len Number of bytes to read, must not exceed the free ring space
+    @return Number of bytes stored, padding bytes are dropped
+*/
+size_t Adafruit_GPS::ReadI2cChunk(size_t len) {
+    uint8_t buffer[GPS_MAX_I2C_DRAIN];
+    len = min(len, sizeof(buffer));
+    mRxUs = time_us_64();  // the module already held what this read returns, or most of it
+    int bytes_read = i2c_read_blocking(mI2c, mI2cAddress, buffer, len, false);
+    if (bytes_read != (int)len) return 0;
+
+    char data[GPS_MAX_I2C_DRAIN];
+    size_t stored = 0;
+    for (size_t i = 0; i < len; i++) {
+        char curr_char = buffer[i];
+        if ((curr_char == 0x0A) && (mLastChar != 0x0D)) {
+            // Skip duplicate 0x0A's - but keep as part of a CRLF
+            continue;
+        }
+        mLastChar = curr_char;
+        data[stored++] = curr_char;
+    }
+    return mRxRing.Write(data, stored);
+}
+
+/*!
+    @brief Append one received character to the current line.
+    @param c The character
+    @param tUs time_us_64() when the character was read from the device
+    @return True if c completed a sentence. The terminated sentence stays in
+    mCurrentLine, and its stamps in mLineStamp, until the next character is
+    assembled.
+*/
+bool Adafruit_GPS::AssembleChar(char c, uint64_t tUs) {
+    if (mLineidx == 0) mLineStamp.firstUs = tUs;  // first character of the sentence
 
     mCurrentLine[mLineidx] = c;
     mLineidx = mLineidx + 1;
@@ -125,27 +368,23 @@ char Adafruit_GPS::ReadData(void) {
 
     if (c == '\n') {
         mCurrentLine[mLineidx] = 0;
-
-        if (mCurrentLine == mLine1) {
-            mCurrentLine = mLine2;
-            mLastline = mLine1;
-        } else {
-            mCurrentLine = mLine1;
-            mLastline = mLine2;
-        }
-
+        mLineLen = mLineidx;
         mLineidx = 0;
-        mRecvdflag = true;
-        mRecvdTime = millis();  // time we got the end of the string
-        mSentTime = firstChar;
-        firstChar = 0;  // there are no characters yet
-        return c;       // wait until next character to set time
+        mLineStamp.lastUs = tUs;
+        mRecvdTime = tUs / 1000;  // time we got the end of the string
+        mSentTime = mLineStamp.firstUs / 1000;
+        return true;
     }
-
-    if (firstChar == 0) firstChar = tStart;
-    return c;
+    return false;
 }
 
+/*!
+    @brief Queue the sentence AssembleChar() just completed for the application.
+    If every slot is still waiting to be read the sentence is dropped and
+    counted in DroppedSentences().
+*/
+void Adafruit_GPS::PublishSentence(void) { mSentences.Push(mCurrentLine, mLineLen, mLineStamp); }
+
 /*!
     @brief Send a command to the GPS device
     @param str Pointer to a string holding the command to send
@@ -155,10 +394,153 @@ void Adafruit_GPS::SendCommand(const uint8_t *str, uint8_t len) {
 }
 
 /*!
-    @brief Check to see if a new NMEA line has been received
+    @brief Queue a PMTK command without waiting for it. Poll() or ReadData()
+    send it once the commands ahead of it are acknowledged, match the
+    $PMTK001,<cmd>,<flag> that answers it and send it again if the answer is
+    late, so parsing never stops for a configuration change. The queue takes a
+    single producer: only ever queue from one context, the application's,
+    which may be the other core from Poll(). The rate changes Parse() decides
+    on go through a queue of their own.
+    @param cmd The command, e.g. PMTK_SET_NMEA_UPDATE_5HZ, the checksum and CR LF
+    are added
+    @param done Optional callback, run from Poll() or ReadData() when the command
+    completes
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), 0 if GPS_PMTK_QUEUE_SLOTS commands are
+    already waiting or the command is longer than GPS_PMTK_COMMAND_SIZE
+*/
+uint16_t Adafruit_GPS::QueueCommand(const char *cmd, pmtk_done_cb_t done, void *ctx) {
+    return mCommands.Push(cmd, done, ctx);
+}
+
+/*!
+    @brief Where a queued command has got to, for polling instead of a callback
+    @param ticket From QueueCommand()
+    @return PMTK_RESULT_QUEUED or PMTK_RESULT_SENT while pending, then the flag
+    of the acknowledgement or PMTK_RESULT_TIMEOUT
+*/
+pmtk_result_t Adafruit_GPS::CommandResult(uint16_t ticket) { return mCommands.Result(ticket); }
+
+/*!
+    @brief Number of queued commands not completed yet, the rate changes of
+    SetRatePolicy() included
+    @return Commands waiting to be sent or acknowledged
+*/
+size_t Adafruit_GPS::CommandsPending(void) { return mCommands.Size() + mRateCommands.Size(); }
+
+/*!
+    @brief Change how patient the command queue is, e.g. for the long erase of
+    PMTK_LOCUS_ERASE_FLASH. Applies from the next send.
+    @param timeoutMs How long to wait for an acknowledgement before sending again
+    @param retries How many times to send again before PMTK_RESULT_TIMEOUT
+*/
+void Adafruit_GPS::SetCommandTimeout(uint16_t timeoutMs, uint8_t retries) {
+    mCommands.SetTimeout(timeoutMs, retries);
+    mRateCommands.SetTimeout(timeoutMs, retries);
+}
+
+/*!
+    @brief Send whatever the command queues and the EPO upload say is due, a new
+    command or record, or a retry. The queue being serviced keeps its turn
+    until it is empty, so only one command is in flight and an
+    acknowledgement cannot be claimed by the wrong queue.
+*/
+void Adafruit_GPS::ServiceCommands(void) {
+    size_t len;
+    if ((mRateTurn ? mRateCommands : mCommands).Empty()) mRateTurn = !mRateCommands.Empty();
+    CommandQueue &commands = mRateTurn ? mRateCommands : mCommands;
+    if (!commands.Empty()) {
+        const char *cmd = commands.Due(millis(), &len);
+        if (cmd && mI2c) SendCommand(reinterpret_cast<const uint8_t *>(cmd), len);
+    }
+    if (mEpo.Active()) {
+        const char *record = mEpo.Due(millis(), &len);
+        if (record && mI2c) SendCommand(reinterpret_cast<const uint8_t *>(record), len);
+    }
+}
+
+/*!
+    @brief Match the sentence AssembleChar() just completed against what was
+    sent: the command in flight, the EPO record in flight or a logger status
+*/
+void Adafruit_GPS::MatchReply(void) {
+    if (mCurrentLine[1] != 'P' || mCommands.Acknowledge(mCurrentLine) || mRateCommands.Acknowledge(mCurrentLine) ||
+        mEpo.Acknowledge(mCurrentLine))
+        return;
+    if (!strncmp(mCurrentLine, "$PMTKLOG,", 9)) {
+        ParseLocusStatus(mCurrentLine);
+        mCommands.Acknowledge("$PMTK001,183,3");  // the status is the answer to PMTK_LOCUS_QUERY_STATUS
+    }
+}
+
+/*!
+    @brief Hand a received character to the LOCUS dump reader
+    @param c The character
+    @param nowMs millis() when it was read
+*/
+void Adafruit_GPS::FeedLocus(char c, uint32_t nowMs) {
+    if (!mLocus.Put(c)) return;
+    mCommands.Touch(nowMs);  // the dump is still coming, do not ask for it again
+    if (mLocus.Done()) mLocusDumping = false;
+}
+
+/*!
+    @brief Check to see if a new NMEA line has been received. Takes the oldest
+    queued sentence so that LastNMEA() returns it until the next call here.
     @return True if received, false if not
 */
-bool Adafruit_GPS::NewNMEAreceived(void) { return mRecvdflag; }
+bool Adafruit_GPS::NewNMEAreceived(void) {
+    if (!mRecvdflag && mSentences.TryPop(mLastline, sizeof(mLastline), &mLastlineStamp)) mRecvdflag = true;
+    return mRecvdflag;
+}
+
+/*!
+    @brief Take the oldest complete sentence off the queue. Safe to call from
+    core 0 while ReadData() or Poll() run in an interrupt or on core 1.
+    Do not mix with NewNMEAreceived()/LastNMEA() in the same consumer.
+    @param buff Buffer for the terminated sentence
+    @param size Capacity of buff, MAXLINELENGTH always fits
+    @param stamp Optional, filled with when the sentence was read, for
+    Parse(buff, len, stamp)
+    @return Length of the sentence copied, 0 if none is waiting
+*/
+size_t Adafruit_GPS::TryPopSentence(char *buff, size_t size, nmea_stamp_t *stamp) {
+    return mSentences.TryPop(buff, size, stamp);
+}
+
+/*!
+    @brief When the sentence LastNMEA() returns was read. Pass it to
+    Parse(LastNMEA(), &SentenceStamp()) so the epoch the sentence opens gets
+    it, see gps_fix_t::receivedUs. Inside the onSentence callback of Poll()
+    Parse() picks up the stamps of the sentence by itself.
+    @return time_us_64() of its first and last byte
+*/
+const nmea_stamp_t &Adafruit_GPS::SentenceStamp(void) { return mLastlineStamp; }
+
+/*!
+    @brief Offset and drift of the local clock against the UTC of the
+    epochs with a fix, fitted from the time their first byte was read. Use
+    ToLocal() to place a fix on the time_us_64() clock, or ToUtc() to give an
+    IMU sample a UTC time; without a PPS pin to within the jitter of the
+    earliest arrivals, a few milliseconds when Poll() runs often. Read it
+    from the context that parses.
+    @return The estimator
+*/
+const ClockEstimator &Adafruit_GPS::ClockSync(void) { return mClock; }
+
+/*!
+    @brief Sentences lost because the application fell behind by more than
+    GPS_SENTENCE_QUEUE_SLOTS sentences
+    @return Dropped sentence count since construction
+*/
+uint32_t Adafruit_GPS::DroppedSentences(void) { return mSentences.Dropped(); }
+
+/*!
+    @brief Deepest the sentence queue has been, useful to size
+    GPS_SENTENCE_QUEUE_SLOTS for an application
+    @return Maximum number of sentences waiting at once
+*/
+uint8_t Adafruit_GPS::SentenceHighWater(void) { return mSentences.HighWater(); }
 
 /*!
     @brief Pause/unpause receiving new data
@@ -172,7 +554,7 @@ void Adafruit_GPS::Pause(bool p) { mPaused = p; }
 */
 char *Adafruit_GPS::LastNMEA(void) {
     mRecvdflag = false;
-    return (char *)mLastline;
+    return mLastline;
 }
 
 /*!
@@ -202,41 +584,58 @@ bool Adafruit_GPS::WaitForSentence(const char *wait4me, uint8_t max, bool usingI
 }
 
 /*!
-    @brief Start the LOCUS logger
-    @return True on success, false if it failed
+    @brief Start the LOCUS logger. Queued like QueueCommand(), so parsing goes
+    on while the module answers.
+    @param done Optional callback, run when the module acknowledges
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), 0 if the command queue is full
 */
-bool Adafruit_GPS::LOCUS_StartLogger(void) {
-    SendCommand(reinterpret_cast<const uint8_t *>(PMTK_LOCUS_STARTLOG), strlen(PMTK_LOCUS_STARTLOG));
-    mRecvdflag = false;
-    return WaitForSentence(PMTK_LOCUS_STARTSTOPACK);
+uint16_t Adafruit_GPS::LOCUS_StartLogger(pmtk_done_cb_t done, void *ctx) {
+    return QueueCommand(PMTK_LOCUS_STARTLOG, done, ctx);
 }
 
 /*!
-    @brief Stop the LOCUS logger
-    @return True on success, false if it failed
+    @brief Stop the LOCUS logger. Queued like QueueCommand(), so parsing goes
+    on while the module answers.
+    @param done Optional callback, run when the module acknowledges
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), 0 if the command queue is full
 */
-bool Adafruit_GPS::LOCUS_StopLogger(void) {
-    SendCommand(reinterpret_cast<const uint8_t *>(PMTK_LOCUS_STOPLOG), strlen(PMTK_LOCUS_STOPLOG));
-    mRecvdflag = false;
-    return WaitForSentence(PMTK_LOCUS_STARTSTOPACK);
+uint16_t Adafruit_GPS::LOCUS_StopLogger(pmtk_done_cb_t done, void *ctx) {
+    return QueueCommand(PMTK_LOCUS_STOPLOG, done, ctx);
 }
 
 /*!
-    @brief Read the logger status
-    @return True if we read the data, false if there was no response
+    @brief Ask for the logger status. Poll() or ReadData() pick the $PMTKLOG
+    answer out of the received sentences, so parsing goes on meanwhile, and the
+    command completes with PMTK_RESULT_SUCCESS once LOCUS_Status() holds it.
+    @param done Optional callback, run when the status has arrived or the
+    module did not answer
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), 0 if the command queue is full
 */
-bool Adafruit_GPS::LOCUS_ReadStatus(void) {
-    SendCommand(reinterpret_cast<const uint8_t *>(PMTK_LOCUS_QUERY_STATUS), strlen(PMTK_LOCUS_QUERY_STATUS));
+uint16_t Adafruit_GPS::LOCUS_ReadStatus(pmtk_done_cb_t done, void *ctx) {
+    return QueueCommand(PMTK_LOCUS_QUERY_STATUS, done, ctx);
+}
 
-    if (!WaitForSentence("$PMTKLOG")) return false;
+/*!
+    @brief The logger status last received, safe to call from any core
+    @param out Filled with the status
+    @return False if no status has arrived since construction
+*/
+bool Adafruit_GPS::LOCUS_Status(locus_status_t *out) const { return mLocusStatus.Read(out); }
 
-    char *response = LastNMEA();
+/*!
+    @brief Decode a $PMTKLOG status line and publish it for LOCUS_Status()
+    @param line The sentence
+*/
+void Adafruit_GPS::ParseLocusStatus(const char *line) {
     uint16_t parsed[10];
     uint8_t i;
 
     for (i = 0; i < 10; i++) parsed[i] = -1;
 
-    response = strchr(response, ',');
+    const char *response = strchr(line, ',');
     for (i = 0; i < 10; i++) {
         if (!response || (response[0] == 0) || (response[0] == '*')) break;
         response++;
@@ -251,21 +650,139 @@ bool Adafruit_GPS::LOCUS_ReadStatus(void) {
             response++;
         }
     }
-    mLOCUS_serial = parsed[0];
-    mLOCUS_type = parsed[1];
+    locus_status_t status;
+    status.serial = parsed[0];
+    status.type = parsed[1];
     if (isalpha(parsed[2])) {
         parsed[2] = parsed[2] - 'a' + 10;
     }
-    mLOCUS_mode = parsed[2];
-    mLOCUS_config = parsed[3];
-    mLOCUS_interval = parsed[4];
-    mLOCUS_distance = parsed[5];
-    mLOCUS_speed = parsed[6];
-    mLOCUS_status = !parsed[7];
-    mLOCUS_records = parsed[8];
-    mLOCUS_percent = parsed[9];
+    status.mode = parsed[2];
+    status.config = parsed[3];
+    status.interval = parsed[4];
+    status.distance = parsed[5];
+    status.speed = parsed[6];
+    status.status = !parsed[7];
+    status.records = parsed[8];
+    status.percent = parsed[9];
+    mLocusStatus.Write(status);
+}
 
-    return true;
+/*!
+    @brief Download the whole LOCUS log. Queues PMTK_LOCUS_DUMP, then Poll() or
+    ReadData() decode the $PMTKLOX lines as they arrive and hand every valid
+    record to onRecord, so the log never has to fit in memory. Parsing goes on
+    meanwhile. See LocusReader for what is checked.
+    @param onRecord Called for every valid record, from Poll() or ReadData()
+    @param ctx Opaque pointer passed through to onRecord
+    @return Ticket of the dump command for CommandResult(), 0 if the command
+    queue is full
+*/
+uint16_t Adafruit_GPS::LOCUS_StartDump(locus_record_cb_t onRecord, void *ctx) {
+    const uint16_t ticket = QueueCommand(PMTK_LOCUS_DUMP);
+    if (!ticket) return 0;
+    mLocus.Begin(onRecord, ctx);
+    mLocusDumping = true;
+    return ticket;
+}
+
+/*!
+    @brief Check whether a dump started with LOCUS_StartDump() has ended
+    @return True once $PMTKLOX,2 arrived
+*/
+bool Adafruit_GPS::LOCUS_DumpDone(void) { return mLocus.Done(); }
+
+/*!
+    @brief Counters of the last dump, lines and records that were good, lost or bad
+    @return The counters, updated as the dump arrives
+*/
+const locus_dump_stats_t &Adafruit_GPS::LOCUS_DumpStats(void) { return mLocus.Stats(); }
+
+/*!
+    @brief Upload EPO orbit predictions so a cold start gets its first fix in
+    seconds rather than after the half a minute or more it takes to download the
+    ephemeris from the sky. Poll() or ReadData() send one $PMTK721 record at a
+    time, each once the last is acknowledged, so parsing goes on meanwhile and
+    the file is never held in memory. Follow with AidTime() and AidPosition().
+    See EpoLoader for the record format and the retries.
+    @param source The EPO file, e.g. an EpoMemorySource over a copy in flash.
+    Must stay valid until the upload completes.
+    @param gpsHour Now, see EpoGpsHour(), to skip the segments that are already
+    past. 0 uploads from the start of the file.
+    @param segments Six hour segments to upload, 0 for the rest of the file
+    @return False if the file is not an EPO file or is out of date
+*/
+bool Adafruit_GPS::EPO_StartUpload(EpoSource &source, uint32_t gpsHour, uint16_t segments) {
+    return mEpo.Begin(source, gpsHour, segments);
+}
+
+/*!
+    @brief Where an upload started with EPO_StartUpload() has got to
+    @return PMTK_RESULT_QUEUED or PMTK_RESULT_SENT while uploading,
+    PMTK_RESULT_SUCCESS once every record is acknowledged, or how it failed
+*/
+pmtk_result_t Adafruit_GPS::EPO_UploadResult(void) { return mEpo.Result(); }
+
+/*!
+    @brief Counters of the last upload, records acknowledged, skipped and sent again
+    @return The counters, updated as the upload goes on
+*/
+const epo_upload_stats_t &Adafruit_GPS::EPO_UploadStats(void) { return mEpo.Stats(); }
+
+/*!
+    @brief Stop an upload, the module keeps the records it has acknowledged
+*/
+void Adafruit_GPS::EPO_CancelUpload(void) { mEpo.Cancel(); }
+
+/*!
+    @brief Tell the module the UTC time, $PMTK740, so it can use EPO data
+    before it has decoded the time from a satellite
+    @param year Four digit year
+    @param month 1 to 12
+    @param day 1 to 31
+    @param hour 0 to 23
+    @param minute 0 to 59
+    @param second 0 to 59
+    @param done Optional callback, run when the module acknowledges
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), 0 if the command queue is full
+*/
+uint16_t Adafruit_GPS::AidTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute,
+                               uint8_t second, pmtk_done_cb_t done, void *ctx) {
+    char cmd[GPS_PMTK_COMMAND_SIZE];
+    NmeaWriter w(cmd, sizeof(cmd));
+    w.Begin("PMTK", "740").Uint(year).Comma().Uint(month).Comma().Uint(day).Comma();
+    w.Uint(hour).Comma().Uint(minute).Comma().Uint(second);
+    if (!w.Finish(false)) return 0;
+    return QueueCommand(cmd, done, ctx);
+}
+
+/*!
+    @brief Tell the module roughly where it is and when, $PMTK741, so it only
+    searches for the satellites EPO says are above it. A position from the last
+    fix before power down is good enough.
+    @param latitude Degrees * 10000000, negative south, as in gps_fix_t
+    @param longitude Degrees * 10000000, negative west
+    @param altitudeM Height in metres
+    @param year Four digit year
+    @param month 1 to 12
+    @param day 1 to 31
+    @param hour 0 to 23
+    @param minute 0 to 59
+    @param second 0 to 59
+    @param done Optional callback, run when the module acknowledges
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), 0 if the command queue is full
+*/
+uint16_t Adafruit_GPS::AidPosition(int32_t latitude, int32_t longitude, int32_t altitudeM, uint16_t year,
+                                   uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second,
+                                   pmtk_done_cb_t done, void *ctx) {
+    char cmd[GPS_PMTK_COMMAND_SIZE];
+    NmeaWriter w(cmd, sizeof(cmd));
+    w.Begin("PMTK", "741").Fixed(latitude, 7).Comma().Fixed(longitude, 7).Comma().Fixed(altitudeM, 0).Comma();
+    w.Uint(year).Comma().Uint(month).Comma().Uint(day).Comma();
+    w.Uint(hour).Comma().Uint(minute).Comma().Uint(second);
+    if (!w.Finish(false)) return 0;
+    return QueueCommand(cmd, done, ctx);
 }
 
 /*!
@@ -287,18 +804,19 @@ bool Adafruit_GPS::Standby(void) {
 }
 
 /*!
-    @brief Wake the sensor up
-    @return True if woken up, false if not in Standby or failed to wake
+    @brief Wake the sensor up. Any byte wakes it, so the PMTK_TEST packet is
+    queued like QueueCommand() and sent again until the module, awake,
+    acknowledges it; parsing goes on meanwhile.
+    @param done Optional callback, run when the module answers or did not wake
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), PMTK_RESULT_SUCCESS once awake. 0 if
+    not in Standby, nothing to wake up, or the command queue is full.
 */
-bool Adafruit_GPS::Wakeup(void) {
-    if (mInStandbyMode) {
-        mInStandbyMode = false;
-        // send byte to wake it up
-        SendCommand(reinterpret_cast<const uint8_t *>(" "), 1);
-        return WaitForSentence(PMTK_AWAKE);
-    } else {
-        return false;  // Returns false if not in Standby mode, nothing to Wakeup
-    }
+uint16_t Adafruit_GPS::Wakeup(pmtk_done_cb_t done, void *ctx) {
+    if (!mInStandbyMode) return 0;
+    const uint16_t ticket = QueueCommand(PMTK_TEST, done, ctx);
+    if (ticket) mInStandbyMode = false;
+    return ticket;
 }
 
 /*!
@@ -330,4 +848,276 @@ nmea_float_t Adafruit_GPS::SecondsSinceDate() { return (millis() - mLastDate) /
     @brief Fakes time of receipt of a sentence. Use between build() and parse()
     to make the timing look like the sentence arrived from the GPS.
 */
-void Adafruit_GPS::ResetSentTime() { mSentTime = millis(); }
\ No newline at end of file
+void Adafruit_GPS::ResetSentTime() { mSentTime = millis(); }
+
+/*!
+    @brief Latitude as received from the GPS. In the NMEA_FIXED_POINT build it is converted from mLatitude_fixed
+    on each call.
+    @return Latitude in degrees/minutes (DDMM.MMMM), unsigned
+*/
+nmea_float_t Adafruit_GPS::Latitude() {
+#ifdef NMEA_FIXED_POINT
+    uint32_t a = mLatitude_fixed < 0 ? -mLatitude_fixed : mLatitude_fixed;
+    return (a / 10000000) * 100 + (a % 10000000) * (nmea_float_t)60 / 10000000;
+#else
+    return mLatitude;
+#endif
+}
+
+/*!
+    @brief Longitude as received from the GPS. In the NMEA_FIXED_POINT build it is converted from mLongitude_fixed
+    on each call.
+    @return Longitude in degrees/minutes (DDDMM.MMMM), unsigned
+*/
+nmea_float_t Adafruit_GPS::Longitude() {
+#ifdef NMEA_FIXED_POINT
+    uint32_t a = mLongitude_fixed < 0 ? -mLongitude_fixed : mLongitude_fixed;
+    return (a / 10000000) * 100 + (a % 10000000) * (nmea_float_t)60 / 10000000;
+#else
+    return mLongitude;
+#endif
+}
+
+/*!
+    @brief Latitude in decimal degrees
+    @return Latitude, negative in the southern hemisphere
+*/
+nmea_float_t Adafruit_GPS::LatitudeDegrees() {
+#ifdef NMEA_FIXED_POINT
+    return mLatitude_fixed / (nmea_float_t)10000000.;
+#else
+    return mLatitudeDegrees;
+#endif
+}
+
+/*!
+    @brief Longitude in decimal degrees
+    @return Longitude, negative in the western hemisphere
+*/
+nmea_float_t Adafruit_GPS::LongitudeDegrees() {
+#ifdef NMEA_FIXED_POINT
+    return mLongitude_fixed / (nmea_float_t)10000000.;
+#else
+    return mLongitudeDegrees;
+#endif
+}
+
+/*!
+    @brief Altitude above mean sea level
+    @return Altitude in meters
+*/
+nmea_float_t Adafruit_GPS::Altitude() {
+#ifdef NMEA_FIXED_POINT
+    return mAltitude_mm / (nmea_float_t)1000.;
+#else
+    return mAltitude;
+#endif
+}
+
+/*!
+    @brief Difference between geoid height and WGS84 height
+    @return Geoid height in meters
+*/
+nmea_float_t Adafruit_GPS::Geoidheight() {
+#ifdef NMEA_FIXED_POINT
+    return mGeoidheight_mm / (nmea_float_t)1000.;
+#else
+    return mGeoidheight;
+#endif
+}
+
+/*!
+    @brief Speed over ground
+    @return Speed in knots
+*/
+nmea_float_t Adafruit_GPS::Speed() {
+#ifdef NMEA_FIXED_POINT
+    return mSpeed_mms * (nmea_float_t)3.6 / (nmea_float_t)1852.;
+#else
+    return mSpeed;
+#endif
+}
+
+/*!
+    @brief Course over ground
+    @return Course in degrees from true north
+*/
+nmea_float_t Adafruit_GPS::Angle() {
+#ifdef NMEA_FIXED_POINT
+    return mAngle_cdeg / (nmea_float_t)100.;
+#else
+    return mAngle;
+#endif
+}
+
+/*!
+    @brief Horizontal Dilution of Precision
+    @return HDOP
+*/
+nmea_float_t Adafruit_GPS::HDOP() {
+#ifdef NMEA_FIXED_POINT
+    return mHDOP_x100 / (nmea_float_t)100.;
+#else
+    return mHDOP;
+#endif
+}
+
+/*!
+    @brief Vertical Dilution of Precision
+    @return VDOP
+*/
+nmea_float_t Adafruit_GPS::VDOP() {
+#ifdef NMEA_FIXED_POINT
+    return mVDOP_x100 / (nmea_float_t)100.;
+#else
+    return mVDOP;
+#endif
+}
+
+/*!
+    @brief Position Dilution of Precision
+    @return PDOP
+*/
+nmea_float_t Adafruit_GPS::PDOP() {
+#ifdef NMEA_FIXED_POINT
+    return mPDOP_x100 / (nmea_float_t)100.;
+#else
+    return mPDOP;
+#endif
+}
+
+/*!
+    @brief GPS time of day as a single integer, convenient for differences between fixes
+    @return Milliseconds since midnight GMT
+*/
+uint32_t Adafruit_GPS::MillisecondsOfDay() {
+    return ((mHour * 60UL + mMinute) * 60UL + mSeconds) * 1000UL + mMilliseconds;
+}
+
+/*!
+    @brief Copy the satellites in view from the last complete GSV group of every constellation
+    @param out Filled with the satellite table, see SatelliteSet
+*/
+void Adafruit_GPS::Satellites(gps_satellites_t *out) { mSatTable.Snapshot(out); }
+
+/*!
+    @brief Cheap check for new satellite data without copying the table
+    @return Counter bumped every time a GSV group completes
+*/
+uint32_t Adafruit_GPS::SatellitesGeneration() { return mSatTable.Generation(); }
+
+/*!
+    @brief Copy the last complete epoch. Lock free and safe to call from another core or a lower priority context
+    while Parse() runs, the copy never mixes two epochs.
+    @param out Filled with the fix
+    @return false if no epoch has been completed yet
+*/
+bool Adafruit_GPS::ReadFix(gps_fix_t *out) const { return mFixes.Read(out); }
+
+/*!
+    @brief Cheap check for a new epoch without copying it
+    @return Number of epochs published so far
+*/
+uint32_t Adafruit_GPS::FixSequence() const { return mFixes.Published(); }
+
+/*!
+    @brief Choose the sentences that complete an epoch, to match what the receiver was told to send with
+    PMTK_SET_NMEA_OUTPUT_*. An epoch missing one of them is still published, one cycle later, when the next time
+    stamp arrives.
+    @param mask GPS_EPOCH_ bits, GPS_EPOCH_DEFAULT for the PA1010D out of the box
+*/
+void Adafruit_GPS::SetEpochSentences(uint8_t mask) { mEpochExpect = mask ? mask : GPS_EPOCH_DEFAULT; }
+
+/*!
+    @brief Have the module send only the sentences that carry what the
+    application reads, with $PMTK314, and complete epochs on those. See
+    OutputController::SentencesFor(). While a rate policy is set RMC is kept
+    for its speed over ground.
+    @param wants GPS_WANT_ bits
+    @param done Optional callback, run when the module acknowledges
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), 0 if the command queue is full
+*/
+uint16_t Adafruit_GPS::Subscribe(uint8_t wants, pmtk_done_cb_t done, void *ctx) {
+    mWants = wants;
+    return QueueOutput(mCommands, mOutput.Stats().periodMs, done, ctx);
+}
+
+/*!
+    @brief Follow the speed over ground with the update rate, $PMTK220, and
+    the baud rate, $PMTK251, within a byte budget. A faster rate is asked for
+    on the first epoch that calls for it, a slower one after
+    gps_rate_policy_t::holdEpochs epochs. Over I2C, as on the PA1010D
+    breakout, the baud rate only applies to the module's UART pins.
+    @param policy The policy, copied, kGpsRatePolicyDefault for a start. NULL
+    leaves the rate where it is.
+*/
+void Adafruit_GPS::SetRatePolicy(const gps_rate_policy_t *policy) {
+    const bool needsRmc = policy && !mOutput.Adaptive();
+    mOutput.SetPolicy(policy);
+    if (needsRmc && mOutput.Stats().sentences && !(mOutput.Stats().sentences & GPS_NMEA_RMC))
+        QueueOutput(mCommands, mOutput.Stats().periodMs);
+}
+
+/*!
+    @brief Sentences, update rate and baud rate asked for so far, with the
+    bytes per second they should produce and those actually received
+    @return The settings and counters
+*/
+const gps_output_stats_t &Adafruit_GPS::OutputStats(void) { return mOutput.Stats(); }
+
+/*!
+    @brief Queue $PMTK314 for the subscribed sentences at an update period
+    and expect those in every epoch
+    @param queue mCommands from the application, mRateCommands from Parse()
+    @param periodMs Update period, for how often GSV goes out
+    @param done Optional callback, run when the module acknowledges
+    @param ctx Opaque pointer passed through to done
+    @return Ticket for CommandResult(), 0 if the command queue is full
+*/
+uint16_t Adafruit_GPS::QueueOutput(CommandQueue &queue, uint16_t periodMs, pmtk_done_cb_t done, void *ctx) {
+    uint8_t sentences = OutputController::SentencesFor(mWants);
+    if (mOutput.Adaptive()) sentences |= GPS_NMEA_RMC;
+    char cmd[GPS_PMTK_COMMAND_SIZE];
+    if (!OutputController::Pmtk314(cmd, sizeof(cmd), sentences, OutputController::GsvEvery(periodMs))) return 0;
+    const uint16_t ticket = queue.Push(cmd, done, ctx);
+    if (!ticket) return 0;
+    mOutput.Commit(sentences, periodMs, 0);
+    SetEpochSentences((sentences & GPS_NMEA_GGA ? GPS_EPOCH_GGA : 0) | (sentences & GPS_NMEA_RMC ? GPS_EPOCH_RMC : 0) |
+                      (sentences & GPS_NMEA_GLL ? GPS_EPOCH_GLL : 0) | (sentences & GPS_NMEA_GSA ? GPS_EPOCH_GSA : 0));
+    return ticket;
+}
+
+/*!
+    @brief Let the rate policy see the published epoch and queue the commands
+    for a new update period, and baud rate if it follows. Called by Parse()
+    for every published epoch, so they go to mRateCommands, which Parse() is
+    the only producer of, never to the application's queue. When it has no
+    room the change waits for a later epoch.
+*/
+void Adafruit_GPS::AdaptOutput(void) {
+    const uint16_t periodMs = mOutput.Epoch(mEpoch.timeMs, mEpoch.fix, mEpoch.speedMms);
+    if (!periodMs || GPS_PMTK_QUEUE_SLOTS - mRateCommands.Size() < 3) return;
+
+    const gps_output_stats_t &stats = mOutput.Stats();
+    char cmd[GPS_PMTK_COMMAND_SIZE];
+    NmeaWriter w(cmd, sizeof(cmd));
+    w.Begin("PMTK", "220").Uint(periodMs);
+    if (!w.Finish(false) || !mRateCommands.Push(cmd)) return;
+    if ((stats.sentences & GPS_NMEA_GSV) && OutputController::GsvEvery(periodMs) != stats.gsvEvery)
+        QueueOutput(mRateCommands, periodMs);
+
+    uint32_t baud = 0;
+    if (mOutput.Policy().adjustBaud) {
+        baud = OutputController::BaudFor(OutputController::Estimate(stats.sentences, periodMs,
+                                                                    OutputController::GsvEvery(periodMs)));
+        if (baud == stats.baud) {
+            baud = 0;
+        } else {
+            NmeaWriter b(cmd, sizeof(cmd));
+            b.Begin("PMTK", "251").Uint(baud);
+            if (!b.Finish(false) || !mRateCommands.Push(cmd)) baud = 0;
+        }
+    }
+    mOutput.Commit(stats.sentences, periodMs, baud);
+}
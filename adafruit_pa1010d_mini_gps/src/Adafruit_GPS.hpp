@@ -34,15 +34,67 @@
 
 #include <Adafruit_PMTK.hpp>
 #include <NMEA_data.hpp>
+#include <NMEA_fields.hpp>
+#include <NMEA_writer.hpp>
 
+#include "clock_estimator.hpp"
+#include "epo_loader.hpp"
+#include "gps_state.hpp"
+#include "history_pool.hpp"
 #include "i2c_wrapper.hpp"
+#include "locus_reader.hpp"
+#include "output_controller.hpp"
+#include "pmtk_queue.hpp"
+#include "ring_buffer.hpp"
+#include "satellite_table.hpp"
+#include "sentence_queue.hpp"
+#include "seqlock.hpp"
+#include "smoothing.hpp"
 #ifndef BUILD_FOR_HOST
 #include "pico/stdlib.h"
 #endif
 
 #define NMEA_EXTENSIONS
+// #define NMEA_FIXED_POINT  ///< parse GGA, RMC, GLL and GSA with integers only, the float values become accessors
 
 #define GPS_MAX_I2C_TRANSFER 32  ///< The max number of bytes we'll try to read at once
+#define GPS_MAX_I2C_DRAIN 255    ///< The max number of bytes DrainAvailable() reads per I2C transaction
+#ifndef GPS_RX_RING_SIZE
+#define GPS_RX_RING_SIZE 1024  ///< receive ring capacity in bytes, must be a power of two
+#endif
+#ifndef GPS_SENTENCE_QUEUE_SLOTS
+#define GPS_SENTENCE_QUEUE_SLOTS 8  ///< complete sentences held for the application, must be a power of two
+#endif
+#ifndef GPS_MAX_SATELLITES_PER_SYSTEM
+#define GPS_MAX_SATELLITES_PER_SYSTEM 16  ///< satellites kept per constellation from GSV, extra ones are dropped
+#endif
+#ifndef GPS_HISTORY_BLOCKS
+#define GPS_HISTORY_BLOCKS 4  ///< data values that can have a history at once, see initHistory()
+#endif
+#ifndef GPS_HISTORY_VALUES
+#define GPS_HISTORY_VALUES 192  ///< most samples one history holds, larger historyN is clamped to this
+#endif
+#ifndef GPS_FILTER_SLOTS
+#define GPS_FILTER_SLOTS 4  ///< data values that can have an alpha-beta or median filter at once, see initFilter()
+#endif
+#ifndef GPS_PMTK_QUEUE_SLOTS
+#define GPS_PMTK_QUEUE_SLOTS 4  ///< PMTK commands QueueCommand() holds, must be a power of two
+#endif
+#ifndef GPS_PMTK_COMMAND_SIZE
+#define GPS_PMTK_COMMAND_SIZE 96  ///< longest queued PMTK command, including checksum and CR LF
+#endif
+#ifndef GPS_PMTK_ACK_TIMEOUT_MS
+#define GPS_PMTK_ACK_TIMEOUT_MS 1000  ///< how long a queued command waits for its $PMTK001 before it is sent again
+#endif
+#ifndef GPS_PMTK_RETRIES
+#define GPS_PMTK_RETRIES 2  ///< times a queued command is sent again before it fails with PMTK_RESULT_TIMEOUT
+#endif
+#ifndef GPS_STATE_SAVE_INTERVAL_S
+#define GPS_STATE_SAVE_INTERVAL_S 900  ///< GPS seconds between warm start snapshots while there is a fix, 0 for none
+#endif
+#ifndef GPS_ALMANAC_TRACK_S
+#define GPS_ALMANAC_TRACK_S 750  ///< seconds of continuous fix it takes to receive a whole almanac, 25 frames
+#endif
 #define MAXLINELENGTH 120        ///< how long are max NMEA lines to parse?
 #define NMEA_MAX_SENTENCE_ID 20  ///< maximum length of a sentence ID name, including terminating 0
 #define NMEA_MAX_SOURCE_ID 3     ///< maximum length of a source ID name, including terminating 0
@@ -58,6 +110,57 @@ typedef enum {
     NMEA_HAS_SENTENCE_P = 40  ///< has a recognized parseable sentence ID
 } nmea_check_t;
 
+#define NMEA_SENTENCE_HASH_BITS 7  ///< log2 of the slot count of the sentence dispatch hash
+
+class Adafruit_GPS;
+typedef bool (Adafruit_GPS::*nmea_handler_t)(const NmeaFields &f);  ///< parses the fields of one sentence type
+
+/// one row of the sentence dispatch table
+typedef struct {
+    uint32_t id;             ///< three letter sentence name packed into an integer, e.g. 'G' << 16 | 'G' << 8 | 'A'
+    nmea_handler_t handler;  ///< member that parses the fields, NULL if known but not parseable
+} nmea_sentence_t;
+
+/// perfect hash over the sentence dispatch table
+typedef struct {
+    uint32_t mult;                               ///< multiplier that leaves every row in its own slot
+    uint8_t slot[1 << NMEA_SENTENCE_HASH_BITS];  ///< table row + 1, or 0 for an empty slot
+} nmea_sentence_hash_t;
+
+#define GPS_EPOCH_GGA 0x01  ///< gps_fix_t::sentences bit, position, altitude, fix quality and satellites are fresh
+#define GPS_EPOCH_RMC 0x02  ///< gps_fix_t::sentences bit, position, speed, course and date are fresh
+#define GPS_EPOCH_GLL 0x04  ///< gps_fix_t::sentences bit, position is fresh
+#define GPS_EPOCH_GSA 0x08  ///< gps_fix_t::sentences bit, DOP and 3D fix are fresh
+#define GPS_EPOCH_DEFAULT (GPS_EPOCH_GGA | GPS_EPOCH_GSA | GPS_EPOCH_RMC)  ///< what the PA1010D sends every cycle
+
+/// everything the receiver reported for one time stamp, published as a whole by the epoch assembler
+typedef struct {
+    uint32_t sequence;    ///< number of the epoch since the parser was created, from 1
+    uint32_t timeMs;      ///< GPS time of day in milliseconds, the key the epoch was assembled on
+    uint64_t receivedUs;  ///< time_us_64() when the first byte of the epoch was read, 0 if not known
+    uint32_t date;        ///< ddmmyy from the last RMC, 0 if none yet
+    int32_t latitude;     ///< degrees * 10000000, negative south
+    int32_t longitude;    ///< degrees * 10000000, negative west
+    int32_t altitudeMm;   ///< altitude above MSL in millimetres
+    int32_t geoidMm;      ///< geoid height above WGS84 in millimetres
+    uint32_t speedMms;    ///< speed over ground in millimetres per second
+    uint16_t courseCdeg;  ///< course in hundredths of a degree
+    uint16_t hdopX100;    ///< horizontal dilution of precision times 100
+    uint16_t vdopX100;    ///< vertical dilution of precision times 100
+    uint16_t pdopX100;    ///< position dilution of precision times 100
+    bool fix;             ///< the receiver reported a fix
+    uint8_t fixQuality;   ///< 0 invalid, 1 GPS, 2 DGPS
+    uint8_t fix3d;        ///< 1 no fix, 2 2D, 3 3D from GSA
+    uint8_t satellites;   ///< satellites in use
+    uint8_t sentences;    ///< GPS_EPOCH_ bits of the sentences received in this epoch, other fields carry over
+} gps_fix_t;
+
+typedef SatelliteSet<GPS_MAX_SATELLITES_PER_SYSTEM> gps_satellites_t;  ///< satellites in view, see Satellites()
+
+/// callback run by Poll() for every complete sentence of len characters, e.g. for Parse(nmea, len); nmea is only
+/// valid for the duration of the call
+typedef void (*nmea_sentence_cb_t)(char *nmea, size_t len, void *ctx);
+
 class Adafruit_GPS {
    public:
     Adafruit_GPS(i2c_inst_t *aI2cInstance);
@@ -65,38 +168,111 @@ class Adafruit_GPS {
     virtual ~Adafruit_GPS();
 
     bool Init(uint32_t aI2cAddress);
+    void SetStateStore(GpsStateStore *store, gps_utc_cb_t utcNow = nullptr, void *ctx = nullptr);
+    bool SaveState(void);
+    bool StateDue(void);
+    const gps_warm_state_t &WarmState(void);
+    const gps_ttff_t &TimeToFirstFix(void);
 
     char ReadData(void);
+    size_t DrainAvailable(void);
+    uint16_t Poll(nmea_sentence_cb_t onSentence = nullptr, void *ctx = nullptr);
+    size_t Inject(const char *data, size_t len);
+    size_t Available(void);
     void SendCommand(const uint8_t *str, uint8_t len);
+    uint16_t QueueCommand(const char *cmd, pmtk_done_cb_t done = nullptr, void *ctx = nullptr);
+    pmtk_result_t CommandResult(uint16_t ticket);
+    size_t CommandsPending(void);
+    void SetCommandTimeout(uint16_t timeoutMs, uint8_t retries);
     bool NewNMEAreceived();
+    size_t TryPopSentence(char *buff, size_t size, nmea_stamp_t *stamp = nullptr);
+    const nmea_stamp_t &SentenceStamp(void);
+    const ClockEstimator &ClockSync(void);
+    uint32_t DroppedSentences(void);
+    uint8_t SentenceHighWater(void);
     void Pause(bool b);
     char *LastNMEA(void);
     bool WaitForSentence(const char *wait, uint8_t max = MAXWAITSENTENCE, bool usingInterrupts = false);
-    bool LOCUS_StartLogger(void);
-    bool LOCUS_StopLogger(void);
-    bool LOCUS_ReadStatus(void);
+    uint16_t LOCUS_StartLogger(pmtk_done_cb_t done = nullptr, void *ctx = nullptr);
+    uint16_t LOCUS_StopLogger(pmtk_done_cb_t done = nullptr, void *ctx = nullptr);
+    uint16_t LOCUS_ReadStatus(pmtk_done_cb_t done = nullptr, void *ctx = nullptr);
+    bool LOCUS_Status(locus_status_t *out) const;
+    uint16_t LOCUS_StartDump(locus_record_cb_t onRecord, void *ctx = nullptr);
+    bool LOCUS_DumpDone(void);
+    const locus_dump_stats_t &LOCUS_DumpStats(void);
+    bool EPO_StartUpload(EpoSource &source, uint32_t gpsHour = 0, uint16_t segments = 0);
+    pmtk_result_t EPO_UploadResult(void);
+    const epo_upload_stats_t &EPO_UploadStats(void);
+    void EPO_CancelUpload(void);
+    uint16_t AidTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second,
+                     pmtk_done_cb_t done = nullptr, void *ctx = nullptr);
+    uint16_t AidPosition(int32_t latitude, int32_t longitude, int32_t altitudeM, uint16_t year, uint8_t month,
+                         uint8_t day, uint8_t hour, uint8_t minute, uint8_t second, pmtk_done_cb_t done = nullptr,
+                         void *ctx = nullptr);
     bool Standby(void);
-    bool Wakeup(void);
+    uint16_t Wakeup(pmtk_done_cb_t done = nullptr, void *ctx = nullptr);
     nmea_float_t SecondsSinceFix();
     nmea_float_t SecondsSinceTime();
     nmea_float_t SecondsSinceDate();
     void ResetSentTime();
+    nmea_float_t Latitude();
+    nmea_float_t Longitude();
+    nmea_float_t LatitudeDegrees();
+    nmea_float_t LongitudeDegrees();
+    nmea_float_t Altitude();
+    nmea_float_t Geoidheight();
+    nmea_float_t Speed();
+    nmea_float_t Angle();
+    nmea_float_t HDOP();
+    nmea_float_t VDOP();
+    nmea_float_t PDOP();
+    uint32_t MillisecondsOfDay();
+    void Satellites(gps_satellites_t *out);
+    uint32_t SatellitesGeneration();
+    bool ReadFix(gps_fix_t *out) const;
+    uint32_t FixSequence() const;
+    void SetEpochSentences(uint8_t mask);
+    uint16_t Subscribe(uint8_t wants, pmtk_done_cb_t done = nullptr, void *ctx = nullptr);
+    void SetRatePolicy(const gps_rate_policy_t *policy);
+    const gps_output_stats_t &OutputStats(void);
 
     // NMEA_parse.cpp
-    bool Parse(char *);
+    bool Parse(char *nmea, const nmea_stamp_t *stamp = nullptr);
+    bool Parse(char *nmea, size_t len, const nmea_stamp_t *stamp = nullptr);
     bool Check(char *nmea);
+    bool Check(char *nmea, size_t len);
     bool OnList(char *nmea, const char **list);
     uint8_t ParseHex(char c);
 
     // NMEA_build.cpp
 #ifdef NMEA_EXTENSIONS
+    size_t Build(char *nmea, size_t size, const char *thisSource, const char *thisSentence, char ref = 'R',
+                 bool noCRLF = false);
+    size_t Build(NmeaSink &sink, const char *thisSource, const char *thisSentence, char ref = 'R',
+                 bool noCRLF = false);
     char *Build(char *nmea, const char *thisSource, const char *thisSentence, char ref = 'R', bool noCRLF = false);
 #endif
     void AddChecksum(char *buff);
 
     // NMEA_data.cpp
-    void NewDataValue(nmea_index_t tag, nmea_float_t v);
+    /*!
+        @brief Update the value and history information with a new value. Call whenever a new data value is
+        received. Inline so that for a value GPS_TRACKED_VALUES leaves out, or without the NMEA extensions, the
+        call compiles to nothing. Inside Parse() every value of the sentence shares one time stamp.
+        @param tag The data index for which a new value has been received
+        @param v The new value received
+    */
+    void NewDataValue(nmea_index_t tag, nmea_float_t v) {
+#ifdef NMEA_EXTENSIONS
+        if (kNmeaValueSlots.slot[tag] != NMEA_UNTRACKED)
+            updateDataValue(kNmeaValueSlots.slot[tag], v, mDataMs ? mDataMs : (uint32_t)millis());
+#else
+        (void)tag;
+        (void)v;
+#endif
+    }
 #ifdef NMEA_EXTENSIONS
+    nmea_datavalue_t *Value(nmea_index_t idx);
     nmea_float_t get(nmea_index_t idx);
     nmea_float_t getSmoothed(nmea_index_t idx);
     void initDataValue(nmea_index_t idx, char *label = NULL, char *fmt = NULL, char *unit = NULL,
@@ -104,6 +280,10 @@ class Adafruit_GPS {
     nmea_history_t *initHistory(nmea_index_t idx, nmea_float_t scale = 10.0, nmea_float_t offset = 0.0,
                                 unsigned historyInterval = 20, unsigned historyN = 192);
     void removeHistory(nmea_index_t idx);
+    bool initFilter(nmea_index_t idx, nmea_filter_t filter, uint8_t n = 3);
+    size_t HistoryBytesUsed(void);
+    size_t HistoryBytesFree(void);
+    uint8_t HistoryBlocksHighWater(void);
     void showDataValue(nmea_index_t idx, int n = 7);
     bool isCompoundAngle(nmea_index_t idx);
 #endif
@@ -129,32 +309,46 @@ class Adafruit_GPS {
     uint8_t mMonth = 0;          ///< GMT mMonth
     uint8_t mDay = 0;            ///< GMT mDay
 
+#ifndef NMEA_FIXED_POINT
     nmea_float_t mLatitude = 0.0;   ///< Floating point mLatitude value in degrees/minutes
                                     ///< as received from the GPS (DDMM.MMMM)
     nmea_float_t mLongitude = 0.0;  ///< Floating point mLongitude value in degrees/minutes
                                     ///< as received from the GPS (DDDMM.MMMM)
+#endif
 
     /** Fixed point mLatitude and mLongitude value with degrees stored in units of
       1/10000000 of a degree. See pull #13 for more details:
       https://github.com/adafruit/Adafruit-GPS-Library/pull/13 */
-    int32_t mLatitude_fixed;   ///< Fixed point mLatitude in decimal degrees.
-                               ///< Divide by 10000000.0 to get a double.
-    int32_t mLongitude_fixed;  ///< Fixed point mLongitude in decimal degrees
-                               ///< Divide by 10000000.0 to get a double.
-
+    int32_t mLatitude_fixed = 0;   ///< Fixed point mLatitude in decimal degrees.
+                                   ///< Divide by 10000000.0 to get a double.
+    int32_t mLongitude_fixed = 0;  ///< Fixed point mLongitude in decimal degrees
+                                   ///< Divide by 10000000.0 to get a double.
+
+#ifdef NMEA_FIXED_POINT
+    // Integer results of the GPS sentences, the float values are converted from these on request. GGA, RMC, GLL
+    // and GSA do not feed NewDataValue() in this build, its smoothing is floating point.
+    int32_t mGeoidheight_mm = 0;  ///< Diff between geoid height and WGS84 height in millimetres
+    int32_t mAltitude_mm = 0;     ///< Altitude in millimetres above MSL
+    int32_t mSpeed_mms = 0;       ///< Current speed over ground in millimetres per second
+    int32_t mAngle_cdeg = 0;      ///< Course in hundredths of a degree from true north
+    uint16_t mHDOP_x100 = 0;      ///< Horizontal Dilution of Precision times 100
+    uint16_t mVDOP_x100 = 0;      ///< Vertical Dilution of Precision times 100
+    uint16_t mPDOP_x100 = 0;      ///< Position Dilution of Precision times 100
+#else
     nmea_float_t mLatitudeDegrees = 0.0;   ///< Latitude in decimal degrees
     nmea_float_t mLongitudeDegrees = 0.0;  ///< Longitude in decimal degrees
     nmea_float_t mGeoidheight = 0.0;       ///< Diff between geoid height and WGS84 height
     nmea_float_t mAltitude = 0.0;          ///< Altitude in meters above MSL
     nmea_float_t mSpeed = 0.0;             ///< Current mSpeed over ground in knots
     nmea_float_t mAngle = 0.0;             ///< Course in degrees from true north
-    nmea_float_t mMagvariation = 0.0;      ///< Magnetic variation in degrees (vs. true north)
     nmea_float_t mHDOP = 0.0;              ///< Horizontal Dilution of Precision - relative
                                            ///< accuracy of horizontal position
     nmea_float_t mVDOP = 0.0;              ///< Vertical Dilution of Precision - relative
                                            ///< accuracy of vertical position
     nmea_float_t mPDOP = 0.0;              ///< Position Dilution of Precision - Complex maths derives
                                            ///< a simple, single number for each kind of DOP
+#endif
+    nmea_float_t mMagvariation = 0.0;      ///< Magnetic variation in degrees (vs. true north)
     char mLat = 'X';                       ///< N/S
     char mLon = 'X';                       ///< E/W
     char mMag = 'X';                       ///< Magnetic variation direction
@@ -164,27 +358,18 @@ class Adafruit_GPS {
     uint8_t mSatellites = 0;               ///< Number of mSatellites in use
     uint8_t mAntenna = 0;                  ///< Antenna that is used (from PGTOP)
 
-    uint16_t mLOCUS_serial = 0;   ///< Log serial number
-    uint16_t mLOCUS_records = 0;  ///< Log number of data record
-    uint8_t mLOCUS_type = 0;      ///< Log type, 0: Overlap, 1: FullStop
-    uint8_t mLOCUS_mode = 0;      ///< Logging mode, 0x08 interval logger
-    uint8_t mLOCUS_config = 0;    ///< Contents of configuration
-    uint8_t mLOCUS_interval = 0;  ///< Interval setting
-    uint8_t mLOCUS_distance = 0;  ///< Distance setting
-    uint8_t mLOCUS_speed = 0;     ///< Speed setting
-    uint8_t mLOCUS_status = 0;    ///< 0: Logging, 1: Stop logging
-    uint8_t mLOCUS_percent = 0;   ///< Log life used percentage
-
 #ifdef NMEA_EXTENSIONS
     // NMEA additional public variables
-    nmea_datavalue_t mVal[NMEA_MAX_INDEX];  ///< an array of data value structs, mVal[0] = most
-                                            ///< recent mHDOP so that ockam indexing works
-    nmea_float_t mDepthToKeel = 2.4;        ///< depth from surface to bottom of keel in metres
-    nmea_float_t mDepthToTransducer = 0.0;  ///< depth of transducer below the surface in metres
+    nmea_datavalue_t mVal[kNmeaValueSlots.count];  ///< the tracked data values, in enum order. Index with
+                                                   ///< kNmeaValueSlots.slot[] or use Value()
+    nmea_float_t mDepthToKeel = 2.4;               ///< depth from surface to bottom of keel in metres
+    nmea_float_t mDepthToTransducer = 0.0;         ///< depth of transducer below the surface in metres
 
     char mToID[NMEA_MAX_WP_ID] = {0};    ///< id of waypoint going to on this segment of the route
     char mFromID[NMEA_MAX_WP_ID] = {0};  ///< id of waypoint coming from on this segment of the route
 
+    HistoryPool<GPS_HISTORY_BLOCKS, GPS_HISTORY_VALUES> mHistoryPool;  ///< storage handed out by initHistory()
+
     char mTxtTXT[63] = {0};  ///< text content from most recent TXT sentence
     int mTxtTot = 0;         ///< total TXT sentences in group
     int mTxtID = 0;          ///< id of the text message
@@ -194,15 +379,61 @@ class Adafruit_GPS {
    private:
     // NMEA_data.cpp
     void data_init();
+#ifdef NMEA_EXTENSIONS
+    void updateDataValue(uint8_t slot, nmea_float_t v, uint32_t nowMs);
+    // NMEA_build.cpp
+    size_t buildSentence(NmeaWriter &w, const char *thisSource, const char *thisSentence, char ref, bool noCRLF);
+#endif
     // NMEA_parse.cpp
-    const char *tokenOnList(char *token, const char **list);
-    bool parseCoord(char *p, nmea_float_t *angleDegrees = NULL, nmea_float_t *mAngle = NULL,
-                    int32_t *angle_fixed = NULL, char *dir = NULL);
+    const nmea_sentence_t *FindSentence(uint32_t id);
+    bool parseGGA(const NmeaFields &f);
+    bool parseGLL(const NmeaFields &f);
+    bool parseGSA(const NmeaFields &f);
+    bool parseGSV(const NmeaFields &f);
+    bool parseRMC(const NmeaFields &f);
+    bool parseTOP(const NmeaFields &f);
+#ifdef NMEA_EXTENSIONS
+    bool parseDBT(const NmeaFields &f);
+    bool parseHDM(const NmeaFields &f);
+    bool parseHDT(const NmeaFields &f);
+    bool parseMDA(const NmeaFields &f);
+    bool parseMTW(const NmeaFields &f);
+    bool parseMWV(const NmeaFields &f);
+    bool parseRMB(const NmeaFields &f);
+    bool parseTXT(const NmeaFields &f);
+    bool parseVHW(const NmeaFields &f);
+    bool parseVLW(const NmeaFields &f);
+    bool parseVPW(const NmeaFields &f);
+    bool parseVWR(const NmeaFields &f);
+    bool parseWCV(const NmeaFields &f);
+    bool parseXTE(const NmeaFields &f);
+#endif
+    bool parseCoord(const nmea_field_t &value, const nmea_field_t &hemisphere, nmea_float_t *angleDegrees = NULL,
+                    nmea_float_t *mAngle = NULL, int32_t *angle_fixed = NULL, char *dir = NULL);
+    bool parseCoordFixed(const nmea_field_t &value, const nmea_field_t &hemisphere, int32_t *angle_fixed,
+                         char *dir = NULL);
     char *parseStr(char *buff, char *p, int n);
-    bool parseTime(char *);
-    bool parseFix(char *);
-    bool parseAntenna(char *);
-    bool isEmpty(char *pStart);
+    char *parseStr(char *buff, const nmea_field_t &f, int n);
+    bool parseTime(const nmea_field_t &f);
+    bool parseFix(const nmea_field_t &f);
+    bool parseAntenna(const nmea_field_t &f);
+    bool isEmpty(const nmea_field_t &f);
+    void UpdateEpoch(uint32_t id);
+    void PublishEpoch(void);
+    // Adafruit_GPS.cpp
+    size_t ReadI2cChunk(size_t len);
+    uint16_t AssembleRx(nmea_sentence_cb_t onSentence, void *ctx);
+    bool AssembleChar(char c, uint64_t tUs);
+    void PublishSentence(void);
+    void ServiceCommands(void);
+    void MatchReply(void);
+    void ParseLocusStatus(const char *line);
+    void FeedLocus(char c, uint32_t nowMs);
+    void RestoreState(void);
+    void TrackFix(void);
+    typedef PmtkQueue<GPS_PMTK_QUEUE_SLOTS, GPS_PMTK_COMMAND_SIZE> CommandQueue;
+    uint16_t QueueOutput(CommandQueue &queue, uint16_t periodMs, pmtk_done_cb_t done = nullptr, void *ctx = nullptr);
+    void AdaptOutput(void);
 
     // Make all of these times far in the past by setting them near the middle
     // of the millis() range. Timing assumes that sentences are parsed promptly.
@@ -213,24 +444,76 @@ class Adafruit_GPS {
     uint32_t mRecvdTime = 2000000000L;   ///< millis() when last full sentence received
     uint32_t mSentTime = 2000000000L;    ///< millis() when first character of last
                                          ///< full sentence received
+    uint32_t mDataMs = 0;                ///< millis() Parse() took for the values of the current sentence, 0 outside
+#ifdef NMEA_EXTENSIONS
+    nmea_filter_state_t mFilterState[GPS_FILTER_SLOTS];  ///< state blocks handed out by initFilter()
+#endif
+    static const nmea_sentence_t sentenceTable[];             ///< sentence ID to handler, see NMEA_parse.cpp
+    static const nmea_sentence_hash_t sentenceHash;           ///< perfect hash into sentenceTable
+    const nmea_sentence_t *mSentenceEntry = NULL;             ///< row found by the last successful Check()
+    NmeaFields mFields;                                       ///< fields of the sentence seen by the last Check()
+    SatelliteTable<GPS_MAX_SATELLITES_PER_SYSTEM> mSatTable;  ///< satellites in view assembled from GSV groups
+
+    // Epoch assembler: GGA, RMC, GLL and GSA are gathered into mEpoch until every sentence in mEpochExpect has
+    // arrived or the time changes, then published whole through mFixes
+    gps_fix_t mEpoch = {};                     ///< epoch being assembled
+    uint8_t mEpochExpect = GPS_EPOCH_DEFAULT;  ///< sentences that complete an epoch
+    bool mEpochPublished = false;              ///< mEpoch has already been published
+    Seqlock<gps_fix_t> mFixes;                 ///< last complete epoch, readable from any core
+
     bool mPaused = false;
 
     bool mNoComms = false;
 
     i2c_inst_t *mI2c{nullptr};
     uint8_t mI2cAddress = 0x00;
-    char mI2cBuffer[GPS_MAX_I2C_TRANSFER];
-    int8_t mBuffMax = -1;
-    int8_t mBuffIdx = 0;
     char mLastChar = 0;
 
-    volatile char mLine1[MAXLINELENGTH];   ///< We double buffer: read one line in
-                                           ///< and leave one for the main program
-    volatile char mLine2[MAXLINELENGTH];   ///< Second buffer
-    volatile uint8_t mLineidx = 0;         ///< our index into filling the current line
-    volatile char *mCurrentLine{nullptr};  ///< Pointer to current line buffer
-    volatile char *mLastline{nullptr};     ///< Pointer to previous line buffer
-    volatile bool mRecvdflag = false;      ///< Received flag
+    RingBuffer<char, GPS_RX_RING_SIZE> mRxRing;  ///< raw bytes pulled from the bus, not yet assembled into lines
+
+    // Receive side: assembles one line at a time and publishes it to mSentences
+    char mCurrentLine[MAXLINELENGTH];  ///< line being assembled
+    uint8_t mLineidx = 0;              ///< our index into filling the current line
+    uint8_t mLineLen = 0;              ///< length of the line that just completed
+    uint64_t mRxUs = 0;                ///< time_us_64() when the newest bytes in mRxRing were read or injected
+    nmea_stamp_t mLineStamp = {};      ///< when the line being assembled, or just completed, was read
+    nmea_stamp_t mParseStamp = {};     ///< stamps for the next Parse(), only set in the context that parses
+    ClockEstimator mClock;             ///< local clock against the UTC of the published epochs
+
+    SentenceQueue<GPS_SENTENCE_QUEUE_SLOTS, MAXLINELENGTH> mSentences;  ///< complete lines waiting for the app
+
+    // Transmit side: PMTK commands waiting to be sent or acknowledged, serviced by Poll() and ReadData(). Each
+    // queue has a single producer, the application for mCommands and Parse() for mRateCommands, and only one
+    // command of the two is in flight at once.
+    CommandQueue mCommands{GPS_PMTK_ACK_TIMEOUT_MS, GPS_PMTK_RETRIES};      ///< QueueCommand() and the like
+    CommandQueue mRateCommands{GPS_PMTK_ACK_TIMEOUT_MS, GPS_PMTK_RETRIES};  ///< AdaptOutput()'s rate changes
+    bool mRateTurn = false;  ///< mRateCommands is being serviced, until it is empty
+
+    LocusReader mLocus;                    ///< decodes a LOCUS dump straight from the received characters
+    bool mLocusDumping = false;            ///< a dump was asked for and has not ended yet
+    Seqlock<locus_status_t> mLocusStatus;  ///< last $PMTKLOG, readable from any core
+
+    EpoLoader mEpo{GPS_PMTK_ACK_TIMEOUT_MS, GPS_PMTK_RETRIES};  ///< EPO upload, one record in flight at a time
+
+    // Output: the sentences and update rate asked of the module, chosen from mWants and the speed over ground
+    OutputController mOutput;  ///< sentence mask, rate policy and bytes per second
+    uint8_t mWants = 0;        ///< GPS_WANT_ bits given to Subscribe()
+
+    // Warm start: the last fix is kept in mWarm, saved to mStateStore by SaveState() and fed back by Init()
+    GpsStateStore *mStateStore = nullptr;  ///< where mWarm is saved, NULL for nowhere
+    gps_utc_cb_t mUtcNow = nullptr;        ///< tells Init() the time, NULL if nothing knows it
+    void *mUtcCtx = nullptr;               ///< passed to mUtcNow
+    gps_warm_state_t mWarm = {};           ///< last fix, restored by Init() until there is a new one
+    gps_ttff_t mTtff = {};                 ///< how the start since Init() went
+    uint32_t mInitMs = 0;                  ///< millis() of Init()
+    uint32_t mTrackingSince = 0;           ///< UTC the current run of epochs with a fix started, 0 for none
+    uint32_t mSavedUtc = 0;                ///< UTC of the last snapshot, 0 for none since Init()
+    bool mStateDue = false;                ///< a snapshot is due, see StateDue()
+
+    // Application side: the sentence most recently taken off the queue by NewNMEAreceived()
+    char mLastline[MAXLINELENGTH] = {0};  ///< line handed out by LastNMEA()
+    nmea_stamp_t mLastlineStamp = {};     ///< when mLastline was read, see SentenceStamp()
+    volatile bool mRecvdflag = false;     ///< mLastline holds a sentence not yet fetched by LastNMEA()
     volatile bool mInStandbyMode = false;  ///< In standby flag
 };
 
@@ -83,9 +83,13 @@
 #define PMTK_LOCUS_STARTSTOPACK "$PMTK001,185,3*3C"  ///< Acknowledge the start or stop command
 #define PMTK_LOCUS_QUERY_STATUS "$PMTK183*38"        ///< Query the logging status
 #define PMTK_LOCUS_ERASE_FLASH "$PMTK184,1*22"       ///< Erase the log flash data
+#define PMTK_LOCUS_DUMP "$PMTK622,1*29"              ///< Dump the log flash as $PMTKLOX lines
 #define LOCUS_OVERLAP 0                              ///< If flash is full, log will overwrite old data with new logs
 #define LOCUS_FULLSTOP 1                             ///< If flash is full, logging will stop
 
+#define PMTK_EPO_CLEAR "$PMTK127*36"  ///< Erase the EPO data held by the module
+#define PMTK_Q_EPO_INFO "$PMTK607*33"  ///< Ask which EPO data the module holds, answered with $PMTK707
+
 #define PMTK_ENABLE_SBAS \
     "$PMTK313,1*2E"                       ///< Enable search for SBAS satellite (only works with 1Hz
                                           ///< output rate)
@@ -94,6 +98,7 @@
 #define PMTK_STANDBY "$PMTK161,0*28"              ///< standby command & boot successful message
 #define PMTK_STANDBY_SUCCESS "$PMTK001,161,3*36"  ///< Not needed currently
 #define PMTK_AWAKE "$PMTK010,002*2D"              ///< Wake up
+#define PMTK_TEST "$PMTK000*32"                   ///< Test packet, acknowledged with $PMTK001,0,3
 
 #define PMTK_Q_RELEASE "$PMTK605*31"  ///< ask for the release and version
 
@@ -28,6 +28,36 @@
 #include <Adafruit_GPS.hpp>
 #ifdef NMEA_EXTENSIONS
 
+/*!
+    @brief Add a UTC time field, hhmmss.ss
+    @param w The sentence being written
+    @param hour Hours
+    @param minute Minutes
+    @param seconds Seconds
+    @param milliseconds Milliseconds, written to the hundredth
+*/
+static void WriteTime(NmeaWriter &w, uint8_t hour, uint8_t minute, uint8_t seconds, uint16_t milliseconds) {
+    w.Uint(hour, 2).Uint(minute, 2).Uint(seconds, 2).Char('.').Uint(milliseconds / 10, 2);
+}
+
+/*!
+    @brief Add a coordinate field in the DDMM.mmmm or DDDMM.mmmm format the GPS sends, straight from the fixed
+    point degrees so no precision is lost to a float
+    @param w The sentence being written
+    @param fixed Degrees times 10^7, the sign is left to the hemisphere field
+    @param degreeDigits 2 for latitude, 3 for longitude
+*/
+static void WriteCoord(NmeaWriter &w, int32_t fixed, uint8_t degreeDigits) {
+    const uint32_t a = fixed < 0 ? 0U - (uint32_t)fixed : (uint32_t)fixed;
+    uint32_t degrees = a / 10000000;
+    uint32_t minutes = ((a % 10000000) * 6 + 50) / 100;  // ten thousandths of a minute
+    if (minutes >= 600000) {                              // rounded up to a whole degree
+        minutes -= 600000;
+        degrees++;
+    }
+    w.Uint(degrees, degreeDigits).Uint(minutes / 10000, 2).Char('.').Uint(minutes % 10000, 4);
+}
+
 /*!
     @brief Build an NMEA sentence string based on the relevant variables.
     Sentences start with a $, then a two character source identifier, then
@@ -39,17 +69,17 @@
     build() will work with other lengths for source and sentence to allow
     extension to building proprietary sentences like $PMTK220,100*2F.
 
-    build() will not work properly in an environment that does not support
-    the %f floating point formatter in sprintf(), and will return NULL.
-    Floating point arguments to sprintf() are explicitly cast to double to
-    avoid warnings in some compilers.
+    build() writes every field with NmeaWriter in a single pass, without
+    sprintf() and without allocating, and computes the checksum as it goes.
+    Numbers that were printed with "%f" keep their 6 decimals. Latitude and
+    longitude come from the fixed point values.
 
     build() adds Carriage Return and Line Feed to sentences to conform to
     NMEA-183, so send your output with a print, not a println.
 
     The resulting sentence may be corrupted if the input data is corrupt.
-    In particular, the sentence will be truncated if any of the character
-    data is 0, e.g. if mLat is not set to 'N' or 'S'.
+    A character field whose data is 0, e.g. mMag before it is set, is left
+    empty.
 
     Some of the data in these test sentences may be arbitrary, e.g. for the
     TXT sentence which has a more complicated protocol for multiple lines
@@ -57,28 +87,17 @@
     to be valid, so these sentences may contain values that are stale, or
     the result of initialization rather than measurement.
 
-    @param nmea Pointer to the NMEA string buffer. Must be big enough to
-                hold the sentence. No guarantee what will be in it if the
-                building of the sentence fails.
+    @param w The writer, on a buffer or a sink
     @param thisSource Pointer to the source name string (2 upper case)
     @param thisSentence Pointer to the sentence name string (3 upper case)
     @param ref Reference for the sentence, usually relative (R) or true (T)
     @param noCRLF set true to disable adding CR/LF to comply with NMEA-183
-    @return Pointer to sentence if successful, NULL if fails
+    @return Length of the sentence if successful, 0 if it fails
 */
 
-char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSentence, char ref, bool noCRLF) {
-    sprintf(nmea, "%6.2f",
-            (double)123.45);  // fail if sprintf() doesn't handle floats
-    if (strcmp(nmea, "123.45")) return NULL;
-    *nmea = '$';
-    char *p = nmea + 1;  // Pointer to move through the sentence
-    strncpy(p, thisSource, strlen(thisSource));
-    p += strlen(thisSource);
-    strncpy(p, thisSentence, strlen(thisSentence));
-    p += strlen(thisSentence);
-    *p = ',';
-    p += 1;  // Now $XXSSS, and need to add argument fields
+size_t Adafruit_GPS::buildSentence(NmeaWriter &w, const char *thisSource, const char *thisSentence, char ref,
+                                   bool noCRLF) {
+    w.Begin(thisSource, thisSentence);  // Now $XXSSS, and need to add argument fields
     // This may look inefficient, but an M0 will get down the list in about 1 us /
     // strcmp()! Put the GPS sentences from Adafruit_GPS at the top to make
     // pruning excess code easier. Otherwise, keep them alphabetical for ease of
@@ -107,10 +126,12 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         //    type 1 or 9 update, null field when DGPS is not used
         // 14) Differential reference station ID, 0000-1023
         // 15) Checksum
-        sprintf(p, "%09.2f,%09.4f,%c,%010.4f,%c,%d,%02d,%f,%f,M,%f,M,,",
-                (double)mHour * 10000L + mMinute * 100L + mSeconds + mMilliseconds / 1000., (double)mLatitude, mLat,
-                (double)mLongitude, mLon, mFixquality, mSatellites, (double)mHDOP, (double)mAltitude,
-                (double)mGeoidheight);
+        WriteTime(w, mHour, mMinute, mSeconds, mMilliseconds);
+        WriteCoord(w.Comma(), mLatitude_fixed, 2);
+        w.Comma().Char(mLat).Comma();
+        WriteCoord(w, mLongitude_fixed, 3);
+        w.Comma().Char(mLon).Comma().Uint(mFixquality).Comma().Uint(mSatellites, 2).Comma();
+        w.Float(HDOP(), 6).Comma().Float(Altitude(), 6).Str(",M,").Float(Geoidheight(), 6).Str(",M,,");
 
     } else if (!strcmp(thisSentence, "GLL")) {  //*****************************GLL
         // GLL Geographic Position – Latitude/Longitude
@@ -124,8 +145,12 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 5) Time (UTC)
         // 6) Status A - Data Valid, V - Data Invalid
         // 7) Checksum
-        sprintf(p, "%09.4f,%c,%010.4f,%c,%09.2f,A", (double)mLatitude, mLat, (double)mLongitude, mLon,
-                (double)mHour * 10000L + mMinute * 100L + mSeconds + mMilliseconds / 1000.);
+        WriteCoord(w, mLatitude_fixed, 2);
+        w.Comma().Char(mLat).Comma();
+        WriteCoord(w, mLongitude_fixed, 3);
+        w.Comma().Char(mLon).Comma();
+        WriteTime(w, mHour, mMinute, mSeconds, mMilliseconds);
+        w.Str(",A");
 
     } else if (!strcmp(thisSentence, "GSA")) {  //*****************************GSA
         // GSA GPS DOP and active mSatellites
@@ -142,7 +167,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 16) mHDOP in meters
         // 17) mVDOP in meters
         // 18) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "RMC")) {  //*****************************RMC
         // RMC Recommended Minimum Navigation Information
@@ -162,10 +187,13 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 10) Magnetic Variation, degrees
         // 11) E or W
         // 12) Checksum
-        sprintf(p, "%09.2f,A,%09.4f,%c,%010.4f,%c,%f,%f,%06d,%f,%c",
-                (double)mHour * 10000L + mMinute * 100L + mSeconds + mMilliseconds / 1000., (double)mLatitude, mLat,
-                (double)mLongitude, mLon, (double)mSpeed, (double)mAngle, mDay * 10000 + mMonth * 100 + mYear,
-                (double)mMagvariation, mMag);
+        WriteTime(w, mHour, mMinute, mSeconds, mMilliseconds);
+        w.Str(",A,");
+        WriteCoord(w, mLatitude_fixed, 2);
+        w.Comma().Char(mLat).Comma();
+        WriteCoord(w, mLongitude_fixed, 3);
+        w.Comma().Char(mLon).Comma().Float(Speed(), 6).Comma().Float(Angle(), 6).Comma();
+        w.Uint(mDay, 2).Uint(mMonth, 2).Uint(mYear, 2).Comma().Float(mMagvariation, 6).Comma().Char(mMag);
 
     } else if (!strcmp(thisSentence, "APB")) {  //*****************************APB
         // APB Autopilot Sentence "B"
@@ -195,7 +223,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 13) Heading to steer to destination waypoint
         // 14) M = Magnetic, T = True
         // 15) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "DBK")) {  //*****************************DBT
         // DBK Depth Below Keel
@@ -209,7 +237,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 5) Depth, Fathoms
         // 6) F = Fathoms
         // 7) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "DBS")) {  //*****************************DBT
         // DBS Depth Below Surface
@@ -223,7 +251,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 5) Depth, Fathoms
         // 6) F = Fathoms
         // 7) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "DBT")) {  //*****************************DBT
         // DBT Depth Below Transducer
@@ -237,8 +265,8 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 5) Depth, Fathoms
         // 6) F = Fathoms
         // 7) Checksum
-        double d = mVal[NMEA_DEPTH].latest - mDepthToTransducer;
-        sprintf(p, "%f,f,%f,M,,,", d / 0.3048, d);
+        nmea_float_t d = get(NMEA_DEPTH) - mDepthToTransducer;
+        w.Float(d / 0.3048f, 6).Str(",f,").Float(d, 6).Str(",M,,,");
 
     } else if (!strcmp(thisSentence, "DPT")) {  //*****************************DPT
         // DPT Heading – Deviation & Variation
@@ -250,7 +278,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         //      positive means distance from transducer to water line,
         //      negative means distance from transducer to keel
         // 3) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "GSV")) {  //*****************************GSV
         // GSV Satellites in view
@@ -266,7 +294,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 7) SNR in dB
         // more satellite infos like 4)-7)
         // n) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "HDG")) {  //*****************************HDG
         //  HDG Heading – Deviation & Variation
@@ -279,7 +307,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 4) Magnetic Variation degrees
         // 5) Magnetic Variation direction, E = Easterly, W = Westerly
         // 6) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "HDM")) {  //*****************************HDM
         // HDM Heading – Magnetic
@@ -289,7 +317,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 1) Heading Degrees, magnetic
         // 2) M = magnetic
         // 3) Checksum
-        sprintf(p, "%f,M", (double)mVal[NMEA_HDG].latest);
+        w.Float(get(NMEA_HDG), 6).Str(",M");
 
     } else if (!strcmp(thisSentence, "HDT")) {  //*****************************HDT
         // HDT Heading – True
@@ -300,7 +328,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 2) T = True
         // 3) Checksum
         // starts with $II for integrated instrumentation
-        sprintf(p, "%f,T", (double)mVal[NMEA_HDT].latest);
+        w.Float(get(NMEA_HDT), 6).Str(",T");
 
     } else if (!strcmp(thisSentence, "MDA")) {  //*****************************MDA
         // MDA Meteorological Composite
@@ -321,7 +349,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 10)
         // 11) Dew Point
         // 12) C or F
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "MTW")) {  //*****************************MTW
         // MTW Water Temperature
@@ -332,12 +360,12 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 1) Degrees
         // 2) Unit of Measurement, Celcius
         // 3) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "MWD")) {  //*****************************MWD
         // MWD Wind Direction & Speed
         // Format unknown
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "MWV")) {  //*****************************MWV
         // MWV Wind Speed and Angle assuming values for True
@@ -352,9 +380,9 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 5) Status, A = Data Valid
         // 6) Checksum
         if (ref == 'R')
-            sprintf(p, "%f,%c,%f,N,A", (double)mVal[NMEA_AWA].latest, ref, (double)mVal[NMEA_AWS].latest);
+            w.Float(get(NMEA_AWA), 6).Comma().Char(ref).Comma().Float(get(NMEA_AWS), 6).Str(",N,A");
         else
-            sprintf(p, "%f,%c,%f,N,A", (double)mVal[NMEA_TWA].latest, 'T', (double)mVal[NMEA_TWS].latest);
+            w.Float(get(NMEA_TWA), 6).Comma().Char('T').Comma().Float(get(NMEA_TWS), 6).Str(",N,A");
 
     } else if (!strcmp(thisSentence, "RMB")) {  //*****************************RMB
         // RMB Recommended Minimum Navigation Information
@@ -372,7 +400,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 11) Bearing to destination in degrees True
         // 12) Destination closing velocity in knots
         // 13) Arrival Status, A = Arrival Circle Entered 14) Checksum
-        sprintf(p, ",,,,,,,,,,,%f,A", (double)mVal[NMEA_VMGWP].latest);
+        w.Str(",,,,,,,,,,,").Float(get(NMEA_VMGWP), 6).Str(",A");
 
     } else if (!strcmp(thisSentence, "ROT")) {  //*****************************ROT
         // ROT Rate Of Turn
@@ -382,7 +410,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 1) Rate Of Turn, degrees per mMinute, "-" means bow turns to port
         // 2) Status, A means data is valid
         // 3) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "RPM")) {  //*****************************RPM
         // RPM Revolutions
@@ -395,7 +423,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 4) Propeller pitch, % of maximum, "-" means astern
         // 5) Status, A means data is valid
         // 6) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "RSA")) {  //*****************************RSA
         //  RSA Rudder Sensor Angle
@@ -407,7 +435,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 3) Port rudder sensor
         // 4) Status, A means data is valid
         // 5) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "TXT")) {  //*****************************TXT
         // as mentioned in https://github.com/adafruit/Adafruit_GPS/issues/95
@@ -420,7 +448,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 3) Text Identifier 01-99
         // 4) Text String, max 61 characters
         // 5) Checksum
-        sprintf(p, "01,01,23,This is the text of the sample message");
+        w.Str("01,01,23,This is the text of the sample message");
 
     } else if (!strcmp(thisSentence, "VDR")) {  //*****************************VDR
         // VDR Set and Drift
@@ -434,7 +462,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 5) Knots (mSpeed of current)
         // 6) N = Knots
         // 7) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "VHW")) {  //*****************************VHW
         // VHW Water Speed and Heading
@@ -451,8 +479,8 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 7) Kilometers (mSpeed of vessel relative to the water)
         // 8) K = Kilometres
         // 9) Checksum
-        sprintf(p, "%f,T,%f,M,%f,N,%f,K", (double)mVal[NMEA_HDT].latest, (double)mVal[NMEA_HDG].latest,
-                (double)mVal[NMEA_VTW].latest, (double)mVal[NMEA_VTW].latest * 1.829);
+        w.Float(get(NMEA_HDT), 6).Str(",T,").Float(get(NMEA_HDG), 6).Str(",M,");
+        w.Float(get(NMEA_VTW), 6).Str(",N,").Float(get(NMEA_VTW) * 1.829f, 6).Str(",K");
 
     } else if (!strcmp(thisSentence, "VLW")) {  //*****************************VLW
         // VLW Distance Traveled through Water
@@ -466,7 +494,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 3) Distance since Reset
         // 4) N = Nautical Miles
         // 5) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "VPW")) {  //*****************************VPW
         // not supported by iNavX
@@ -479,7 +507,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 3) Speed, "-" means downwind
         // 4) M = Meters per second
         // 5) Checksum
-        sprintf(p, "%f,N,,", (double)mVal[NMEA_VMG].latest);
+        w.Float(get(NMEA_VMG), 6).Str(",N,,");
 
     } else if (!strcmp(thisSentence, "VTG")) {  //*****************************VTG
         // VTG Track Made Good and Ground Speed
@@ -491,7 +519,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 5) Speed Knots                 6) N = Knots
         // 7) Speed Kilometers Per Hour   8) K = Kilometres Per Hour
         // 9) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "VWR")) {  //*****************************VWR
         // VWR Relative Wind Speed and Angle
@@ -509,7 +537,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 7) Speed
         // 8) K = Kilometers Per Hour
         // 9) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "WCV")) {  //*****************************WCV
         // WCV Waypoint Closure Velocity
@@ -517,7 +545,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         //       |   | |    |
         //$--WCV,x.x,N,c--c*hh
         // 1) Velocity 2) N = knots 3) Waypoint ID 4) Checksum
-        sprintf(p, "%f,N,home", (double)mVal[NMEA_VMG].latest);
+        w.Float(get(NMEA_VMG), 6).Str(",N,home");
 
     } else if (!strcmp(thisSentence, "XTE")) {  //*****************************XTE
         // XTE Cross-Track Error – Measured
@@ -535,7 +563,7 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 4) Direction to steer, L or R
         // 5) Cross track units. N = Nautical Miles
         // 6) Checksum
-        return NULL;
+        return 0;
 
     } else if (!strcmp(thisSentence, "ZDA")) {  //*****************************ZDA
         // ZDA Time & Date – UTC, Day, Month, Year and Local Time Zone
@@ -549,24 +577,66 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
         // 5) Day, 01 to 31
         // 6) Time (UTC)
         // 7) Checksum
-        return NULL;
+        return 0;
 
     } else {
-        return NULL;  // didn't find a match for the build request
+        return 0;  // didn't find a match for the build request
     }
 
-    AddChecksum(nmea);  // Successful completion
-    if (!noCRLF) {      // Add Carriage Return and Line Feed to comply with NMEA-183
-        size_t len = strlen(nmea);
-        char *nmeaWithCRLF = (char *)malloc(len + 3);  // +2 for \r\n, +1 for null terminator
-        if (nmeaWithCRLF) {
-            strcpy(nmeaWithCRLF, nmea);    // Copy original string
-            strcat(nmeaWithCRLF, "\r\n");  // Append \r\n
-            strcpy(nmea, nmeaWithCRLF);    // Copy back to original buffer
-            free(nmeaWithCRLF);            // Free the allocated memory
-        }
-    }
-    return nmea;  // return pointer to finished product
+    return w.Finish(!noCRLF);  // Successful completion, checksum and CR LF to comply with NMEA-183
+}
+
+/*!
+    @brief Build an NMEA sentence into a buffer, see buildSentence() for the
+    sentences supported
+    @param nmea Pointer to the NMEA string buffer. No guarantee what will be
+                in it if the building of the sentence fails.
+    @param size Size of the buffer, the sentence fails if it does not fit
+    @param thisSource Pointer to the source name string (2 upper case)
+    @param thisSentence Pointer to the sentence name string (3 upper case)
+    @param ref Reference for the sentence, usually relative (R) or true (T)
+    @param noCRLF set true to disable adding CR/LF to comply with NMEA-183
+    @return Length of the sentence if successful, 0 if it fails
+*/
+
+size_t Adafruit_GPS::Build(char *nmea, size_t size, const char *thisSource, const char *thisSentence, char ref,
+                           bool noCRLF) {
+    NmeaWriter w(nmea, size);
+    return buildSentence(w, thisSource, thisSentence, ref, noCRLF);
+}
+
+/*!
+    @brief Stream an NMEA sentence to a sink, e.g. the transmit buffer of a
+    logger, without building it in memory first. The checksum is worked out
+    on the way, and the sink gets NMEA_WRITER_CHUNK bytes at a time.
+    @param sink Where the sentence goes. A sink that refuses a piece fails
+                the sentence, and may have taken the start of it.
+    @param thisSource Pointer to the source name string (2 upper case)
+    @param thisSentence Pointer to the sentence name string (3 upper case)
+    @param ref Reference for the sentence, usually relative (R) or true (T)
+    @param noCRLF set true to disable adding CR/LF to comply with NMEA-183
+    @return Length of the sentence if successful, 0 if it fails
+*/
+
+size_t Adafruit_GPS::Build(NmeaSink &sink, const char *thisSource, const char *thisSentence, char ref,
+                           bool noCRLF) {
+    NmeaWriter w(sink);
+    return buildSentence(w, thisSource, thisSentence, ref, noCRLF);
+}
+
+/*!
+    @brief Build an NMEA sentence into a buffer assumed to hold MAXLINELENGTH
+    characters, see buildSentence() for the sentences supported
+    @param nmea Pointer to the NMEA string buffer
+    @param thisSource Pointer to the source name string (2 upper case)
+    @param thisSentence Pointer to the sentence name string (3 upper case)
+    @param ref Reference for the sentence, usually relative (R) or true (T)
+    @param noCRLF set true to disable adding CR/LF to comply with NMEA-183
+    @return Pointer to sentence if successful, NULL if fails
+*/
+
+char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSentence, char ref, bool noCRLF) {
+    return Build(nmea, MAXLINELENGTH, thisSource, thisSentence, ref, noCRLF) ? nmea : NULL;
 }
 
 #endif  // NMEA_EXTENSIONS
@@ -576,34 +646,19 @@ char *Adafruit_GPS::Build(char *nmea, const char *thisSource, const char *thisSe
     the first character in the string. The checksum is the result of an
     exclusive or of all the characters in the string. Also useful if you
     are creating new PMTK strings for controlling a GPS module and need a
-    checksum added.
-    @param buff Pointer to the string, which must be long enough
+    checksum added. Build() checksums as it writes and does not need this.
+    @param buff Pointer to the string, which must have room for 3 more
+    characters
     @return none
 */
 
 void Adafruit_GPS::AddChecksum(char *buff) {
-    char cs = 0;
-    int i = 1;
-    while (buff[i]) {
-        cs ^= buff[i];
-        i++;
-    }
-
-    // Calculate the needed buffer size: original length + 3 (*XX) + 1 (null
-    // terminator)
-    int neededSize = strlen(buff) + 4;
-    char *tempBuffer = (char *)malloc(neededSize);
-
-    if (tempBuffer != NULL) {
-        // Use snprintf to safely format the string with the checksum
-        snprintf(tempBuffer, neededSize, "%s*%02X", buff, cs);
-
-        // Copy the formatted string back to the original buffer
-        // Note: Make sure the original buffer is large enough to hold the new
-        // string.
-        strcpy(buff, tempBuffer);
-
-        // Free the allocated memory to avoid memory leaks
-        free(tempBuffer);
-    }
+    static const char kHex[] = "0123456789ABCDEF";
+    uint8_t cs = 0;
+    char *p = buff + 1;
+    while (*p) cs ^= (uint8_t)*p++;  // one pass finds the end and the checksum together
+    p[0] = '*';
+    p[1] = kHex[cs >> 4];
+    p[2] = kHex[cs & 0xF];
+    p[3] = 0;
 }
@@ -29,68 +29,79 @@
   @copyright CCBY license
 */
 
+#include <inttypes.h>
 #include <math.h>
 #include <stdio.h>
 
 #include "Adafruit_GPS.hpp"
+#include "fast_trig.hpp"
 
+// the RAM saving the GPS_TRACKED_VALUES option reports at configure time is worked out with this size
+static_assert(sizeof(nmea_float_t) != sizeof(float) || sizeof(nmea_datavalue_t) == 24 + 4 * sizeof(void *),
+              "update the nmea_datavalue_t size in CMakeLists.txt");
+
+#ifdef NMEA_EXTENSIONS
 /*!
-    @brief Update the value and history information with a new value. Call
-    whenever a new data value is received. The function does nothing if the
-    NMEA extensions are not enabled.
-    @param idx The data index for which a new value has been received
+    @brief Update a tracked value and its history, the work behind
+    NewDataValue() once the index has been mapped to its slot in mVal[].
+    @param slot The slot of the data value in mVal[]
     @param v The new value received
+    @param nowMs millis() of the value, sampled once by the caller
     @return none
 */
 
-void Adafruit_GPS::NewDataValue(nmea_index_t idx, nmea_float_t v) {
-#ifdef NMEA_EXTENSIONS
-    //  Serial.println();Serial.print(idx);Serial.print(", "); Serial.println(v);
-    mVal[idx].latest = v;  // update the value
+void Adafruit_GPS::updateDataValue(uint8_t slot, nmea_float_t v, uint32_t nowMs) {
+    nmea_datavalue_t &d = mVal[slot];
+    d.latest = v;  // update the value
 
     // update the smoothed verion
-    if (isCompoundAngle(idx)) {  // mAngle with sin/cos component recording
-        NewDataValue((nmea_index_t)(idx + 1), sin(v / (nmea_float_t)RAD_TO_DEG));
-        NewDataValue((nmea_index_t)(idx + 2), cos(v / (nmea_float_t)RAD_TO_DEG));
+    if ((int)(d.type / 10) == 1) {  // mAngle with sin/cos component recording, always in the next slots
+        float sinV, cosV;
+        FastSinCos(v, &sinV, &cosV);
+        updateDataValue(slot + 1, sinV, nowMs);
+        updateDataValue(slot + 2, cosV, nowMs);
+    }
+    // weighting factor for smoothing depends on delta t / tau, the first value is taken as it is
+    const uint32_t dt = nowMs - d.mLastUpdate;
+    const uint32_t w = d.mLastUpdate ? NmeaSmoothingWeight(dt, d.response, d.decay) : NMEA_WEIGHT_ONE;
+    switch (d.filter) {
+        case NMEA_FILTER_ALPHA_BETA:
+            d.smoothed = NmeaAlphaBeta(&mFilterState[d.filterState], d.smoothed, v, w, dt);
+            break;
+        case NMEA_FILTER_MEDIAN:
+            d.smoothed = NmeaMedian(&mFilterState[d.filterState], v);
+            break;
+        default:
+            d.smoothed += (v - d.smoothed) * (w * (1.0f / NMEA_WEIGHT_ONE));
+            break;
     }
-    // weighting factor for smoothing depends on delta t / tau
-    nmea_float_t w = min((nmea_float_t)1.0, (nmea_float_t)(millis() - mVal[idx].mLastUpdate) / mVal[idx].response);
-    // default smoothing
-    mVal[idx].smoothed = (1.0f - w) * mVal[idx].smoothed + w * v;
     // special smoothing for some mAngle types
-    if (mVal[idx].type == NMEA_COMPASS_ANGLE_SIN)
-        mVal[idx].smoothed = compassAngle(mVal[idx + 1].smoothed, mVal[idx + 2].smoothed);
-    if (mVal[idx].type == NMEA_BOAT_ANGLE_SIN)
-        mVal[idx].smoothed = boatAngle(mVal[idx + 1].smoothed, mVal[idx + 2].smoothed);
+    if (d.type == NMEA_COMPASS_ANGLE_SIN) d.smoothed = compassAngle(mVal[slot + 1].smoothed, mVal[slot + 2].smoothed);
+    if (d.type == NMEA_BOAT_ANGLE_SIN) d.smoothed = boatAngle(mVal[slot + 1].smoothed, mVal[slot + 2].smoothed);
     // some types just don't make sense to smooth -- use latest
-    if (mVal[idx].type == NMEA_BOAT_ANGLE) mVal[idx].smoothed = mVal[idx].latest;
-    if (mVal[idx].type == NMEA_COMPASS_ANGLE) mVal[idx].smoothed = mVal[idx].latest;
-    if (mVal[idx].type == NMEA_DDMM) mVal[idx].smoothed = mVal[idx].latest;
-    if (mVal[idx].type == NMEA_HHMMSS) mVal[idx].smoothed = mVal[idx].latest;
-
-    mVal[idx].mLastUpdate = millis();  // take a time stamp
-    if (mVal[idx].hist) {              // there's a history struct for this tag
-        unsigned long mSeconds = (millis() - mVal[idx].hist->lastHistory) / 1000;
+    if (d.type == NMEA_BOAT_ANGLE) d.smoothed = d.latest;
+    if (d.type == NMEA_COMPASS_ANGLE) d.smoothed = d.latest;
+    if (d.type == NMEA_DDMM) d.smoothed = d.latest;
+    if (d.type == NMEA_HHMMSS) d.smoothed = d.latest;
+
+    d.mLastUpdate = nowMs;  // take a time stamp
+    if (d.hist) {           // there's a history struct for this tag
+        unsigned long mSeconds = (nowMs - d.hist->lastHistory) / 1000;
         // do an update if the time has come, or if this is the first time through
-        if (mSeconds >= mVal[idx].hist->historyInterval || mVal[idx].hist->lastHistory == 0) {
-            // move the old history back in time by one step
-            for (unsigned i = 0; i < (mVal[idx].hist->n - 1); i++)
-                mVal[idx].hist->data[i] = mVal[idx].hist->data[i + 1];
-
-            // Create the new entry, scaling and offsetting the value to fit into an
+        if (mSeconds >= d.hist->historyInterval || d.hist->lastHistory == 0) {
+            // Create the new entry over the oldest one, scaling and offsetting the value to fit into an
             // integer, and based on the smoothed value.
-            mVal[idx].hist->data[mVal[idx].hist->n - 1] =
-                mVal[idx].hist->scale * (mVal[idx].smoothed - mVal[idx].hist->offset);
-            mVal[idx].hist->lastHistory = millis();
+            d.hist->Push(d.hist->scale * (d.smoothed - d.hist->offset));
+            d.hist->lastHistory = nowMs;
         }
     }
-#endif  // NMEA_EXTENSIONS
 }
+#endif  // NMEA_EXTENSIONS
 
 /*!
     @brief    Initialize the object. Build a mVal[] matrix of data values for
-    all of the enumerated values, including the extra values for the compound
-    mAngle types. The initializer shold probably leave it up to the user
+    the tracked values, including the extra values for the compound mAngle
+    types. Values left out of GPS_TRACKED_VALUES are skipped. The initializer shold probably leave it up to the user
     sketch to decide which data values should carry the extra memory burden
     of history.
     @return   none
@@ -98,10 +109,12 @@ void Adafruit_GPS::NewDataValue(nmea_index_t idx, nmea_float_t v) {
 
 void Adafruit_GPS::data_init() {
 #ifdef NMEA_EXTENSIONS
+    for (int i = 0; i < GPS_FILTER_SLOTS; i++) mFilterState[i].owner = NMEA_UNTRACKED;
     // fill all the data values with nothing
     static char c[] = "NUL";
     for (int i = 0; i < (int)NMEA_MAX_INDEX; i++) {
-        initDataValue((nmea_index_t)i, c, NULL, NULL, 0, (nmea_value_type_t)0);
+        if (kNmeaValueSlots.slot[i] != NMEA_UNTRACKED)
+            initDataValue((nmea_index_t)i, c, NULL, NULL, 0, (nmea_value_type_t)0);
     }
 
     // fill selected data values with the relevant information and pointers
@@ -274,6 +287,18 @@ void Adafruit_GPS::data_init() {
 
 #ifdef NMEA_EXTENSIONS
 
+/*!
+    @brief Find the entry of a data value in the compacted mVal[] array
+    @param idx the NMEA value's index
+    @return the entry, or NULL if idx is out of range or not tracked in this build
+*/
+
+nmea_datavalue_t *Adafruit_GPS::Value(nmea_index_t idx) {
+    if (idx >= NMEA_MAX_INDEX || idx < NMEA_HDOP) return NULL;
+    const uint8_t slot = kNmeaValueSlots.slot[idx];
+    return slot == NMEA_UNTRACKED ? NULL : &mVal[slot];
+}
+
 /*!
     @brief Clearer approach to retrieving NMEA values by allowing calls that
     look like nmea.get(NMEA_TWA) instead of mVal[NMEA_TWA].latest.
@@ -283,8 +308,8 @@ void Adafruit_GPS::data_init() {
 */
 
 nmea_float_t Adafruit_GPS::get(nmea_index_t idx) {
-    if (idx >= NMEA_MAX_INDEX || idx < NMEA_HDOP) return 0.0;
-    return mVal[idx].latest;
+    nmea_datavalue_t *d = Value(idx);
+    return d ? d->latest : 0.0;
 }
 
 /*!
@@ -294,8 +319,8 @@ nmea_float_t Adafruit_GPS::get(nmea_index_t idx) {
 */
 
 nmea_float_t Adafruit_GPS::getSmoothed(nmea_index_t idx) {
-    if (idx >= NMEA_MAX_INDEX || idx < NMEA_HDOP) return 0.0;
-    return mVal[idx].smoothed;
+    nmea_datavalue_t *d = Value(idx);
+    return d ? d->smoothed : 0.0;
 }
 
 /*!
@@ -314,13 +339,17 @@ nmea_float_t Adafruit_GPS::getSmoothed(nmea_index_t idx) {
 
 void Adafruit_GPS::initDataValue(nmea_index_t idx, char *label, char *fmt, char *unit, unsigned long response,
                                  nmea_value_type_t type) {
-    if (idx < NMEA_MAX_INDEX) {
-        if (label) mVal[idx].label = label;
-        if (fmt) mVal[idx].fmt = fmt;
-        if (unit) mVal[idx].unit = unit;
-        if (response) mVal[idx].response = response;
-        mVal[idx].type = type;
-        if ((int)(mVal[idx].type / 10) == 1) {       // mAngle with sin/cos component recording
+    nmea_datavalue_t *d = Value(idx);
+    if (d) {
+        if (label) d->label = label;
+        if (fmt) d->fmt = fmt;
+        if (unit) d->unit = unit;
+        if (response) {
+            d->response = max(response, (unsigned long)NMEA_MIN_RESPONSE);
+            d->decay = NmeaDecayFor(d->response);
+        }
+        d->type = type;
+        if ((int)(d->type / 10) == 1) {              // mAngle with sin/cos component recording
             initDataValue((nmea_index_t)(idx + 1));  // initialize the next two data values as well
             initDataValue((nmea_index_t)(idx + 2));
         }
@@ -328,65 +357,114 @@ void Adafruit_GPS::initDataValue(nmea_index_t idx, char *label, char *fmt, char
 }
 
 /*!
-    @brief Attempt to add history to a data value table entry. If it fails
-    to malloc the space, history will not be added. Test the pointer for a
-    check if needed. Select scale and offset values carefully so that
-    operations and results will fit inside 16 bit integer limits. For example
-    a scale of 1.0 and an offset of 100000.0 would be a good choice for
-    atmospheric pressure in Pa with values ranging ~ +/- 3500, while a scale
-    of 10.0 would be pushing the integer limits.
+    @brief Attempt to add history to a data value table entry. The history is
+    a block from a pool of GPS_HISTORY_BLOCKS inside the object, sized at
+    compile time, so nothing comes from the heap. If every block is in use,
+    history will not be added. Test the pointer for a check if needed. Select
+    scale and offset values carefully so that operations and results will fit
+    inside 16 bit integer limits. For example a scale of 1.0 and an offset of
+    100000.0 would be a good choice for atmospheric pressure in Pa with values
+    ranging ~ +/- 3500, while a scale of 10.0 would be pushing the integer
+    limits.
     @param idx The data index for the value to have history recorded
     @param scale Value for scaling the integer history list
     @param offset Value for scaling the integer history list
     @param historyInterval Approximate Time in mSeconds between historical
    values.
-    @param historyN Set size of data buffer.
+    @param historyN Set size of data buffer, at most GPS_HISTORY_VALUES.
     @return pointer to the history
 */
 
 nmea_history_t *Adafruit_GPS::initHistory(nmea_index_t idx, nmea_float_t scale, nmea_float_t offset,
                                           unsigned historyInterval, unsigned historyN) {
     historyN = max((unsigned)10, historyN);
-    if (idx < NMEA_MAX_INDEX) {
+    nmea_datavalue_t *d = Value(idx);
+    if (d) {
         // remove any existing history
-        if (mVal[idx].hist != NULL) removeHistory(idx);
-        // space for the struct
-        mVal[idx].hist = (nmea_history_t *)malloc(sizeof(nmea_history_t));
-        if (mVal[idx].hist != NULL) {
-            // space for the data array of the appropriate size
-            mVal[idx].hist->data = (int16_t *)malloc(sizeof(int16_t) * historyN);
-            if (mVal[idx].hist->data != NULL) {
-                // initialize the data array
-                for (unsigned i = 0; i < historyN; i++) mVal[idx].hist->data[i] = 0;
-            } else
-                free(mVal[idx].hist);
-        }
-        if (mVal[idx].hist != NULL) {
-            mVal[idx].hist->n = historyN;
-            if (scale > 0.0f) mVal[idx].hist->scale = scale;
-            mVal[idx].hist->offset = offset;
-            if (historyInterval > 0) mVal[idx].hist->historyInterval = historyInterval;
+        if (d->hist != NULL) removeHistory(idx);
+        // a cleared block with room for up to historyN values
+        d->hist = mHistoryPool.Acquire(historyN);
+        if (d->hist != NULL) {
+            if (scale > 0.0f) d->hist->scale = scale;
+            d->hist->offset = offset;
+            if (historyInterval > 0) d->hist->historyInterval = historyInterval;
         }
-        return mVal[idx].hist;
+        return d->hist;
     }
     return NULL;
 }
 
 /*!
-    @brief Remove history from a data value table entry, if it has been added.
+    @brief Remove history from a data value table entry, if it has been added,
+    and return its block to the pool.
     @param idx The data index for the value to have history removed
     @return none
 */
 
 void Adafruit_GPS::removeHistory(nmea_index_t idx) {
-    if (idx < NMEA_MAX_INDEX) {
-        if (mVal[idx].hist == NULL) return;
-        free(mVal[idx].hist->data);
-        free(mVal[idx].hist);
-        mVal[idx].hist = NULL;
+    nmea_datavalue_t *d = Value(idx);
+    if (d) {
+        if (d->hist == NULL) return;
+        mHistoryPool.Release(d->hist);
+        d->hist = NULL;
+    }
+}
+
+/*!
+    @brief Choose how NewDataValue() smooths a data value. The alpha-beta and
+    median filters need a state block, of which there are GPS_FILTER_SLOTS.
+    A compound angle is smoothed through its sine and cosine, so the filter is
+    set on those and takes two blocks.
+    @param idx The data index
+    @param filter The filter, NMEA_FILTER_EMA gives the block back
+    @param n Values a median filter takes the median of, 1 to NMEA_MEDIAN_MAX
+    @return false if idx is not tracked, n is out of range or no block is free
+*/
+
+bool Adafruit_GPS::initFilter(nmea_index_t idx, nmea_filter_t filter, uint8_t n) {
+    nmea_datavalue_t *d = Value(idx);
+    if (d == NULL) return false;
+    if (isCompoundAngle(idx))
+        return initFilter((nmea_index_t)(idx + 1), filter, n) && initFilter((nmea_index_t)(idx + 2), filter, n);
+    if (filter == NMEA_FILTER_MEDIAN && (n < 1 || n > NMEA_MEDIAN_MAX)) return false;
+    if (d->filterState != 0xFF) mFilterState[d->filterState].owner = NMEA_UNTRACKED;
+    d->filterState = 0xFF;
+    d->filter = NMEA_FILTER_EMA;
+    if (filter == NMEA_FILTER_EMA) return true;
+    for (uint8_t i = 0; i < GPS_FILTER_SLOTS; i++) {
+        nmea_filter_state_t &st = mFilterState[i];
+        if (st.owner != NMEA_UNTRACKED) continue;
+        memset(&st, 0, sizeof(st));
+        st.owner = kNmeaValueSlots.slot[idx];
+        st.n = n;
+        d->filterState = i;
+        d->filter = filter;
+        return true;
     }
+    return false;
 }
 
+/*!
+    @brief Memory taken by the histories added with initHistory()
+    @return Bytes of the history pool in use
+*/
+
+size_t Adafruit_GPS::HistoryBytesUsed(void) { return mHistoryPool.BytesUsed(); }
+
+/*!
+    @brief Memory left for more histories
+    @return Bytes of the history pool still free
+*/
+
+size_t Adafruit_GPS::HistoryBytesFree(void) { return mHistoryPool.BytesFree(); }
+
+/*!
+    @brief Most histories that were ever in use at once, to size GPS_HISTORY_BLOCKS for a product
+    @return Blocks of the history pool in use at the worst time
+*/
+
+uint8_t Adafruit_GPS::HistoryBlocksHighWater(void) { return mHistoryPool.BlocksHighWater(); }
+
 /*!
     @brief Print out the current state of a data value. Primarily useful as
     a debugging aid.
@@ -396,26 +474,30 @@ void Adafruit_GPS::removeHistory(nmea_index_t idx) {
 */
 
 void Adafruit_GPS::showDataValue(nmea_index_t idx, int n) {
+    const nmea_datavalue_t *d = Value(idx);
     printf("idx: ");
     if (idx < 10) printf(" ");
-    printf("%d, %s, %.4f, %.4f, at %lu ms, tau = %lu ms, type: %d, ockam: %d\n", idx, mVal[idx].label, mVal[idx].latest,
-           mVal[idx].smoothed, mVal[idx].mLastUpdate, mVal[idx].response, mVal[idx].type, mVal[idx].ockam);
-    if (mVal[idx].hist) {
-        printf("     History at %lu second intervals:  %f", mVal[idx].hist->historyInterval,
-               mVal[idx].hist->data[mVal[idx].hist->n - 1]);
-        for (unsigned i = mVal[idx].hist->n - 2; i >= max(mVal[idx].hist->n - n, (unsigned)0);
-             i--) {  // most recent first
-            printf(", %f", mVal[idx].hist->data[i]);
+    if (d == NULL) {
+        printf("%d, not tracked in this build\n", idx);
+        return;
+    }
+    printf("%d, %s, %.4f, %.4f, at %" PRIu32 " ms, tau = %u ms, type: %d, ockam: %d\n", idx, d->label, d->latest,
+           d->smoothed, d->mLastUpdate, d->response, d->type, d->ockam);
+    if (d->hist) {
+        const nmea_history_t *h = d->hist;
+        printf("     History at %u second intervals:  %d", h->historyInterval, h->Latest());
+        for (unsigned i = 2; i <= min((unsigned)n, h->n); i++) {  // most recent first
+            printf(", %d", h->At(h->n - i));
         }
         printf("\n");
     }
     if (idx == NMEA_LAT) {
-        printf("     mLatitude (DDMM.mmmm): %.4f, mLat: %c, mLatitudeDegrees: %.8f, mLatitude_fixed: %ld\n", mLatitude,
-               mLat, mLatitudeDegrees, mLatitude_fixed);
+        printf("     mLatitude (DDMM.mmmm): %.4f, mLat: %c, mLatitudeDegrees: %.8f, mLatitude_fixed: %" PRId32 "\n",
+               Latitude(), mLat, LatitudeDegrees(), mLatitude_fixed);
     }
     if (idx == NMEA_LON) {
-        printf("     mLongitude (DDMM.mmmm): %.4f, mLon: %c, mLongitudeDegrees: %.8f, mLongitude_fixed: %ld\n",
-               mLongitude, mLon, mLongitudeDegrees, mLongitude_fixed);
+        printf("     mLongitude (DDMM.mmmm): %.4f, mLon: %c, mLongitudeDegrees: %.8f, mLongitude_fixed: %" PRId32 "\n",
+               Longitude(), mLon, LongitudeDegrees(), mLongitude_fixed);
     }
 }
 
@@ -426,7 +508,8 @@ void Adafruit_GPS::showDataValue(nmea_index_t idx, int n) {
 */
 
 bool Adafruit_GPS::isCompoundAngle(nmea_index_t idx) {
-    if ((int)(mVal[idx].type / 10) == 1)  // mAngle with sin/cos component recording
+    const nmea_datavalue_t *d = Value(idx);
+    if (d && (int)(d->type / 10) == 1)  // mAngle with sin/cos component recording
         return true;
     return false;
 }
@@ -440,31 +523,8 @@ bool Adafruit_GPS::isCompoundAngle(nmea_index_t idx) {
 */
 
 nmea_float_t Adafruit_GPS::boatAngle(nmea_float_t s, nmea_float_t c) {
-    // put the sin mAngle in -90 to 90 range
-    nmea_float_t sAng = asin(s) * (nmea_float_t)RAD_TO_DEG;
-    while (sAng < -90) sAng += 180.0f;
-    while (sAng > 90) sAng -= 180.0f;
-    // put the cos mAngle in 0 to 180 range
-    nmea_float_t cAng = acos(c) * (nmea_float_t)RAD_TO_DEG;
-    while (cAng < 0) cAng += 180.0f;
-    while (cAng > 180) cAng -= 180.0f;
-    // Pick the most accurate representation and translate
-    if (cAng < 45)
-        return sAng;  //            Close hauled
-    else {
-        if (cAng > 135) {  //       Running
-            if (sAng > 0)
-                return 180 - sAng;  //     on starboard tack
-            else
-                return -180 - sAng;  //    on port tack
-        } else {                     // Reaching
-            if (sAng < 0)
-                return -cAng;  //          on port tack
-            else
-                return cAng;  //           on starboard tack
-        }
-    }
-    return 9999;  // you can't get here, but there must be an explicit return
+    // the smoothed sine and cosine shrink towards 0 when the angle wanders, their ratio still holds the direction
+    return FastAtan2(s, c);
 }
 
 /*!
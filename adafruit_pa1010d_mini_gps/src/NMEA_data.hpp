@@ -7,6 +7,8 @@
 
 #ifndef _NMEA_DATA_H
 #define _NMEA_DATA_H
+#include <string.h>
+
 #include "utils.hpp"
 
 #define NMEA_MAX_WP_ID 20        ///< maximum length of a waypoint ID name, including terminating 0
@@ -44,15 +46,71 @@ typedef NMEA_FLOAT_T nmea_float_t;  ///< the type of variables to use for floati
   Only some tags have history in order to save memory. Most of the memory
   cost is directly in the array.
 
+  The array is circular: a new value overwrites the oldest one at head, so
+  adding a value costs the same whatever the size of the history. Use At(),
+  the iterators or CopyOut() rather than indexing data directly.
+
   192 history values taken every 20 mSeconds covers just over an mHour.
  **************************************************************************/
-typedef struct {
-    int16_t *data = NULL;           ///< array of ints, oldest first
+typedef struct nmea_history_s {
+    int16_t *data = NULL;           ///< circular array of ints, the oldest at head
     unsigned n = 0;                 ///< number of history array elements
+    unsigned head = 0;              ///< index of the oldest element, the next one is written there
     uint32_t lastHistory = 0;       ///< millis() when history was last updated
     uint16_t historyInterval = 20;  ///< mSeconds between history updates
     nmea_float_t scale = 1.0;       ///< history = (smoothed - offset) * scale
     nmea_float_t offset = 0.0;      ///< value = (float) history / scale + offset
+
+    /// add a value, dropping the oldest
+    void Push(int16_t v) {
+        data[head] = v;
+        head = head + 1 == n ? 0 : head + 1;
+    }
+
+    /// @return Element i counted from the oldest, i < n
+    int16_t At(unsigned i) const {
+        i += head;
+        return data[i >= n ? i - n : i];
+    }
+
+    /// @return The most recent element
+    int16_t Latest() const { return data[head ? head - 1 : n - 1]; }
+
+    /*!
+        @brief Copy the most recent elements out, oldest first, in at most two block copies
+        @param out Destination
+        @param max Capacity of out
+        @return Number of elements copied, the smaller of max and n
+    */
+    unsigned CopyOut(int16_t *out, unsigned max) const {
+        unsigned len = max < n ? max : n;
+        unsigned start = head + n - len;  // oldest element wanted, unwrapped
+        if (start >= n) start -= n;
+        unsigned first = n - start < len ? n - start : len;
+        memcpy(out, data + start, first * sizeof(int16_t));
+        memcpy(out + first, data, (len - first) * sizeof(int16_t));
+        return len;
+    }
+
+    /// walks the history from the oldest element to the most recent
+    class const_iterator {
+       public:
+        const_iterator(const nmea_history_s *h, unsigned i) : mHist(h), mI(i) {}
+        int16_t operator*() const { return mHist->At(mI); }
+        const_iterator &operator++() {
+            mI++;
+            return *this;
+        }
+        bool operator!=(const const_iterator &o) const { return mI != o.mI; }
+
+       private:
+        const nmea_history_s *mHist;
+        unsigned mI;
+    };
+    /// @return Iterator at the oldest element
+    const_iterator begin() const { return const_iterator(this, 0); }
+    /// @return Iterator past the most recent element
+    const_iterator end() const { return const_iterator(this, n); }
 } nmea_history_t;
 
 /**************************************************************************/
@@ -80,6 +138,25 @@ typedef enum {
     NMEA_HHMMSS = 30              ///< A time stored in HHMMSS format like it comes in from the GPS
 } nmea_value_type_t;
 
+/// how NewDataValue() smooths a data value, see initFilter()
+typedef enum : uint8_t {
+    NMEA_FILTER_EMA = 0,     ///< exponential moving average with the response as time constant, the default
+    NMEA_FILTER_ALPHA_BETA,  ///< tracks the rate of change as well, no lag on a steady trend
+    NMEA_FILTER_MEDIAN       ///< median of the last few raw values, drops single outliers
+} nmea_filter_t;
+
+#define NMEA_MIN_RESPONSE 16  ///< shortest smoothing time constant in ms, shorter ones are raised to this
+
+/*!
+    @brief Reciprocal of a smoothing time constant, worked out once when the response is set so that smoothing
+    needs no division
+    @param response Time constant in ms
+    @return 2^20 / response, for at least NMEA_MIN_RESPONSE
+*/
+constexpr uint16_t NmeaDecayFor(uint32_t response) {
+    return response <= NMEA_MIN_RESPONSE ? 0xFFFF : (uint16_t)(((1UL << 20) + response / 2) / response);
+}
+
 /**************************************************************************/
 /*!
     Struct to contain all the details associated with an NMEA data value that
@@ -90,11 +167,14 @@ typedef enum {
 /**************************************************************************/
 typedef struct {
     nmea_float_t latest = 0.0;                   ///< the most recently obtained value
-    nmea_float_t smoothed = 0.0;                 ///< smoothed value based on weight of dt/response
+    nmea_float_t smoothed = 0.0;                 ///< smoothed value, weighting the new value 1 - exp(-dt/response)
     uint32_t mLastUpdate = 0;                    ///< millis() when latest was last set
     uint16_t response = 1000;                    ///< time constant in millis for smoothing
+    uint16_t decay = NmeaDecayFor(1000);         ///< NmeaDecayFor(response), set with it by initDataValue()
     nmea_value_type_t type = NMEA_SIMPLE_FLOAT;  ///< type of float data value represented
     byte ockam = 0;                              ///< the corresponding Ockam Instruments tag number, 0-128
+    nmea_filter_t filter = NMEA_FILTER_EMA;      ///< smoothing applied by NewDataValue()
+    uint8_t filterState = 0xFF;                  ///< state block of an alpha-beta or median filter, 0xFF if none
     nmea_history_t *hist = NULL;                 ///< pointer to history, if any
     char *label = NULL;                          ///< pointer to quantity label, if any
     char *unit = NULL;                           ///< pointer to units label, if any
@@ -184,4 +264,62 @@ typedef enum {
                     ///< but does define size of data value array required.
 } nmea_index_t;     ///< Indices for data values expected to change often with time
 
+#define NMEA_UNTRACKED 0xFF  ///< slot of a data value that is not tracked
+
+/// where each data value lives in the compacted mVal[] array, built at compile time
+typedef struct {
+    uint8_t slot[NMEA_MAX_INDEX];  ///< slot in mVal[] of each index, NMEA_UNTRACKED if it has none
+    uint8_t count;                 ///< number of slots, the size of mVal[]
+} nmea_value_slots_t;
+
+/*!
+    @brief Does a data value carry sine and cosine companions right after it in the enum?
+    @param idx The data index
+    @return true for the compound angles data_init() sets up
+*/
+constexpr bool NmeaHasSinCos(nmea_index_t idx) {
+    return idx == NMEA_COG || idx == NMEA_AWA || idx == NMEA_TWA || idx == NMEA_TWD || idx == NMEA_HDG ||
+           idx == NMEA_HDT;
+}
+
+/*!
+    @brief Give every listed data value a slot, in enum order so that a compound angle and its sine and cosine
+    companions, which are added automatically, stay in consecutive slots
+    @param tracked The data values to keep
+    @return The slot table
+*/
+template <size_t N>
+constexpr nmea_value_slots_t NmeaBuildValueSlots(const nmea_index_t (&tracked)[N]) {
+    bool want[NMEA_MAX_INDEX] = {};
+    for (size_t i = 0; i < N; i++) {
+        want[tracked[i]] = true;
+        if (NmeaHasSinCos(tracked[i])) want[tracked[i] + 1] = want[tracked[i] + 2] = true;
+    }
+    nmea_value_slots_t slots{};
+    for (int idx = 0; idx < NMEA_MAX_INDEX; idx++) slots.slot[idx] = want[idx] ? slots.count++ : NMEA_UNTRACKED;
+    return slots;
+}
+
+/// @return A slot table that tracks every data value
+constexpr nmea_value_slots_t NmeaAllValueSlots() {
+    nmea_value_slots_t slots{};
+    for (int idx = 0; idx < NMEA_MAX_INDEX; idx++) slots.slot[idx] = slots.count++;
+    return slots;
+}
+
+/*************************************************************************
+  The data values an Adafruit_GPS keeps. By default every one of them, about
+  40 bytes each on the RP2040. A GPS only product can list the few it uses,
+  e.g. -DGPS_TRACKED_VALUES=NMEA_HDOP,NMEA_LAT,NMEA_LON,NMEA_SOG,NMEA_COG
+  (or the GPS_TRACKED_VALUES CMake variable), and every other value then
+  takes no RAM and NewDataValue() compiles to nothing for it.
+ **************************************************************************/
+#ifdef GPS_TRACKED_VALUES
+constexpr nmea_index_t kNmeaTrackedValues[] = {GPS_TRACKED_VALUES};
+constexpr nmea_value_slots_t kNmeaValueSlots = NmeaBuildValueSlots(kNmeaTrackedValues);
+#else
+constexpr nmea_value_slots_t kNmeaValueSlots = NmeaAllValueSlots();
+#endif
+static_assert(kNmeaValueSlots.count > 0, "GPS_TRACKED_VALUES must name at least one data value");
+
 #endif  // _NMEA_DATA_H
@@ -0,0 +1,391 @@
+/*!
+  @file NMEA_fields.hpp
+
+  Zero copy field tokenizer and allocation free number parsers for NMEA
+  sentences. A sentence is split once into views of its comma separated
+  fields, and the handlers in NMEA_parse.cpp read the views directly instead
+  of walking the string again with strchr() and atof() for every field.
+
+  NmeaFields::Scan() goes further and walks a whole sentence once, a machine
+  word (or an SSE2 register on the host) at a time, computing the checksum
+  XOR, finding the '*' and splitting the fields in the same pass.
+
+  The decimal parsers work on integers. NmeaParseDouble() converts the
+  integer mantissa with a single correctly rounded division, so it returns
+  exactly what atof() returned for the short fields NMEA uses.
+
+  Adapted by Furhad Jidda for pico
+*/
+
+#ifndef _NMEA_FIELDS_H
+#define _NMEA_FIELDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define NMEA_MAX_FIELDS 24  ///< most fields kept for one sentence, MDA has 20 and GSV 19
+
+#define NMEA_SCAN_SPECIAL 0x2D  ///< every character Scan() has to look at (NUL, CR, LF, '*', ',') is below '-'
+
+/// view of one field inside a sentence, not terminated
+typedef struct {
+    const char *str;  ///< first character of the field
+    uint8_t len;      ///< number of characters up to the next ',' or '*'
+} nmea_field_t;
+
+/// framing of a sentence found by NmeaFields::Scan()
+typedef struct {
+    const char *star;  ///< the last '*' of the sentence, NULL if there is none
+    uint8_t sum;       ///< XOR of every character between the leading '$' and star
+} nmea_scan_t;
+
+/// unsigned decimal number as a scaled integer, value = mantissa / 10^digits
+typedef struct {
+    uint32_t mantissa;  ///< all significant digits with the decimal point removed
+    uint8_t digits;     ///< number of digits after the decimal point
+    bool negative;      ///< a leading '-' was present
+} nmea_decimal_t;
+
+/// a DDDMM.mmmm angle broken into integer parts
+typedef struct {
+    int32_t dddmm;      ///< digits before the decimal point
+    uint32_t fraction;  ///< digits after the decimal point, as an integer
+    uint8_t digits;     ///< number of digits in fraction
+} nmea_coord_t;
+
+/*!
+    @brief The comma separated fields of one sentence, found in a single pass.
+*/
+class NmeaFields {
+   public:
+    /*!
+        @brief Split the fields that start at p. Stops at the '*' before the
+        checksum, a line ending or the end of the string.
+        @param p Pointer to the first field, just past the sentence ID and comma
+        @return Number of fields found
+    */
+    uint8_t Split(const char *p) {
+        mCount = 0;
+        const char *start = p;
+        for (;; p++) {
+            char c = *p;
+            if (c == ',' || c == '*' || c == 0 || c == '\r' || c == '\n') {
+                if (mCount < NMEA_MAX_FIELDS) mFields[mCount++] = {start, (uint8_t)(p - start)};
+                if (c != ',') break;
+                start = p + 1;
+            }
+        }
+        return mCount;
+    }
+
+    /*!
+        @brief Walk a whole sentence once, computing the checksum XOR, finding the last '*' and splitting the
+        fields after the sentence ID exactly like Split(strchr(nmea, ',') + 1) would. Characters are read a
+        machine word, or an SSE2 register on the host, at a time, and only chunks holding a character below
+        NMEA_SCAN_SPECIAL are looked at one by one. Words are loaded aligned, the characters before the first
+        and after the last whole word byte by byte; SSE2 loads unaligned and reads the last partial chunk as
+        the kChunkSize characters ending at len, with the ones already seen masked off.
+        @param nmea The sentence, starting with '$' or '!'
+        @param len Number of characters in it, strlen(nmea); nothing past them is read
+        @param scan Filled with the last '*' and the XOR of the characters before it
+        @return Number of fields found
+    */
+    uint8_t Scan(const char *nmea, size_t len, nmea_scan_t *scan) {
+        mCount = 0;
+        mState = kBeforeFields;
+        scan->star = NULL;
+        scan->sum = 0;
+        const char *end = nmea + len;
+        const char *p = len ? nmea + 1 : end;  // the checksum does not include the leading '$'
+        uint8_t sum = 0;
+#ifdef __SSE2__
+        const __m128i special = _mm_set1_epi8(NMEA_SCAN_SPECIAL);
+        __m128i acc = _mm_setzero_si128();
+        while (p < end) {
+            const size_t rest = end - p;
+            uint8_t skip = 0;  // lanes of this chunk scanned already
+            __m128i v;
+            if (rest >= kChunkSize) {
+                v = _mm_loadu_si128((const __m128i *)p);
+            } else if (len >= kChunkSize) {
+                skip = kChunkSize - rest;
+                p -= skip;
+                v = _mm_and_si128(_mm_loadu_si128((const __m128i *)p),
+                                  _mm_loadu_si128((const __m128i *)(kTail + rest)));
+            } else {
+                break;  // shorter than a chunk, byte by byte below
+            }
+            // signed compare, so bytes above 0x7F are flagged too and simply skipped below
+            unsigned flags = (unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(v, special)) & (0xFFFFu << skip);
+            if (flags) {
+                const uint8_t prefix = sum ^ foldChunk(acc);
+                for (; flags; flags &= flags - 1) {
+                    const uint8_t lane = __builtin_ctz(flags);
+                    if (p[lane] == '*') scan->sum = prefix ^ xorChars(p + skip, lane - skip);
+                    if (!scanChar(p[lane], p + lane, scan)) return mCount;
+                }
+            }
+            acc = _mm_xor_si128(acc, v);
+            p += kChunkSize;
+        }
+#else
+        // one character at a time up to the first aligned word
+        for (; p < end && ((uintptr_t)p & (kChunkSize - 1)) != 0; p++)
+            if (!scanByte(p, &sum, scan)) return mCount;
+        nmea_chunk_t acc = 0;
+        for (; (size_t)(end - p) >= kChunkSize; p += kChunkSize) {
+            nmea_chunk_t w;
+            memcpy(&w, p, kChunkSize);  // aligned, so a single load
+            // high bit set in every lane below NMEA_SCAN_SPECIAL, lanes above a true one may be false positives
+            nmea_chunk_t flags = (w - kLanes * NMEA_SCAN_SPECIAL) & ~w & (kLanes * 0x80);
+            if (flags) {
+                const uint8_t prefix = sum ^ foldChunk(acc);
+                for (uint8_t lane = 0; lane < kChunkSize; lane++) {
+                    if (!(flags & ((nmea_chunk_t)0x80 << (lane * 8)))) continue;
+                    if (p[lane] == '*') scan->sum = prefix ^ xorChars(p, lane);
+                    if (!scanChar(p[lane], p + lane, scan)) return mCount;
+                }
+            }
+            acc ^= w;
+        }
+#endif
+        // the rest one at a time, then the end of the string as the NUL that would follow it
+        sum ^= foldChunk(acc);
+        for (; p < end; p++)
+            if (!scanByte(p, &sum, scan)) return mCount;
+        scanChar(0, end, scan);
+        return mCount;
+    }
+
+    /// @return Number of fields found by Split() or Scan()
+    uint8_t Count() const { return mCount; }
+
+    /// @return The field at index i, or an empty field past the end of the sentence
+    const nmea_field_t &operator[](uint8_t i) const { return i < mCount ? mFields[i] : kEmpty; }
+
+   private:
+#ifdef __SSE2__
+    static constexpr size_t kChunkSize = 16;
+    /// loaded at kTail + n, keeps the last n lanes of a chunk
+    static constexpr uint8_t kTail[2 * kChunkSize] = {0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+                                                      0,    0,    0,    0,    0,    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                                      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    static uint8_t foldChunk(__m128i v) {
+        v = _mm_xor_si128(v, _mm_srli_si128(v, 8));
+        v = _mm_xor_si128(v, _mm_srli_si128(v, 4));
+        uint32_t w = (uint32_t)_mm_cvtsi128_si32(v);
+        w ^= w >> 16;
+        return (uint8_t)(w ^ (w >> 8));
+    }
+#else
+    typedef uintptr_t nmea_chunk_t;  ///< 4 bytes on the RP2040, 8 on a 64 bit host
+    static constexpr size_t kChunkSize = sizeof(nmea_chunk_t);
+    static constexpr nmea_chunk_t kLanes = (nmea_chunk_t)-1 / 0xFF;  ///< 0x01 in every byte
+    static uint8_t foldChunk(nmea_chunk_t w) {
+        for (size_t shift = kChunkSize * 4; shift >= 8; shift /= 2) w ^= w >> shift;
+        return (uint8_t)w;
+    }
+#endif
+    static constexpr nmea_field_t kEmpty = {"", 0};
+    enum : uint8_t { kBeforeFields, kInFields, kAfterFields };
+
+    /// XOR of the first n characters of a chunk
+    static uint8_t xorChars(const char *p, uint8_t n) {
+        uint8_t sum = 0;
+        for (uint8_t i = 0; i < n; i++) sum ^= p[i];
+        return sum;
+    }
+
+    /// one character outside the chunks, sum is the XOR of the characters before it
+    bool scanByte(const char *p, uint8_t *sum, nmea_scan_t *scan) {
+        const char c = *p;
+        if (c == '*') scan->sum = *sum;
+        if ((uint8_t)c < NMEA_SCAN_SPECIAL && !scanChar(c, p, scan)) return false;
+        *sum ^= c;
+        return true;
+    }
+
+    /// handle the character c at p below NMEA_SCAN_SPECIAL, the caller has already set scan->sum for a '*'
+    bool scanChar(char c, const char *p, nmea_scan_t *scan) {
+        if (c == '*') {
+            scan->star = p;
+        } else if (c != ',' && c != '\r' && c != '\n' && c != 0) {
+            return true;  // some other punctuation
+        }
+        if (mState == kBeforeFields) {
+            if (c == ',') {
+                mState = kInFields;
+                mStart = p + 1;
+            } else if (c == 0) {
+                mFields[mCount++] = {p, 0};  // no comma at all, a single empty field like Split("")
+            }
+        } else if (mState == kInFields) {
+            if (mCount < NMEA_MAX_FIELDS) mFields[mCount++] = {mStart, (uint8_t)(p - mStart)};
+            if (c == ',')
+                mStart = p + 1;
+            else
+                mState = kAfterFields;
+        }
+        return c != 0;
+    }
+
+    nmea_field_t mFields[NMEA_MAX_FIELDS];
+    uint8_t mCount = 0;
+    uint8_t mState = kBeforeFields;  ///< where Scan() is relative to the fields
+    const char *mStart = NULL;       ///< first character of the field Scan() is in
+};
+
+/// powers of ten used to scale decimal mantissas, exact in a double
+static constexpr double kNmeaPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+/*!
+    @brief Is the field empty?
+    @param f The field
+    @return true if there is nothing between the separators
+*/
+inline bool NmeaIsEmpty(const nmea_field_t &f) { return f.len == 0; }
+
+/*!
+    @brief First character of a field, for single letter fields like N/S or A/V
+    @param f The field
+    @return The character, or 0 if the field is empty
+*/
+inline char NmeaFirstChar(const nmea_field_t &f) { return f.len ? f.str[0] : 0; }
+
+/*!
+    @brief Parse the leading integer of a field, like atol()
+    @param f The field
+    @return The value, 0 if there are no digits
+*/
+inline long NmeaParseLong(const nmea_field_t &f) {
+    uint8_t i = 0;
+    bool negative = false;
+    if (i < f.len && (f.str[i] == '-' || f.str[i] == '+')) negative = f.str[i++] == '-';
+    long v = 0;
+    for (; i < f.len && f.str[i] >= '0' && f.str[i] <= '9'; i++) v = v * 10 + (f.str[i] - '0');
+    return negative ? -v : v;
+}
+
+/*!
+    @brief Parse a decimal field into a scaled integer. Digits beyond the
+    ninth significant one are ignored, which is well past anything a GPS
+    reports.
+    @param f The field
+    @param d Filled with the mantissa, digit count and sign
+    @return false if the field holds no digits
+*/
+inline bool NmeaParseDecimal(const nmea_field_t &f, nmea_decimal_t *d) {
+    uint8_t i = 0;
+    d->mantissa = 0;
+    d->digits = 0;
+    d->negative = false;
+    if (i < f.len && (f.str[i] == '-' || f.str[i] == '+')) d->negative = f.str[i++] == '-';
+    bool fraction = false;
+    bool any = false;
+    uint8_t significant = 0;
+    for (; i < f.len; i++) {
+        char c = f.str[i];
+        if (c == '.' && !fraction) {
+            fraction = true;
+        } else if (c >= '0' && c <= '9') {
+            any = true;
+            if (significant == 9) {
+                if (!fraction) return false;  // integer part too large for the mantissa
+                continue;
+            }
+            if (d->mantissa || c != '0') significant++;
+            d->mantissa = d->mantissa * 10 + (c - '0');
+            if (fraction) d->digits++;
+        } else {
+            break;
+        }
+    }
+    return any;
+}
+
+/*!
+    @brief Convert a scaled decimal to a double, rounding exactly like atof()
+    @param d The decimal
+    @return The value
+*/
+inline double NmeaDecimalToDouble(const nmea_decimal_t &d) {
+    double v = (double)d.mantissa / kNmeaPow10[d.digits];
+    return d.negative ? -v : v;
+}
+
+/*!
+    @brief Parse a decimal field to a double, a drop in for atof() on a field
+    @param f The field
+    @return The value, 0 if there are no digits
+*/
+inline double NmeaParseDouble(const nmea_field_t &f) {
+    nmea_decimal_t d;
+    if (!NmeaParseDecimal(f, &d)) return 0.0;
+    return NmeaDecimalToDouble(d);
+}
+
+/*!
+    @brief Parse a decimal field as a fixed point integer with a set number
+    of decimal places, truncating any further digits. Use 2 places for DOP
+    values, 1 for altitude in decimetres and so on.
+    @param f The field
+    @param places Decimal places to keep, at most 9
+    @return value * 10^places, 0 if there are no digits
+*/
+inline int32_t NmeaParseFixed(const nmea_field_t &f, uint8_t places) {
+    nmea_decimal_t d;
+    if (!NmeaParseDecimal(f, &d)) return 0;
+    int64_t v = d.mantissa;
+    for (uint8_t i = d.digits; i < places; i++) v *= 10;
+    for (uint8_t i = places; i < d.digits; i++) v /= 10;
+    return (int32_t)(d.negative ? -v : v);
+}
+
+/*!
+    @brief Parse a hhmmss.sss time field
+    @param f The field
+    @param hhmmss Filled with the whole seconds part, e.g. 193043
+    @param milliseconds Filled with the fractional seconds in ms, 0 if absent
+    @return false if the field is empty
+*/
+inline bool NmeaParseTime(const nmea_field_t &f, uint32_t *hhmmss, uint16_t *milliseconds) {
+    if (NmeaIsEmpty(f)) return false;
+    uint8_t i = 0;
+    uint32_t t = 0;
+    for (; i < f.len && f.str[i] >= '0' && f.str[i] <= '9'; i++) t = t * 10 + (f.str[i] - '0');
+    uint16_t ms = 0;
+    if (i < f.len && f.str[i] == '.') {
+        uint16_t scale = 100;
+        for (i++; i < f.len && f.str[i] >= '0' && f.str[i] <= '9' && scale; i++, scale /= 10)
+            ms += (f.str[i] - '0') * scale;
+    }
+    *hhmmss = t;
+    *milliseconds = ms;
+    return true;
+}
+
+/*!
+    @brief Split a DDDMM.mmmm field into integer parts
+    @param f The field
+    @param c Filled with the parts
+    @return false if there is no decimal point within the first six characters
+*/
+inline bool NmeaParseCoord(const nmea_field_t &f, nmea_coord_t *c) {
+    uint8_t dot = 0;
+    while (dot < f.len && f.str[dot] != '.') dot++;
+    if (dot == f.len || dot > 6) return false;
+    c->dddmm = NmeaParseLong({f.str, dot});
+    c->fraction = 0;
+    c->digits = 0;
+    for (uint8_t i = dot + 1; i < f.len && f.str[i] >= '0' && f.str[i] <= '9' && c->digits < 9; i++) {
+        c->fraction = c->fraction * 10 + (f.str[i] - '0');
+        c->digits++;
+    }
+    return true;
+}
+
+#endif  // _NMEA_FIELDS_H
@@ -16,6 +16,7 @@
   All text above must be included in any redistribution
 */
 
+#include <math.h>
 #include <string.h>
 
 #include <Adafruit_GPS.hpp>
@@ -25,6 +26,97 @@
 #include <cstdio>
 #endif
 
+namespace {
+
+/// pack the two letter talker at s into an integer, e.g. "GP" -> 0x4750
+constexpr uint16_t NmeaSourceId(const char *s) { return (uint16_t)((uint8_t)s[0] << 8 | (uint8_t)s[1]); }
+
+/// pack the three letter sentence name at s into an integer, e.g. "GGA" -> 0x474741, 0 if s is shorter
+constexpr uint32_t NmeaSentenceId(const char *s) {
+    return (s[0] && s[1]) ? ((uint32_t)(uint8_t)s[0] << 16 | (uint32_t)(uint8_t)s[1] << 8 | (uint8_t)s[2]) : 0;
+}
+
+/// multiplicative hash of a packed sentence ID into NMEA_SENTENCE_HASH_BITS bits
+constexpr uint8_t NmeaSentenceSlot(uint32_t id, uint32_t mult) {
+    return (uint8_t)((uint32_t)(id * mult) >> (32 - NMEA_SENTENCE_HASH_BITS));
+}
+
+/// search for a multiplier that maps every sentence in the table to its own slot
+template <size_t N>
+constexpr nmea_sentence_hash_t BuildSentenceHash(const nmea_sentence_t (&table)[N]) {
+    static_assert(N < 0xFF, "sentence table rows are stored as 8 bit slot values");
+    for (uint32_t mult = 0x9E3779B1u, tries = 0; tries < 20000; mult += 2, tries++) {
+        nmea_sentence_hash_t hash{};
+        hash.mult = mult;
+        bool collision = false;
+        for (size_t i = 0; i < N && !collision; i++) {
+            uint8_t slot = NmeaSentenceSlot(table[i].id, mult);
+            if (hash.slot[slot])
+                collision = true;
+            else
+                hash.slot[slot] = (uint8_t)(i + 1);
+        }
+        if (!collision) return hash;
+    }
+    return nmea_sentence_hash_t{};  // mult of 0 is rejected by the static_assert in FindSentence()
+}
+
+/// valid two letter source ids, "P" alone is accepted for proprietary sentences
+constexpr uint16_t kNmeaSources[] = {NmeaSourceId("II"), NmeaSourceId("WI"), NmeaSourceId("GP"), NmeaSourceId("PG"),
+                                     NmeaSourceId("GN"), NmeaSourceId("GL"), NmeaSourceId("GA")};
+
+}  // namespace
+
+/*!
+    Every sentence Check() recognizes. Rows with a handler are parseable, rows
+    without are known but not parsed. Put the GPS sentences from Adafruit_GPS
+    at the top to make pruning excess code easier, otherwise keep them
+    alphabetical.
+*/
+constexpr nmea_sentence_t Adafruit_GPS::sentenceTable[] = {
+    {NmeaSentenceId("GGA"), &Adafruit_GPS::parseGGA},
+    {NmeaSentenceId("GLL"), &Adafruit_GPS::parseGLL},
+    {NmeaSentenceId("GSA"), &Adafruit_GPS::parseGSA},
+    {NmeaSentenceId("GSV"), &Adafruit_GPS::parseGSV},
+    {NmeaSentenceId("RMC"), &Adafruit_GPS::parseRMC},
+    {NmeaSentenceId("TOP"), &Adafruit_GPS::parseTOP},
+#ifdef NMEA_EXTENSIONS
+    {NmeaSentenceId("DBT"), &Adafruit_GPS::parseDBT},
+    {NmeaSentenceId("HDM"), &Adafruit_GPS::parseHDM},
+    {NmeaSentenceId("HDT"), &Adafruit_GPS::parseHDT},
+    {NmeaSentenceId("MDA"), &Adafruit_GPS::parseMDA},
+    {NmeaSentenceId("MTW"), &Adafruit_GPS::parseMTW},
+    {NmeaSentenceId("MWV"), &Adafruit_GPS::parseMWV},
+    {NmeaSentenceId("RMB"), &Adafruit_GPS::parseRMB},
+    {NmeaSentenceId("TXT"), &Adafruit_GPS::parseTXT},
+    {NmeaSentenceId("VHW"), &Adafruit_GPS::parseVHW},
+    {NmeaSentenceId("VLW"), &Adafruit_GPS::parseVLW},
+    {NmeaSentenceId("VPW"), &Adafruit_GPS::parseVPW},
+    {NmeaSentenceId("VWR"), &Adafruit_GPS::parseVWR},
+    {NmeaSentenceId("WCV"), &Adafruit_GPS::parseWCV},
+    {NmeaSentenceId("XTE"), &Adafruit_GPS::parseXTE},
+    // known, but not parseable
+    {NmeaSentenceId("APB"), NULL},
+    {NmeaSentenceId("DPT"), NULL},
+    {NmeaSentenceId("HDG"), NULL},
+    {NmeaSentenceId("MWD"), NULL},
+    {NmeaSentenceId("ROT"), NULL},
+    {NmeaSentenceId("RPM"), NULL},
+    {NmeaSentenceId("RSA"), NULL},
+    {NmeaSentenceId("VDR"), NULL},
+    {NmeaSentenceId("VTG"), NULL},
+    {NmeaSentenceId("ZDA"), NULL},
+#else  // keep the table short to save memory
+    // known, but not parseable
+    {NmeaSentenceId("DBT"), NULL},
+    {NmeaSentenceId("HDM"), NULL},
+    {NmeaSentenceId("HDT"), NULL},
+#endif
+};
+
+/// perfect hash from packed sentence ID to sentenceTable row, computed at compile time
+constexpr nmea_sentence_hash_t Adafruit_GPS::sentenceHash = BuildSentenceHash(sentenceTable);
+
 /*!
     @brief Parse a standard NMEA string and update the relevant variables. Sentences start with a $, then a two
    character source identifier, then a three character sentence identifier that defines the format, then a comma and
@@ -40,433 +132,44 @@
    checksum.NMEA_EXTENSIONS must be defined in order to Parse more than basic GPS module sentences.
 
     @param nmea Pointer to the NMEA string
+    @param stamp Optional, when the sentence was read, from TryPopSentence() or SentenceStamp(); the epoch it opens
+   takes the stamp as gps_fix_t::receivedUs
     @return True if successfully parsed, false if fails Check or parsing
 */
 
-#include "constants.hpp"
-
-bool Adafruit_GPS::Parse(char *nmea) {
-    if (!Check(nmea)) return false;
-    // passed the Check, so there's a valid source in thisSource and a valid
-    // sentence in thisSentence
-    char *p = nmea;          // Pointer to move through the sentence -- good parsers are
-                             // non-destructive
-    p = strchr(p, ',') + 1;  // Skip to char after the next comma, then Check.
-
-    // This may look inefficient, but an M0 will get down the list in about 1 us /
-    // strcmp()! Put the GPS sentences from Adafruit_GPS at the top to make
-    // pruning excess code easier. Otherwise, keep them alphabetical for ease of
-    // reading.
-    if (!strcmp(thisSentence, "GGA")) {
-        //************************************GGA
-        // Adafruit from Actisense NGW-1 from SH CP150C
-        parseTime(p);
-        p = strchr(p, ',') + 1;  // Parse time with specialized function
-        // Parse out both mLatitude and direction, then go to next field, or fail
-        if (parseCoord(p, &mLatitudeDegrees, &mLatitude, &mLatitude_fixed, &mLat))
-            NewDataValue(NMEA_LAT, mLatitudeDegrees);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        // Parse out both mLongitude and direction, then go to next field, or fail
-        if (parseCoord(p, &mLongitudeDegrees, &mLongitude, &mLongitude_fixed, &mLon))
-            NewDataValue(NMEA_LON, mLongitudeDegrees);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) {          // if it's a , (or a * at end of sentence) the value is
-                                    // not included
-            mFixquality = atoi(p);  // needs additional processing
-            if (mFixquality > 0) {
-                mFix = true;
-                mLastFix = mSentTime;
-            } else
-                mFix = false;
-        }
-        p = strchr(p, ',') + 1;  // then move on to the next
-        // Most can just be parsed with atoi() or atof(), then move on to the next.
-        if (!isEmpty(p)) mSatellites = atoi(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_HDOP, mHDOP = atof(p));
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) mAltitude = atof(p);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;                   // skip the units
-        if (!isEmpty(p)) mGeoidheight = atof(p);  // skip the rest
-
-    } else if (!strcmp(thisSentence, "RMC")) {  //*****************************RMC
-        // in Adafruit from Actisense NGW-1 from SH CP150C
-        parseTime(p);
-        p = strchr(p, ',') + 1;
-        parseFix(p);
-        p = strchr(p, ',') + 1;
-        // Parse out both mLatitude and direction, then go to next field, or fail
-        if (parseCoord(p, &mLatitudeDegrees, &mLatitude, &mLatitude_fixed, &mLat))
-            NewDataValue(NMEA_LAT, mLatitudeDegrees);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        // Parse out both mLongitude and direction, then go to next field, or fail
-        if (parseCoord(p, &mLongitudeDegrees, &mLongitude, &mLongitude_fixed, &mLon))
-            NewDataValue(NMEA_LON, mLongitudeDegrees);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_SOG, mSpeed = atof(p));
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_COG, mAngle = atof(p));
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) {
-            uint32_t fulldate = atof(p);
-            mDay = fulldate / 10000;
-            mMonth = (fulldate % 10000) / 100;
-            mYear = (fulldate % 100);
-            mLastDate = mSentTime;
-        }  // skip the rest
-
-    } else if (!strcmp(thisSentence, "GLL")) {  //*****************************GLL
-        // in Adafruit from Actisense NGW-1 from SH CP150C
-        // Parse out both mLatitude and direction, then go to next field, or fail
-        if (parseCoord(p, &mLatitudeDegrees, &mLatitude, &mLatitude_fixed, &mLat))
-            NewDataValue(NMEA_LAT, mLatitudeDegrees);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        // Parse out both mLongitude and direction, then go to next field, or fail
-        if (parseCoord(p, &mLongitudeDegrees, &mLongitude, &mLongitude_fixed, &mLon))
-            NewDataValue(NMEA_LON, mLongitudeDegrees);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        parseTime(p);
-        p = strchr(p, ',') + 1;
-        parseFix(p);  // skip the rest
-
-    } else if (!strcmp(thisSentence, "GSA")) {  //*****************************GSA
-        // in Adafruit from Actisense NGW-1
-        p = strchr(p, ',') + 1;  // skip selection mode
-        if (!isEmpty(p)) mFixquality_3d = atoi(p);
-        p = strchr(p, ',') + 1;
-        // skip 12 Satellite PDNs without interpreting them
-        for (int i = 0; i < 12; i++) p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) mPDOP = atof(p);
-        p = strchr(p, ',') + 1;
-        // Parse out mHDOP, we also Parse this from the GGA sentence. Chipset should
-        // report the same for both
-        if (!isEmpty(p)) NewDataValue(NMEA_HDOP, mHDOP = atof(p));
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) mVDOP = atof(p);  // last before checksum
-
-    } else if (!strcmp(thisSentence, "TOP")) {  //*****************************TOP
-        // See:
-        // https://learn.adafruit.com/adafruit-ultimate-gps-featherwing/mAntenna-options
-        // There is an output sentence that will tell you the status of the
-        // mAntenna. $PGTOP,11,x where x is the status number. If x is 3 that means
-        // it is using the external mAntenna. If x is 2 it's using the internal
-        p = strchr(p, ',') + 1;
-        parseAntenna(p);
-    }
-
-#ifdef NMEA_EXTENSIONS                        // Sentences not required for basic GPS functionality
-    else if (!strcmp(thisSentence, "APB")) {  //*******************************APB
-        // from Actisense NGW-1 from SH CP150C
-        return false;
-
-    } else if (!strcmp(thisSentence, "DBT")) {  //*****************************DBT
-        // from Actisense NGW-1
-        // feet, metres, fathoms below transducer coerced to water depth from
-        // surface in metres
-        if (!isEmpty(p)) NewDataValue(NMEA_DEPTH, (nmea_float_t)atof(p) * 0.3048f + mDepthToTransducer);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_DEPTH, (nmea_float_t)atof(p) + mDepthToTransducer);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_DEPTH, (nmea_float_t)atof(p) * 6 * 0.3048f + mDepthToTransducer);
-
-    } else if (!strcmp(thisSentence, "DPT")) {  //*****************************DPT
-        // from Actisense NGW-1
-        return false;
-
-    } else if (!strcmp(thisSentence, "GSV")) {  //*****************************GSV
-        // from Actisense NGW-1
-        return false;
-
-    } else if (!strcmp(thisSentence, "HDG")) {  //*****************************HDG
-        // from Actisense NGW-1 from SH CP150C
-        return false;
-
-    } else if (!strcmp(thisSentence, "HDM")) {             //*****************************HDM
-        if (!isEmpty(p)) NewDataValue(NMEA_HDG, atof(p));  // skip the rest
-
-    } else if (!strcmp(thisSentence, "HDT")) {             //*****************************HDT
-        if (!isEmpty(p)) NewDataValue(NMEA_HDT, atof(p));  // skip the rest
-
-    } else if (!strcmp(thisSentence, "MDA")) {  //*****************************MDA
-        // from Actisense NGW-1
-        if (!isEmpty(p)) NewDataValue(NMEA_BAROMETER, atof(p) * 3386.39);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_BAROMETER, atof(p) * 100000);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        nmea_float_t T = 100000.;
-        char u = 'C';
-        if (!isEmpty(p)) T = atof(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) u = *p;
-        p = strchr(p, ',') + 1;
-        if (u != 'C') {
-            T = (T - 32) / 1.8f;
-            u = 'C';
-        }  // coerce to C
-        if (T < 1000) NewDataValue(NMEA_TEMPERATURE_AIR, T);
-        T = 100000.;
-        u = 'C';
-        if (!isEmpty(p)) T = atof(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) u = *p;
-        p = strchr(p, ',') + 1;
-        if (u != 'C') {
-            T = (T - 32) / 1.8f;
-            u = 'C';
-        }
-        if (T < 1000) NewDataValue(NMEA_TEMPERATURE_WATER, T);
-        if (!isEmpty(p)) NewDataValue(NMEA_HUMIDITY, atof(p));  // skip the rest
-
-    } else if (!strcmp(thisSentence, "MTW")) {  //*****************************MTW
-        nmea_float_t T = 100000.;
-        char u = 'C';
-        if (!isEmpty(p)) T = atof(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) u = *p;  // last before checksum
-        if (u != 'C') {
-            T = (T - 32) / 1.8f;
-            u = 'C';
-        }
-        if (T < 1000) NewDataValue(NMEA_TEMPERATURE_WATER, T);
+bool Adafruit_GPS::Parse(char *nmea, const nmea_stamp_t *stamp) { return Parse(nmea, strlen(nmea), stamp); }
 
-    } else if (!strcmp(thisSentence, "MWD")) {  //*****************************MWD
-        // from Actisense NGW-1
-        return false;
-
-    } else if (!strcmp(thisSentence, "MWV")) {  //*****************************MWV
-        // from Actisense NGW-1
-        nmea_float_t ang = 100000.;
-        char ref = 'T';
-        if (!isEmpty(p)) ang = atof(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) ref = *p;
-        p = strchr(p, ',') + 1;
-        nmea_float_t spd = 100000.;
-        if (!isEmpty(p)) spd = atof(p);
-        p = strchr(p, ',') + 1;
-        char units = 'N';
-        if (!isEmpty(p)) units = *p;
-        p = strchr(p, ',') + 1;
-        char stat = 'A';
-        if (!isEmpty(p)) stat = *p;  // last before checksum
-        if (units == 'K') {
-            spd /= 1.6f;
-            units = 'M';
-        }
-        if (units == 'M') {
-            spd *= 5280.0f / 6000.0f;
-            units = 'N';
-        }
-        if (ang > 180.0f) ang -= 360.0f;
-        if (ref == 'R') {
-            if (ang < 1000.0f && stat == 'A') NewDataValue(NMEA_AWA, ang);
-            if (spd < 1000.0f && stat == 'A') NewDataValue(NMEA_AWS, spd);
-        } else {
-            if (ang < 1000.0f && stat == 'A') NewDataValue(NMEA_TWA, ang);
-            if (spd < 1000.0f && stat == 'A') NewDataValue(NMEA_TWS, spd);
-        }
-
-    } else if (!strcmp(thisSentence, "RMB")) {  //*****************************RMB
-        // from Actisense NGW-1 from SH CP150C
-        // RMB Recommended Minimum Navigation Information
-        //       1 2   3 4    5    6       7 8        9 10  11 12  13 14
-        //       | |   | |    |    |       | |        | |   |   |   | |
-        //$--RMB,A,x.x,a,c--c,c--c,llll.ll,a,yyyyy.yy,a,x.x,x.x,x.x,A*hh
-        // 1) Status, V = Navigation receiver warning
-        // 2) Cross Track error - nautical miles
-        // 3) Direction to Steer, Left or Right
-        // 4) TO Waypoint ID
-        // 5) FROM Waypoint ID
-        // 6) Destination Waypoint Latitude 7) N or S
-        // 8) Destination Waypoint Longitude 9) E or W
-        // 10) Range to destination in nautical miles
-        // 11) Bearing to destination in degrees True
-        // 12) Destination closing velocity in knots
-        // 13) Arrival Status, A = Arrival Circle Entered 14) Checksum
-        p = strchr(p, ',') + 1;  // skip status
-        nmea_float_t xte = 100000.;
-        char xteDir = 'X';
-        if (!isEmpty(p)) xte = atof(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) xteDir = *p;
-        p = strchr(p, ',') + 1;
-        if (xte < 10000.0f && xteDir != 'X') {
-            if (xteDir == 'L') xte *= -1.0f;
-            NewDataValue(NMEA_XTE, xte);
-        }
-        if (!isEmpty(p)) parseStr(mToID, p, NMEA_MAX_WP_ID);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) parseStr(mFromID, p, NMEA_MAX_WP_ID);
-        p = strchr(p, ',') + 1;
-        nmea_float_t latitudeWP = 0;
-        nmea_float_t longitudeWP = 0;
-        int32_t latitude_fixedWP = 0;
-        int32_t longitude_fixedWP = 0;
-        nmea_float_t latitudeDegreesWP = 0;
-        nmea_float_t longitudeDegreesWP = 0;
-        char latWP = 'X';
-        char lonWP = 'X';
-
-        // Parse out both mLatitude and direction for WayPoint, then go to next
-        // field, or fail
-        if (!isEmpty(p)) {
-            if (!parseCoord(p, &latitudeDegreesWP, &latitudeWP, &latitude_fixedWP, &latWP))
-                return false;
-            else
-                NewDataValue(NMEA_LATWP, latitudeDegreesWP);
-        }
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        // Parse out both mLongitude and direction for WayPoint, then go to next
-        // field, or fail
-        if (!isEmpty(p)) {
-            if (!parseCoord(p, &longitudeDegreesWP, &longitudeWP, &longitude_fixedWP, &lonWP))
-                return false;
-            else
-                NewDataValue(NMEA_LONWP, longitudeDegreesWP);
-        }
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_DISTWP, atof(p));
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_COGWP, atof(p));
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_VMGWP, atof(p));  // skip arrival flag
-
-    } else if (!strcmp(thisSentence, "ROT")) {  //*****************************ROT
-        return false;
-
-    } else if (!strcmp(thisSentence, "RPM")) {  //*****************************RPM
-        return false;
-
-    } else if (!strcmp(thisSentence, "RSA")) {  //*****************************RSA
-        // from Actisense NGW-1
-        return false;
-
-    } else if (!strcmp(thisSentence, "TXT")) {  //*****************************TXT
-        if (!isEmpty(p)) mTxtTot = atoi(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) mTxtNumber = atoi(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) mTxtID = atoi(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) parseStr(mTxtTXT, p, 61);  // copy the text to NMEA TXT max of 61 characters
-
-    } else if (!strcmp(thisSentence, "VDR")) {  //*****************************VDR
-        // from Actisense NGW-1
-        return false;
-
-    } else if (!strcmp(thisSentence, "VHW")) {  //*****************************VHW
-        // from Actisense NGW-1
-        if (!isEmpty(p)) NewDataValue(NMEA_HDT, atof(p));
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_HDG, atof(p));
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_VTW, atof(p));  // skip the other units
-
-    } else if (!strcmp(thisSentence, "VLW")) {  //*****************************VLW
-        // from Actisense NGW-1
-        if (!isEmpty(p)) NewDataValue(NMEA_LOG, atof(p));
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) NewDataValue(NMEA_LOGR, atof(p));  // skip the other units
-
-    } else if (!strcmp(thisSentence, "VPW")) {  //*****************************VPW
-        // knots, metres/s coerced to knots
-        nmea_float_t vmg = 100000.;
-        if (!isEmpty(p)) vmg = atof(p);
-        p = strchr(p, ',') + 1;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) vmg = atof(p) * 0.3048 * 3600. / 6000.;  // skip units
-        if (vmg < 1000.0f) NewDataValue(NMEA_VMG, vmg);
-    } else if (!strcmp(thisSentence, "VTG")) {  //*****************************VTG
-        // from Actisense NGW-1 from SH CP150C
-        return false;
+/*!
+    @brief Parse an NMEA string whose length is already known, as the Poll() callback and TryPopSentence() give
+   it, which saves Check() a pass to find the end
+    @param nmea Pointer to the NMEA string, terminated at len
+    @param len Number of characters in it
+    @param stamp Optional, when the sentence was read, see Parse(char *, const nmea_stamp_t *)
+    @return True if successfully parsed, false if fails Check or parsing
+*/
 
-    } else if (!strcmp(thisSentence, "VWR")) {  //*****************************VWR
-        // from Actisense NGW-1
-        nmea_float_t ang = 1000.;
-        if (!isEmpty(p)) ang = atof(p);
-        p = strchr(p, ',') + 1;
-        char ref = ' ';
-        if (!isEmpty(p)) ref = *p;
-        p = strchr(p, ',') + 1;
-        if (ref == 'L') ang *= -1;
-        if (ang < 1000.0f) NewDataValue(NMEA_AWA, ang);
-        nmea_float_t ws = 0.0;
-        char units = 'X';
-        if (!isEmpty(p)) ws = atof(p);
-        p = strchr(p, ',') + 1;  // knots
-        if (!isEmpty(p)) units = *p;
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) ws = atof(p);
-        p = strchr(p, ',') + 1;  // meters / second
-        if (!isEmpty(p)) units = *p;
-        p = strchr(p, ',') + 1;  // M
-        if (!isEmpty(p)) ws = atof(p);
-        p = strchr(p, ',') + 1;       // kilometers / mHour can be converted back to knots
-        if (!isEmpty(p)) units = *p;  // last before checksum
-        if (units == 'M') {
-            ws *= 3.6f;
-            units = 'K';
-        }  // convert m/s to km/h
-        if (units == 'K') {
-            ws /= 1.6f;
-            units = 'M';
-        }  // convert km/h to miles / h
-        if (units == 'M') {
-            ws *= 5280.0f / 6000.0f;
-            units = 'N';
-        }                                              // convert miles / hr to knots
-        if (units == 'N') NewDataValue(NMEA_AWS, ws);  // store the final result
-
-    } else if (!strcmp(thisSentence, "WCV")) {  //*****************************WCV
-        // from SH CP150C
-        if (!isEmpty(p)) NewDataValue(NMEA_VMGWP, atof(p));  // skip the rest
-
-    } else if (!strcmp(thisSentence, "XTE")) {  //*****************************XTE
-        // from Actisense NGW-1 from SH CP150C
-        p = strchr(p, ',') + 1;  // skip status 1
-        p = strchr(p, ',') + 1;  // skip status 2
-        nmea_float_t xte = 100000.;
-        char xteDir = 'X';
-        if (!isEmpty(p)) xte = atof(p);
-        p = strchr(p, ',') + 1;
-        if (!isEmpty(p)) xteDir = *p;
-        p = strchr(p, ',') + 1;
-        if (xte < 10000.0f && xteDir != 'X') {
-            if (xteDir == 'L') xte *= -1.0f;
-            NewDataValue(NMEA_XTE, xte);
-        }  // skip units
-
-    } else if (!strcmp(thisSentence, "ZDA")) {  //*****************************ZDA
-        // from Actisense NGW-1
+bool Adafruit_GPS::Parse(char *nmea, size_t len, const nmea_stamp_t *stamp) {
+    if (stamp) mParseStamp = *stamp;
+    if (!Check(nmea, len)) {
+        mParseStamp = nmea_stamp_t{};
         return false;
     }
-#endif  // NMEA_EXTENSIONS
-
-    else {
-        // printf("PARSE_ERROR: Didn't find the required sentence definition \n");
-        return false;  // didn't find the required sentence definition
-    }
+    // passed the Check, so there's a valid source in thisSource, a valid parseable sentence in thisSentence and
+    // mSentenceEntry points at its row of the dispatch table, and Check() has already split the fields after the
+    // sentence ID into mFields
+    // one time stamp for every value of the sentence, rather than a millis() per NewDataValue()
+    const uint32_t now = millis();
+    mDataMs = now;
+    const bool parsed = (this->*mSentenceEntry->handler)(mFields);
+    mDataMs = 0;
+    if (parsed) UpdateEpoch(mSentenceEntry->id);
+    mParseStamp = nmea_stamp_t{};  // a string not handed out by the driver has no stamp
+    if (!parsed) return false;
 
     // Record the successful parsing of where the last data came from and when
     strcpy(lastSource, thisSource);
     strcpy(lastSentence, thisSentence);
-    mLastUpdate = millis();
+    mLastUpdate = now;
     return true;
 }
 
@@ -477,79 +180,187 @@ bool Adafruit_GPS::Parse(char *nmea) {
     @return True if well formed, false if it has problems
 */
 
-bool Adafruit_GPS::Check(char *nmea) {
+bool Adafruit_GPS::Check(char *nmea) { return Check(nmea, strlen(nmea)); }
+
+/*!
+    @brief Check an NMEA string whose length is already known, see Check(char *)
+    @param nmea Pointer to the NMEA string, terminated at len
+    @param len Number of characters in it, nothing past them is read
+    @return True if well formed, false if it has problems
+*/
+
+bool Adafruit_GPS::Check(char *nmea, size_t len) {
     thisCheck = 0;  // new Check
     *thisSentence = *thisSource = 0;
+    mSentenceEntry = NULL;
     if (*nmea != '$' && *nmea != '!') {
         // printf("PARSE_ERROR: (*nmea != '$' && *nmea != '!') failed\n");
         return false;  // doesn't start with $ or !
     } else
         thisCheck += NMEA_HAS_DOLLAR;
-    // do checksum Check -- first look if we even have one -- ignore all but last
-    // *
-    char *ast = nmea;                         // not strchr(nmea,'*'); for first *
-    while (*ast) ast++;                       // go to the end
-    while (*ast != '*' && ast > nmea) ast--;  // then back to * if it's there
-    if (*ast != '*') {
+    // do checksum Check -- one pass over the sentence finds the last * and the XOR up to it, and splits the fields
+    // for Parse() on the way
+    nmea_scan_t scan;
+    mFields.Scan(nmea, len, &scan);
+    const char *ast = scan.star;
+    if (ast == NULL) {
         // printf("PARSE_ERROR: (*ast != '*') failed\n");
         return false;  // there is no asterisk
     } else {
         uint16_t sum = ParseHex(*(ast + 1)) * 16;  // extract checksum
-        sum += ParseHex(*(ast + 2));
-        char *p = nmea;  // Check checksum
-        for (char *p1 = p + 1; p1 < ast; p1++) sum ^= *p1;
+        if (*(ast + 1)) sum += ParseHex(*(ast + 2));
+        sum ^= scan.sum;
         if (sum != 0) {
             // printf("PARSE_ERROR: Bad Checksum\n");
             return false;  // bad checksum :(
         } else
             thisCheck += NMEA_HAS_CHECKSUM;
     }
-    // extract source of variable length
+    // extract source of variable length, the two letter talkers first so that PG wins over P
     char *p = nmea + 1;
-    const char *src = tokenOnList(p, AdafruitGpsConstants::sources);
-    if (src) {
-        strcpy(thisSource, src);
+    size_t srcLen = 0;
+    if (p[0]) {
+        const uint16_t src = NmeaSourceId(p);
+        for (size_t i = 0; i < sizeof(kNmeaSources) / sizeof(kNmeaSources[0]); i++)
+            if (kNmeaSources[i] == src) srcLen = 2;
+        if (srcLen == 0 && p[0] == 'P') srcLen = 1;
+    }
+    if (srcLen) {
+        memcpy(thisSource, p, srcLen);
+        thisSource[srcLen] = 0;
         thisCheck += NMEA_HAS_SOURCE;
     } else {
         // printf("PARSE_ERROR: src check failed\n");
         return false;
     }
-    p += strlen(src);
-    // extract sentence id and Check if parsed
-    const char *snc = tokenOnList(p, AdafruitGpsConstants::sentences_parsed);
-    if (snc) {
-        strcpy(thisSentence, snc);
+    p += srcLen;
+    // extract sentence id and look it up in the dispatch table
+    const nmea_sentence_t *entry = FindSentence(NmeaSentenceId(p));
+    if (entry && entry->handler) {
+        memcpy(thisSentence, p, 3);
+        thisSentence[3] = 0;
         thisCheck += NMEA_HAS_SENTENCE_P + NMEA_HAS_SENTENCE;
-    } else {  // Check if known
-        snc = tokenOnList(p, AdafruitGpsConstants::sentences_known);
-        if (snc) {
-            strcpy(thisSentence, snc);
-            thisCheck += NMEA_HAS_SENTENCE;
-            return false;  // known but not parsed
-        } else {
-            parseStr(thisSentence, p, NMEA_MAX_SENTENCE_ID);
-            // printf("PARSE_ERROR:  snc check failed\n");
-            return false;  // unknown
-        }
+        mSentenceEntry = entry;
+    } else if (entry) {  // known but not parsed
+        memcpy(thisSentence, p, 3);
+        thisSentence[3] = 0;
+        thisCheck += NMEA_HAS_SENTENCE;
+        return false;
+    } else {
+        parseStr(thisSentence, p, NMEA_MAX_SENTENCE_ID);
+        // printf("PARSE_ERROR:  snc check failed\n");
+        return false;  // unknown
     }
     return true;  // passed all the tests
 }
 
 /*!
-    @brief Check if a token at the start of a string is on a list.
-    @param token Pointer to the string
-    @param list A list of strings, with the final entry starting "ZZ"
-    @return Pointer to the found token, or NULL if it fails
+    @brief Look a packed sentence ID up in the perfect hash over sentenceTable.
+    @param id Sentence ID from NmeaSentenceId()
+    @return Pointer to the table row, or NULL if the sentence is not known
 */
 
-const char *Adafruit_GPS::tokenOnList(char *token, const char **list) {
-    int i = 0;                                       // index in the list
-    while (strncmp(list[i], "ZZ", 2) && i < 1000) {  // stop at terminator and don't crash without it
-        // test for a match on the sentence name
-        if (!strncmp((const char *)list[i], (const char *)token, strlen(list[i]))) return list[i];
-        i++;
+const nmea_sentence_t *Adafruit_GPS::FindSentence(uint32_t id) {
+    static_assert(sentenceHash.mult != 0, "no collision free multiplier for sentenceTable, grow NMEA_SENTENCE_HASH_BITS");
+    const uint8_t slot = sentenceHash.slot[NmeaSentenceSlot(id, sentenceHash.mult)];
+    if (slot == 0 || sentenceTable[slot - 1].id != id) return NULL;
+    return &sentenceTable[slot - 1];
+}
+
+/*!
+    @brief Gather a successfully parsed sentence into the epoch being assembled. A sentence with a time stamp that
+   differs from the epoch's closes it, publishing it unless that already happened, and starts the next one from a
+   copy of it so fields that are not reported every cycle carry over. An epoch is also published as soon as every
+   sentence in mEpochExpect has arrived, which saves waiting a whole cycle for the next time stamp.
+    @param id Packed sentence ID of the sentence just parsed
+*/
+
+void Adafruit_GPS::UpdateEpoch(uint32_t id) {
+    uint8_t bit;
+    switch (id) {
+        case NmeaSentenceId("GGA"):
+            bit = GPS_EPOCH_GGA;
+            break;
+        case NmeaSentenceId("RMC"):
+            bit = GPS_EPOCH_RMC;
+            break;
+        case NmeaSentenceId("GLL"):
+            bit = GPS_EPOCH_GLL;
+            break;
+        case NmeaSentenceId("GSA"):
+            bit = GPS_EPOCH_GSA;
+            break;
+        default:
+            return;
+    }
+    if (bit != GPS_EPOCH_GSA) {  // GSA has no time stamp, it belongs to the epoch already open
+        const uint32_t t = MillisecondsOfDay();
+        if (mEpoch.sentences && t != mEpoch.timeMs) {
+            // only an epoch with a time stamp of its own is worth publishing
+            if (!mEpochPublished && (mEpoch.sentences & (GPS_EPOCH_GGA | GPS_EPOCH_RMC | GPS_EPOCH_GLL)))
+                PublishEpoch();
+            mEpoch.sentences = 0;
+            mEpochPublished = false;
+        }
+        if (!mEpoch.sentences) mEpoch.receivedUs = mParseStamp.firstUs;  // the first sentence of the epoch
+        mEpoch.timeMs = t;
+        mEpoch.latitude = mLatitude_fixed;
+        mEpoch.longitude = mLongitude_fixed;
+        mEpoch.fix = mFix;
+    }
+    switch (bit) {
+        case GPS_EPOCH_GGA:
+            mEpoch.fixQuality = mFixquality;
+            mEpoch.satellites = mSatellites;
+#ifdef NMEA_FIXED_POINT
+            mEpoch.altitudeMm = mAltitude_mm;
+            mEpoch.geoidMm = mGeoidheight_mm;
+            mEpoch.hdopX100 = mHDOP_x100;
+#else
+            mEpoch.altitudeMm = (int32_t)lround(mAltitude * 1000.0);
+            mEpoch.geoidMm = (int32_t)lround(mGeoidheight * 1000.0);
+            mEpoch.hdopX100 = (uint16_t)lround(mHDOP * 100.0);
+#endif
+            break;
+        case GPS_EPOCH_RMC:
+            mEpoch.date = mDay * 10000UL + mMonth * 100UL + mYear;
+#ifdef NMEA_FIXED_POINT
+            mEpoch.speedMms = mSpeed_mms;
+            mEpoch.courseCdeg = mAngle_cdeg;
+#else
+            mEpoch.speedMms = (uint32_t)lround(mSpeed * 1852000.0 / 3600.0);
+            mEpoch.courseCdeg = (uint16_t)lround(mAngle * 100.0);
+#endif
+            break;
+        case GPS_EPOCH_GSA:
+            mEpoch.fix3d = mFixquality_3d;
+#ifdef NMEA_FIXED_POINT
+            mEpoch.pdopX100 = mPDOP_x100;
+            mEpoch.hdopX100 = mHDOP_x100;
+            mEpoch.vdopX100 = mVDOP_x100;
+#else
+            mEpoch.pdopX100 = (uint16_t)lround(mPDOP * 100.0);
+            mEpoch.hdopX100 = (uint16_t)lround(mHDOP * 100.0);
+            mEpoch.vdopX100 = (uint16_t)lround(mVDOP * 100.0);
+#endif
+            break;
     }
-    return NULL;  // couldn't find a match
+    mEpoch.sentences |= bit;
+    if (!mEpochPublished && (mEpoch.sentences & mEpochExpect) == mEpochExpect) PublishEpoch();
+}
+
+/*!
+    @brief Hand the epoch being assembled to readers, and the time its first
+    byte was read to the clock estimator
+*/
+
+void Adafruit_GPS::PublishEpoch(void) {
+    mEpoch.sequence++;
+    mFixes.Write(mEpoch);
+    if (mEpoch.fix && mEpoch.receivedUs) mClock.Add(mEpoch.timeMs, mEpoch.receivedUs);  // the time is good with a fix
+    mEpochPublished = true;
+    TrackFix();
+    AdaptOutput();
 }
 
 /*!
@@ -571,6 +382,499 @@ bool Adafruit_GPS::OnList(char *nmea, const char **list) {
     return false;  // couldn't find a match
 }
 
+/*!
+    @brief Parse the fields of a GGA sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseGGA(const NmeaFields &f) {
+    // Adafruit from Actisense NGW-1 from SH CP150C
+    //       0         1       2 3        4 5 6  7   8   9 10  11
+    //$--GGA,hhmmss.ss,ddmm.mm,a,dddmm.mm,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx*hh
+    parseTime(f[0]);  // Parse time with specialized function
+#ifdef NMEA_FIXED_POINT
+    parseCoordFixed(f[1], f[2], &mLatitude_fixed, &mLat);
+    parseCoordFixed(f[3], f[4], &mLongitude_fixed, &mLon);
+#else
+    // Parse out both mLatitude and direction, then go to next field, or fail
+    if (parseCoord(f[1], f[2], &mLatitudeDegrees, &mLatitude, &mLatitude_fixed, &mLat))
+        NewDataValue(NMEA_LAT, mLatitudeDegrees);
+    // Parse out both mLongitude and direction, then go to next field, or fail
+    if (parseCoord(f[3], f[4], &mLongitudeDegrees, &mLongitude, &mLongitude_fixed, &mLon))
+        NewDataValue(NMEA_LON, mLongitudeDegrees);
+#endif
+    if (!isEmpty(f[5])) {                    // if it's a , (or a * at end of sentence) the value is
+                                             // not included
+        mFixquality = NmeaParseLong(f[5]);  // needs additional processing
+        if (mFixquality > 0) {
+            mFix = true;
+            mLastFix = mSentTime;
+        } else
+            mFix = false;
+    }
+    // Most can just be parsed straight from the field
+    if (!isEmpty(f[6])) mSatellites = NmeaParseLong(f[6]);
+#ifdef NMEA_FIXED_POINT
+    if (!isEmpty(f[7])) mHDOP_x100 = NmeaParseFixed(f[7], 2);
+    if (!isEmpty(f[8])) mAltitude_mm = NmeaParseFixed(f[8], 3);
+    if (!isEmpty(f[10])) mGeoidheight_mm = NmeaParseFixed(f[10], 3);  // skip the units and the rest
+#else
+    if (!isEmpty(f[7])) NewDataValue(NMEA_HDOP, mHDOP = NmeaParseDouble(f[7]));
+    if (!isEmpty(f[8])) mAltitude = NmeaParseDouble(f[8]);
+    if (!isEmpty(f[10])) mGeoidheight = NmeaParseDouble(f[10]);  // skip the units and the rest
+#endif
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a RMC sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseRMC(const NmeaFields &f) {
+    // in Adafruit from Actisense NGW-1 from SH CP150C
+    //       0         1 2       3 4        5 6   7   8      9   10
+    //$--RMC,hhmmss.ss,A,llll.ll,a,yyyyy.yy,a,x.x,x.x,xxxxxx,x.x,a*hh
+    parseTime(f[0]);
+    parseFix(f[1]);
+#ifdef NMEA_FIXED_POINT
+    parseCoordFixed(f[2], f[3], &mLatitude_fixed, &mLat);
+    parseCoordFixed(f[4], f[5], &mLongitude_fixed, &mLon);
+    // knots to mm/s is 1852000 / 3600 = 463 / 900, from thousandths of a knot
+    if (!isEmpty(f[6])) mSpeed_mms = (NmeaParseFixed(f[6], 3) * 463 + 450) / 900;
+    if (!isEmpty(f[7])) mAngle_cdeg = NmeaParseFixed(f[7], 2);
+#else
+    // Parse out both mLatitude and direction, then go to next field, or fail
+    if (parseCoord(f[2], f[3], &mLatitudeDegrees, &mLatitude, &mLatitude_fixed, &mLat))
+        NewDataValue(NMEA_LAT, mLatitudeDegrees);
+    // Parse out both mLongitude and direction, then go to next field, or fail
+    if (parseCoord(f[4], f[5], &mLongitudeDegrees, &mLongitude, &mLongitude_fixed, &mLon))
+        NewDataValue(NMEA_LON, mLongitudeDegrees);
+    if (!isEmpty(f[6])) NewDataValue(NMEA_SOG, mSpeed = NmeaParseDouble(f[6]));
+    if (!isEmpty(f[7])) NewDataValue(NMEA_COG, mAngle = NmeaParseDouble(f[7]));
+#endif
+    if (!isEmpty(f[8])) {
+        uint32_t fulldate = NmeaParseLong(f[8]);
+        mDay = fulldate / 10000;
+        mMonth = (fulldate % 10000) / 100;
+        mYear = (fulldate % 100);
+        mLastDate = mSentTime;
+    }  // skip the rest
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a GLL sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseGLL(const NmeaFields &f) {
+    // in Adafruit from Actisense NGW-1 from SH CP150C
+    //       0       1 2        3 4         5
+    //$--GLL,llll.ll,a,yyyyy.yy,a,hhmmss.ss,A*hh
+#ifdef NMEA_FIXED_POINT
+    parseCoordFixed(f[0], f[1], &mLatitude_fixed, &mLat);
+    parseCoordFixed(f[2], f[3], &mLongitude_fixed, &mLon);
+#else
+    // Parse out both mLatitude and direction, then go to next field, or fail
+    if (parseCoord(f[0], f[1], &mLatitudeDegrees, &mLatitude, &mLatitude_fixed, &mLat))
+        NewDataValue(NMEA_LAT, mLatitudeDegrees);
+    // Parse out both mLongitude and direction, then go to next field, or fail
+    if (parseCoord(f[2], f[3], &mLongitudeDegrees, &mLongitude, &mLongitude_fixed, &mLon))
+        NewDataValue(NMEA_LON, mLongitudeDegrees);
+#endif
+    parseTime(f[4]);
+    parseFix(f[5]);  // skip the rest
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a GSA sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseGSA(const NmeaFields &f) {
+    // in Adafruit from Actisense NGW-1
+    //       0 1 2                       13 14  15  16
+    //$--GSA,a,a,x,x,x,x,x,x,x,x,x,x,x,x,x.x,x.x,x.x*hh
+    // skip selection mode
+    if (!isEmpty(f[1])) mFixquality_3d = NmeaParseLong(f[1]);
+    // skip 12 Satellite PDNs without interpreting them
+#ifdef NMEA_FIXED_POINT
+    if (!isEmpty(f[14])) mPDOP_x100 = NmeaParseFixed(f[14], 2);
+    if (!isEmpty(f[15])) mHDOP_x100 = NmeaParseFixed(f[15], 2);
+    if (!isEmpty(f[16])) mVDOP_x100 = NmeaParseFixed(f[16], 2);  // last before checksum
+#else
+    if (!isEmpty(f[14])) mPDOP = NmeaParseDouble(f[14]);
+    // Parse out mHDOP, we also Parse this from the GGA sentence. Chipset should
+    // report the same for both
+    if (!isEmpty(f[15])) NewDataValue(NMEA_HDOP, mHDOP = NmeaParseDouble(f[15]));
+    if (!isEmpty(f[16])) mVDOP = NmeaParseDouble(f[16]);  // last before checksum
+#endif
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a GSV sentence into the satellite table. The satellites of a group only become
+   visible through Satellites() once its last sentence has arrived.
+    @param f The fields following the sentence ID
+    @return True if successfully parsed, false if the sentence is out of sequence or from an unknown talker
+*/
+
+bool Adafruit_GPS::parseGSV(const NmeaFields &f) {
+    // from the PA1010D, NMEA 4.1 receivers append a signal ID after the last satellite
+    //       0 1 2  3  4  5   6  7  ...         19
+    //$--GSV,x,x,xx,xx,xx,xxx,xx,...4 satellites,h*hh
+    if (isEmpty(f[0]) || isEmpty(f[1])) return false;
+    if (!mSatTable.Begin(thisSource, NmeaParseLong(f[0]), NmeaParseLong(f[1]), NmeaParseLong(f[2]))) return false;
+    for (uint8_t i = 3; i + 3 < f.Count(); i += 4) {
+        if (isEmpty(f[i])) continue;
+        mSatTable.Add(NmeaParseLong(f[i]), isEmpty(f[i + 1]) ? NMEA_SAT_NO_ELEVATION : NmeaParseLong(f[i + 1]),
+                      isEmpty(f[i + 2]) ? NMEA_SAT_NO_AZIMUTH : NmeaParseLong(f[i + 2]), NmeaParseLong(f[i + 3]));
+    }
+    mSatTable.End(MillisecondsOfDay());
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a TOP sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseTOP(const NmeaFields &f) {
+    // See:
+    // https://learn.adafruit.com/adafruit-ultimate-gps-featherwing/mAntenna-options
+    // There is an output sentence that will tell you the status of the
+    // mAntenna. $PGTOP,11,x where x is the status number. If x is 3 that means
+    // it is using the external mAntenna. If x is 2 it's using the internal
+    parseAntenna(f[1]);
+    return true;
+}
+
+#ifdef NMEA_EXTENSIONS
+/*!
+    @brief Parse the fields of a DBT sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseDBT(const NmeaFields &f) {
+    // from Actisense NGW-1
+    // feet, metres, fathoms below transducer coerced to water depth from
+    // surface in metres
+    if (!isEmpty(f[0])) NewDataValue(NMEA_DEPTH, (nmea_float_t)NmeaParseDouble(f[0]) * 0.3048f + mDepthToTransducer);
+    if (!isEmpty(f[2])) NewDataValue(NMEA_DEPTH, (nmea_float_t)NmeaParseDouble(f[2]) + mDepthToTransducer);
+    if (!isEmpty(f[4]))
+        NewDataValue(NMEA_DEPTH, (nmea_float_t)NmeaParseDouble(f[4]) * 6 * 0.3048f + mDepthToTransducer);
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a HDM sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseHDM(const NmeaFields &f) {
+    if (!isEmpty(f[0])) NewDataValue(NMEA_HDG, NmeaParseDouble(f[0]));  // skip the rest
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a HDT sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseHDT(const NmeaFields &f) {
+    if (!isEmpty(f[0])) NewDataValue(NMEA_HDT, NmeaParseDouble(f[0]));  // skip the rest
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a MDA sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseMDA(const NmeaFields &f) {
+    // from Actisense NGW-1
+    if (!isEmpty(f[0])) NewDataValue(NMEA_BAROMETER, NmeaParseDouble(f[0]) * 3386.39);
+    if (!isEmpty(f[2])) NewDataValue(NMEA_BAROMETER, NmeaParseDouble(f[2]) * 100000);
+    nmea_float_t T = 100000.;
+    char u = 'C';
+    if (!isEmpty(f[4])) T = NmeaParseDouble(f[4]);
+    if (!isEmpty(f[5])) u = NmeaFirstChar(f[5]);
+    if (u != 'C') {
+        T = (T - 32) / 1.8f;
+        u = 'C';
+    }  // coerce to C
+    if (T < 1000) NewDataValue(NMEA_TEMPERATURE_AIR, T);
+    T = 100000.;
+    u = 'C';
+    if (!isEmpty(f[6])) T = NmeaParseDouble(f[6]);
+    if (!isEmpty(f[7])) u = NmeaFirstChar(f[7]);
+    if (u != 'C') {
+        T = (T - 32) / 1.8f;
+        u = 'C';
+    }
+    if (T < 1000) NewDataValue(NMEA_TEMPERATURE_WATER, T);
+    if (!isEmpty(f[8])) NewDataValue(NMEA_HUMIDITY, NmeaParseDouble(f[8]));  // skip the rest
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a MTW sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseMTW(const NmeaFields &f) {
+    nmea_float_t T = 100000.;
+    char u = 'C';
+    if (!isEmpty(f[0])) T = NmeaParseDouble(f[0]);
+    if (!isEmpty(f[1])) u = NmeaFirstChar(f[1]);  // last before checksum
+    if (u != 'C') {
+        T = (T - 32) / 1.8f;
+        u = 'C';
+    }
+    if (T < 1000) NewDataValue(NMEA_TEMPERATURE_WATER, T);
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a MWV sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseMWV(const NmeaFields &f) {
+    // from Actisense NGW-1
+    nmea_float_t ang = 100000.;
+    char ref = 'T';
+    if (!isEmpty(f[0])) ang = NmeaParseDouble(f[0]);
+    if (!isEmpty(f[1])) ref = NmeaFirstChar(f[1]);
+    nmea_float_t spd = 100000.;
+    if (!isEmpty(f[2])) spd = NmeaParseDouble(f[2]);
+    char units = 'N';
+    if (!isEmpty(f[3])) units = NmeaFirstChar(f[3]);
+    char stat = 'A';
+    if (!isEmpty(f[4])) stat = NmeaFirstChar(f[4]);  // last before checksum
+    if (units == 'K') {
+        spd /= 1.6f;
+        units = 'M';
+    }
+    if (units == 'M') {
+        spd *= 5280.0f / 6000.0f;
+        units = 'N';
+    }
+    if (ang > 180.0f) ang -= 360.0f;
+    if (ref == 'R') {
+        if (ang < 1000.0f && stat == 'A') NewDataValue(NMEA_AWA, ang);
+        if (spd < 1000.0f && stat == 'A') NewDataValue(NMEA_AWS, spd);
+    } else {
+        if (ang < 1000.0f && stat == 'A') NewDataValue(NMEA_TWA, ang);
+        if (spd < 1000.0f && stat == 'A') NewDataValue(NMEA_TWS, spd);
+    }
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a RMB sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseRMB(const NmeaFields &f) {
+    // from Actisense NGW-1 from SH CP150C
+    // RMB Recommended Minimum Navigation Information
+    //       0 1   2 3    4    5       6 7        8 9   10  11  12
+    //       | |   | |    |    |       | |        | |   |   |   |
+    //$--RMB,A,x.x,a,c--c,c--c,llll.ll,a,yyyyy.yy,a,x.x,x.x,x.x,A*hh
+    // 0) Status, V = Navigation receiver warning
+    // 1) Cross Track error - nautical miles
+    // 2) Direction to Steer, Left or Right
+    // 3) TO Waypoint ID
+    // 4) FROM Waypoint ID
+    // 5) Destination Waypoint Latitude 6) N or S
+    // 7) Destination Waypoint Longitude 8) E or W
+    // 9) Range to destination in nautical miles
+    // 10) Bearing to destination in degrees True
+    // 11) Destination closing velocity in knots
+    // 12) Arrival Status, A = Arrival Circle Entered
+    nmea_float_t xte = 100000.;  // skip status
+    char xteDir = 'X';
+    if (!isEmpty(f[1])) xte = NmeaParseDouble(f[1]);
+    if (!isEmpty(f[2])) xteDir = NmeaFirstChar(f[2]);
+    if (xte < 10000.0f && xteDir != 'X') {
+        if (xteDir == 'L') xte *= -1.0f;
+        NewDataValue(NMEA_XTE, xte);
+    }
+    if (!isEmpty(f[3])) parseStr(mToID, f[3], NMEA_MAX_WP_ID);
+    if (!isEmpty(f[4])) parseStr(mFromID, f[4], NMEA_MAX_WP_ID);
+    nmea_float_t latitudeWP = 0;
+    nmea_float_t longitudeWP = 0;
+    int32_t latitude_fixedWP = 0;
+    int32_t longitude_fixedWP = 0;
+    nmea_float_t latitudeDegreesWP = 0;
+    nmea_float_t longitudeDegreesWP = 0;
+    char latWP = 'X';
+    char lonWP = 'X';
+
+    // Parse out both mLatitude and direction for WayPoint, then go to next
+    // field, or fail
+    if (!isEmpty(f[5])) {
+        if (!parseCoord(f[5], f[6], &latitudeDegreesWP, &latitudeWP, &latitude_fixedWP, &latWP))
+            return false;
+        else
+            NewDataValue(NMEA_LATWP, latitudeDegreesWP);
+    }
+    // Parse out both mLongitude and direction for WayPoint, then go to next
+    // field, or fail
+    if (!isEmpty(f[7])) {
+        if (!parseCoord(f[7], f[8], &longitudeDegreesWP, &longitudeWP, &longitude_fixedWP, &lonWP))
+            return false;
+        else
+            NewDataValue(NMEA_LONWP, longitudeDegreesWP);
+    }
+    if (!isEmpty(f[9])) NewDataValue(NMEA_DISTWP, NmeaParseDouble(f[9]));
+    if (!isEmpty(f[10])) NewDataValue(NMEA_COGWP, NmeaParseDouble(f[10]));
+    if (!isEmpty(f[11])) NewDataValue(NMEA_VMGWP, NmeaParseDouble(f[11]));  // skip arrival flag
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a TXT sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseTXT(const NmeaFields &f) {
+    if (!isEmpty(f[0])) mTxtTot = NmeaParseLong(f[0]);
+    if (!isEmpty(f[1])) mTxtNumber = NmeaParseLong(f[1]);
+    if (!isEmpty(f[2])) mTxtID = NmeaParseLong(f[2]);
+    if (!isEmpty(f[3])) parseStr(mTxtTXT, f[3], 61);  // copy the text to NMEA TXT max of 61 characters
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a VHW sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseVHW(const NmeaFields &f) {
+    // from Actisense NGW-1
+    if (!isEmpty(f[0])) NewDataValue(NMEA_HDT, NmeaParseDouble(f[0]));
+    if (!isEmpty(f[2])) NewDataValue(NMEA_HDG, NmeaParseDouble(f[2]));
+    if (!isEmpty(f[4])) NewDataValue(NMEA_VTW, NmeaParseDouble(f[4]));  // skip the other units
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a VLW sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseVLW(const NmeaFields &f) {
+    // from Actisense NGW-1
+    if (!isEmpty(f[0])) NewDataValue(NMEA_LOG, NmeaParseDouble(f[0]));
+    if (!isEmpty(f[2])) NewDataValue(NMEA_LOGR, NmeaParseDouble(f[2]));  // skip the other units
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a VPW sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseVPW(const NmeaFields &f) {
+    // knots, metres/s coerced to knots
+    nmea_float_t vmg = 100000.;
+    if (!isEmpty(f[0])) vmg = NmeaParseDouble(f[0]);
+    if (!isEmpty(f[2])) vmg = NmeaParseDouble(f[2]) * 0.3048 * 3600. / 6000.;  // skip units
+    if (vmg < 1000.0f) NewDataValue(NMEA_VMG, vmg);
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a VWR sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseVWR(const NmeaFields &f) {
+    // from Actisense NGW-1
+    nmea_float_t ang = 1000.;
+    if (!isEmpty(f[0])) ang = NmeaParseDouble(f[0]);
+    char ref = ' ';
+    if (!isEmpty(f[1])) ref = NmeaFirstChar(f[1]);
+    if (ref == 'L') ang *= -1;
+    if (ang < 1000.0f) NewDataValue(NMEA_AWA, ang);
+    nmea_float_t ws = 0.0;
+    char units = 'X';
+    if (!isEmpty(f[2])) ws = NmeaParseDouble(f[2]);  // knots
+    if (!isEmpty(f[3])) units = NmeaFirstChar(f[3]);
+    if (!isEmpty(f[4])) ws = NmeaParseDouble(f[4]);  // meters / second
+    if (!isEmpty(f[5])) units = NmeaFirstChar(f[5]);
+    if (!isEmpty(f[6])) ws = NmeaParseDouble(f[6]);  // kilometers / mHour can be converted back to knots
+    if (!isEmpty(f[7])) units = NmeaFirstChar(f[7]);  // last before checksum
+    if (units == 'M') {
+        ws *= 3.6f;
+        units = 'K';
+    }  // convert m/s to km/h
+    if (units == 'K') {
+        ws /= 1.6f;
+        units = 'M';
+    }  // convert km/h to miles / h
+    if (units == 'M') {
+        ws *= 5280.0f / 6000.0f;
+        units = 'N';
+    }                                              // convert miles / hr to knots
+    if (units == 'N') NewDataValue(NMEA_AWS, ws);  // store the final result
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a WCV sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseWCV(const NmeaFields &f) {
+    // from SH CP150C
+    if (!isEmpty(f[0])) NewDataValue(NMEA_VMGWP, NmeaParseDouble(f[0]));  // skip the rest
+    return true;
+}
+
+/*!
+    @brief Parse the fields of a XTE sentence
+    @param f The fields following the sentence ID
+    @return True if successfully parsed
+*/
+
+bool Adafruit_GPS::parseXTE(const NmeaFields &f) {
+    // from Actisense NGW-1 from SH CP150C
+    // skip status 1 and status 2
+    nmea_float_t xte = 100000.;
+    char xteDir = 'X';
+    if (!isEmpty(f[2])) xte = NmeaParseDouble(f[2]);
+    if (!isEmpty(f[3])) xteDir = NmeaFirstChar(f[3]);
+    if (xte < 10000.0f && xteDir != 'X') {
+        if (xteDir == 'L') xte *= -1.0f;
+        NewDataValue(NMEA_XTE, xte);
+    }  // skip units
+    return true;
+}
+#endif  // NMEA_EXTENSIONS
+
 /*!
     @brief Parse a part of an NMEA string for mLat or mLon mAngle and direction. Works for either DDMM.mmmm,N
    (mLatitude) or DDDMM.mmmm,W (mLongitude) format. Insensitive to number of decimal places present. Only fills the
@@ -579,7 +883,8 @@ bool Adafruit_GPS::OnList(char *nmea, const char **list) {
 
     Supersedes private functions parseLat(), parseLon(), parseLatDir(),parseLonDir(), all previously called from
    Parse().
-    @param pStart Pointer to the location of the token in the NMEA string
+    @param value The DDDMM.mmmm field
+    @param hemisphere The N/S/E/W field that follows it
     @param mAngle Pointer to the mAngle to fill with value in degrees/minutes as
       received from the GPS (DDDMM.MMMM), unsigned
     @param angle_fixed Pointer to the mFix point version mLatitude in decimal
@@ -591,26 +896,20 @@ bool Adafruit_GPS::OnList(char *nmea, const char **list) {
     @return true if successful, false if failed or no value
 */
 
-bool Adafruit_GPS::parseCoord(char *pStart, nmea_float_t *angleDegrees, nmea_float_t *mAngle, int32_t *angle_fixed,
-                              char *dir) {
-    char *p = pStart;
-    if (!isEmpty(p)) {
+bool Adafruit_GPS::parseCoord(const nmea_field_t &value, const nmea_field_t &hemisphere, nmea_float_t *angleDegrees,
+                              nmea_float_t *mAngle, int32_t *angle_fixed, char *dir) {
+    if (!isEmpty(value)) {
         // get the number in DDDMM.mmmm format and break into components
-        char degreebuff[10] = {0};  // Ensure string is terminated after strncpy
-        char *e = strchr(p, '.');
-        if (e == NULL || e - p > 6) return false;  // no decimal point in range
-        strncpy(degreebuff, p, e - p);             // get DDDMM
-        long dddmm = atol(degreebuff);
-        long degrees = (dddmm / 100);          // truncate the minutes
-        long minutes = dddmm - degrees * 100;  // remove the degrees
-        p = e;                                 // start from the decimal point
-        nmea_float_t decminutes = atof(e);     // the fraction after the decimal point
-        p = strchr(p, ',') + 1;                // go to the next field
+        nmea_coord_t coord;
+        if (!NmeaParseCoord(value, &coord)) return false;  // no decimal point in range
+        long degrees = (coord.dddmm / 100);          // truncate the minutes
+        long minutes = coord.dddmm - degrees * 100;  // remove the degrees
+        nmea_float_t decminutes = coord.fraction / kNmeaPow10[coord.digits];  // the fraction after the decimal point
 
         // get the NSEW direction as a character
         char nsew = 'X';
-        if (!isEmpty(p))
-            nsew = *p;  // field is not empty
+        if (!isEmpty(hemisphere))
+            nsew = NmeaFirstChar(hemisphere);  // field is not empty
         else
             return false;  // no direction provided
 
@@ -641,6 +940,42 @@ bool Adafruit_GPS::parseCoord(char *pStart, nmea_float_t *angleDegrees, nmea_flo
     return true;
 }
 
+/*!
+    @brief Integer only version of parseCoord() for the NMEA_FIXED_POINT build. The minutes are scaled to
+   1/10000000 of a minute before the single division by 60, so the result is exact to the last digit rather than
+   rounded through a float, and may differ from parseCoord() by one unit.
+    @param value The DDDMM.mmmm field
+    @param hemisphere The N/S/E/W field that follows it
+    @param angle_fixed Pointer to the fixed point angle in decimal degrees * 10000000, signed
+    @param dir Pointer to character to fill the direction N/S/E/W
+    @return true if successful, false if failed or no value
+*/
+
+bool Adafruit_GPS::parseCoordFixed(const nmea_field_t &value, const nmea_field_t &hemisphere, int32_t *angle_fixed,
+                                   char *dir) {
+    nmea_coord_t coord;
+    if (isEmpty(value) || !NmeaParseCoord(value, &coord)) return false;  // no number or no decimal point in range
+    char nsew = NmeaFirstChar(hemisphere);
+    if (nsew != 'N' && nsew != 'S' && nsew != 'E' && nsew != 'W') return false;  // also rejects a missing direction
+
+    // keep 7 digits of the fraction of a minute, padding or truncating as needed
+    uint32_t fraction = coord.fraction;
+    for (uint8_t i = coord.digits; i < 7; i++) fraction *= 10;
+    for (uint8_t i = 7; i < coord.digits; i++) fraction /= 10;
+
+    int32_t degrees = coord.dddmm / 100;
+    int32_t minutes = coord.dddmm - degrees * 100;
+    int32_t fixed = degrees * 10000000 + (minutes * 10000000 + (int32_t)fraction) / 60;
+
+    // reject angles that are out of range
+    if (fixed > ((nsew == 'N' || nsew == 'S') ? 900000000 : 1800000000)) return false;
+    if (nsew == 'S' || nsew == 'W') fixed = -fixed;
+
+    if (angle_fixed != NULL) *angle_fixed = fixed;
+    if (dir != NULL) *dir = nsew;
+    return true;
+}
+
 /*!
     @brief Parse a string token from pointer p to the next comma, asterisk
     or end of string.
@@ -671,25 +1006,36 @@ char *Adafruit_GPS::parseStr(char *buff, char *p, int n) {
     return buff;
 }
 
+/*!
+    @brief Copy a field into a terminated string buffer
+    @param buff Pointer to the buffer to store the string in
+    @param f The field
+    @param n Max permitted size of string including terminating 0
+    @return Pointer to the string buffer
+*/
+
+char *Adafruit_GPS::parseStr(char *buff, const nmea_field_t &f, int n) {
+    int len = min((int)f.len, n - 1);
+    memcpy(buff, f.str, len);
+    buff[len] = 0;
+    return buff;
+}
+
 /*!
     @brief Parse a part of an NMEA string for time. Independent of number
     of decimal places after the '.'
-    @param p Pointer to the location of the token in the NMEA string
+    @param f The hhmmss.sss field
     @return true if successful, false otherwise
 */
 
-bool Adafruit_GPS::parseTime(char *p) {
-    if (!isEmpty(p)) {  // get time
-        uint32_t time = atol(p);
+bool Adafruit_GPS::parseTime(const nmea_field_t &f) {
+    uint32_t time;
+    uint16_t milliseconds;
+    if (NmeaParseTime(f, &time, &milliseconds)) {  // get time
         mHour = time / 10000;
         mMinute = (time % 10000) / 100;
         mSeconds = (time % 100);
-        char *dec = strchr(p, '.');
-        char *comstar = min(strchr(p, ','), strchr(p, '*'));
-        if (dec != NULL && comstar != NULL && dec < comstar)
-            mMilliseconds = atof(dec) * 1000;
-        else
-            mMilliseconds = 0;
+        mMilliseconds = milliseconds;
         mLastTime = mSentTime;
         return true;
     }
@@ -698,16 +1044,16 @@ bool Adafruit_GPS::parseTime(char *p) {
 
 /*!
     @brief Parse a part of an NMEA string for whether there is a mFix
-    @param p Pointer to the location of the token in the NMEA string
+    @param f The A/V status field
     @return True if we parsed it, false if it has invalid data
 */
 
-bool Adafruit_GPS::parseFix(char *p) {
-    if (!isEmpty(p)) {
-        if (p[0] == 'A') {
+bool Adafruit_GPS::parseFix(const nmea_field_t &f) {
+    if (!isEmpty(f)) {
+        if (f.str[0] == 'A') {
             mFix = true;
             mLastFix = mSentTime;
-        } else if (p[0] == 'V')
+        } else if (f.str[0] == 'V')
             mFix = false;
         else
             return false;
@@ -718,17 +1064,17 @@ bool Adafruit_GPS::parseFix(char *p) {
 
 /*!
     @brief Parse a part of an NMEA string for mAntenna that is used
-    @param p Pointer to the location of the token in the NMEA string
+    @param f The antenna status field
     @return 3=external 2=internal 1=there was an mAntenna short or problem
 */
 
-bool Adafruit_GPS::parseAntenna(char *p) {
-    if (!isEmpty(p)) {
-        if (p[0] == '3') {
+bool Adafruit_GPS::parseAntenna(const nmea_field_t &f) {
+    if (!isEmpty(f)) {
+        if (f.str[0] == '3') {
             mAntenna = 3;
-        } else if (p[0] == '2') {
+        } else if (f.str[0] == '2') {
             mAntenna = 2;
-        } else if (p[0] == '1') {
+        } else if (f.str[0] == '1') {
             mAntenna = 1;
         } else
             return false;
@@ -738,19 +1084,12 @@ bool Adafruit_GPS::parseAntenna(char *p) {
 }
 
 /*!
-    @brief Is the field empty, or should we try conversion? Won't work
-    for a text field that starts with an asterisk or a comma, but that
-    probably violates the NMEA-183 standard.
-    @param pStart Pointer to the location of the token in the NMEA string
+    @brief Is the field empty, or should we try conversion?
+    @param f The field
     @return true if empty field, false if something there
 */
 
-bool Adafruit_GPS::isEmpty(char *pStart) {
-    if (',' != *pStart && '*' != *pStart && pStart != NULL)
-        return false;
-    else
-        return true;
-}
+bool Adafruit_GPS::isEmpty(const nmea_field_t &f) { return NmeaIsEmpty(f); }
 
 /*!
     @brief Parse a hex character and return the appropriate decimal value
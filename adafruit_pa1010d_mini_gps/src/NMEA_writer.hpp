@@ -0,0 +1,270 @@
+/*!
+  @file NMEA_writer.hpp
+
+  Allocation free formatter for building NMEA sentences, the output side of
+  NMEA_fields.hpp. Fields are written straight into the caller's buffer as
+  integers, fixed point numbers or floats with a fixed number of decimals,
+  without sprintf(), and the checksum is XORed in as each character goes
+  out, so a sentence is finished in the same single pass that wrote it.
+
+  Float() prints what "%.Nf" prints for a float argument, apart from the
+  last digit of values that fall on a rounding tie.
+
+  Given an NmeaSink instead of a buffer, the writer streams the sentence out
+  in NMEA_WRITER_CHUNK byte pieces, e.g. into a UART or USB transmit ring,
+  so re-broadcasting needs no sentence sized buffer at all.
+
+  Adapted by Furhad Jidda for pico
+*/
+
+#ifndef _NMEA_WRITER_H
+#define _NMEA_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ring_buffer.hpp"
+
+#define NMEA_WRITER_MAX_DECIMALS 9  ///< most decimals Fixed() and Float() write
+#ifndef NMEA_WRITER_CHUNK
+#define NMEA_WRITER_CHUNK 16  ///< bytes a writer gathers before handing them to its sink
+#endif
+
+static constexpr uint32_t kNmeaPow10u[] = {1,      10,      100,      1000,      10000,
+                                           100000, 1000000, 10000000, 100000000, 1000000000};
+
+/*!
+    @brief Destination of a streamed sentence, e.g. a transmit buffer
+*/
+class NmeaSink {
+   public:
+    /*!
+        @brief Take the next piece of a sentence
+        @param data Characters, not terminated
+        @param len Number of characters
+        @return false if the characters could not all be taken, which fails the sentence
+    */
+    virtual bool Write(const char *data, size_t len) = 0;
+};
+
+/*!
+    @brief Sink that queues sentences in a RingBuffer, for an interrupt handler or the other core to send
+*/
+template <size_t N>
+class NmeaRingSink : public NmeaSink {
+   public:
+    /// @param ring Transmit ring to fill
+    explicit NmeaRingSink(RingBuffer<char, N> &ring) : mRing(ring) {}
+    bool Write(const char *data, size_t len) override { return mRing.Write(data, len) == len; }
+
+   private:
+    RingBuffer<char, N> &mRing;
+};
+
+/*!
+    @brief Sink that writes to a stdio stream, which is the USB or UART console on the Pico
+*/
+class NmeaStdioSink : public NmeaSink {
+   public:
+    /// @param stream Stream to write to
+    explicit NmeaStdioSink(FILE *stream = stdout) : mStream(stream) {}
+    bool Write(const char *data, size_t len) override { return fwrite(data, 1, len, mStream) == len; }
+
+   private:
+    FILE *mStream;
+};
+
+/*!
+    @brief Writes one sentence into a fixed buffer or a sink, checksumming as it goes.
+
+    Every call appends; once the buffer is full, or the sink refuses a piece, further characters are dropped and
+    Finish() reports the failure, so the fields can be chained without checking each one.
+*/
+class NmeaWriter {
+   public:
+    /*!
+        @param buf Buffer to write into
+        @param size Size of buf, including the terminating 0
+    */
+    NmeaWriter(char *buf, size_t size) : mBuf(buf), mSize(size) {}
+
+    /*!
+        @param sink Where the sentence is streamed to, NMEA_WRITER_CHUNK bytes at a time
+    */
+    explicit NmeaWriter(NmeaSink &sink) : mBuf(mChunk), mSize(sizeof(mChunk) + 1), mSink(&sink) {}
+
+    /*!
+        @brief Start a sentence, "$" and the IDs, which are followed by the first comma
+        @param source Two character talker, e.g. "GP", may be longer or empty for proprietary sentences
+        @param sentence Sentence ID, e.g. "GGA"
+        @return This writer
+    */
+    NmeaWriter &Begin(const char *source, const char *sentence) {
+        mLen = 0;
+        mSent = 0;
+        mSum = 0;
+        mOverflow = false;
+        put('$');
+        mSum = 0;  // the checksum covers everything between the $ and the *
+        return Str(source).Str(sentence).Comma();
+    }
+
+    /// @brief Add a field separator @return This writer
+    NmeaWriter &Comma() { return Char(','); }
+
+    /*!
+        @brief Add a single character field, like a hemisphere or status
+        @param c The character, 0 leaves the field empty
+        @return This writer
+    */
+    NmeaWriter &Char(char c) {
+        if (c) put(c);
+        return *this;
+    }
+
+    /*!
+        @brief Add a string
+        @param s 0 terminated string, may be NULL
+        @return This writer
+    */
+    NmeaWriter &Str(const char *s) {
+        if (s)
+            while (*s) put(*s++);
+        return *this;
+    }
+
+    /*!
+        @brief Add an unsigned integer, as "%0Nu" does
+        @param v The value
+        @param minDigits Zero pad to at least this many digits
+        @return This writer
+    */
+    NmeaWriter &Uint(uint32_t v, uint8_t minDigits = 1) {
+        char digits[10];
+        uint8_t n = 0;
+        do {
+            digits[n++] = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        for (; minDigits > n; minDigits--) put('0');
+        while (n) put(digits[--n]);
+        return *this;
+    }
+
+    /*!
+        @brief Add an unsigned integer in upper case hex, as "%0NX" does
+        @param v The value
+        @param digits Number of digits, the value is truncated to fit, up to 8
+        @return This writer
+    */
+    NmeaWriter &Hex(uint32_t v, uint8_t digits = 8) {
+        static const char kHex[] = "0123456789ABCDEF";
+        while (digits) put(kHex[(v >> (4 * --digits)) & 0xF]);
+        return *this;
+    }
+
+    /*!
+        @brief Add a fixed point number
+        @param v The value times 10^decimals
+        @param decimals Digits after the decimal point, up to NMEA_WRITER_MAX_DECIMALS
+        @param width Zero pad to this many characters including sign and point, as "%0W.Df" does
+        @return This writer
+    */
+    NmeaWriter &Fixed(int32_t v, uint8_t decimals, uint8_t width = 0) {
+        const bool negative = v < 0;
+        const uint32_t a = negative ? 0U - (uint32_t)v : (uint32_t)v;
+        return number(negative, a / kNmeaPow10u[decimals], a % kNmeaPow10u[decimals], decimals, width);
+    }
+
+    /*!
+        @brief Add a floating point number rounded to a fixed number of decimals, NaN or infinity leave the field
+        empty
+        @param v The value
+        @param decimals Digits after the decimal point, up to NMEA_WRITER_MAX_DECIMALS
+        @param width Zero pad to this many characters including sign and point, as "%0W.Df" does
+        @return This writer
+    */
+    NmeaWriter &Float(float v, uint8_t decimals, uint8_t width = 0) {
+        const bool negative = v < 0;
+        const float a = negative ? -v : v;
+        if (!(a < 4.0e9f)) return *this;  // also false for NaN
+        uint32_t whole = (uint32_t)a;
+        // a - whole is exact, so only the scaling rounds
+        uint32_t fraction = (uint32_t)((a - whole) * (float)kNmeaPow10u[decimals] + 0.5f);
+        if (fraction >= kNmeaPow10u[decimals]) {  // rounded up into the next whole number
+            fraction -= kNmeaPow10u[decimals];
+            whole++;
+        }
+        return number(negative, whole, fraction, decimals, width);
+    }
+
+    /*!
+        @brief Finish the sentence with "*hh", the optional CR LF and a terminating 0, or hand the rest to the sink
+        @param crlf Add the CR LF NMEA-183 asks for
+        @return Length of the sentence without the 0, or 0 if it did not fit or the sink refused it
+    */
+    size_t Finish(bool crlf = true) {
+        static const char kHex[] = "0123456789ABCDEF";
+        const uint8_t sum = mSum;
+        put('*');
+        put(kHex[sum >> 4]);
+        put(kHex[sum & 0xF]);
+        if (crlf) {
+            put('\r');
+            put('\n');
+        }
+        if (mSink) flush();
+        if (mOverflow) return 0;
+        if (!mSink) mBuf[mLen] = 0;
+        return mSent + mLen;
+    }
+
+    /// @return Checksum of what was written after the $ so far
+    uint8_t Checksum() const { return mSum; }
+
+   private:
+    void put(char c) {
+        if (mLen + 1 >= mSize && !flush()) {  // always keep room for the 0
+            mOverflow = true;
+            return;
+        }
+        mBuf[mLen++] = c;
+        mSum ^= (uint8_t)c;
+    }
+
+    /// hand the gathered chunk to the sink, false without a sink or if it refused
+    bool flush() {
+        if (!mSink || mOverflow) return false;
+        if (mLen && !mSink->Write(mBuf, mLen)) {
+            mOverflow = true;
+            return false;
+        }
+        mSent += mLen;
+        mLen = 0;
+        return true;
+    }
+
+    NmeaWriter &number(bool negative, uint32_t whole, uint32_t fraction, uint8_t decimals, uint8_t width) {
+        const uint8_t tail = decimals ? decimals + 1 : 0;
+        const uint8_t head = negative + tail;
+        if (negative) put('-');
+        Uint(whole, width > head ? width - head : 1);
+        if (decimals) {
+            put('.');
+            Uint(fraction, decimals);
+        }
+        return *this;
+    }
+
+    char *mBuf;                      ///< caller's buffer, or mChunk with a sink
+    size_t mSize;                    ///< size of mBuf
+    size_t mLen = 0;                 ///< characters in mBuf
+    size_t mSent = 0;                ///< characters already handed to the sink
+    NmeaSink *mSink = NULL;          ///< where full chunks go, NULL to write into the caller's buffer
+    char mChunk[NMEA_WRITER_CHUNK];  ///< gathers characters for the sink
+    uint8_t mSum = 0;                ///< XOR of the characters after the $
+    bool mOverflow = false;          ///< a character did not fit or the sink refused a chunk
+};
+
+#endif  // _NMEA_WRITER_H
@@ -0,0 +1,224 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLOCK_ESTIMATOR_HPP_
+#define CLOCK_ESTIMATOR_HPP_
+
+#include <stdint.h>
+
+#ifndef GPS_CLOCK_WINDOW
+#define GPS_CLOCK_WINDOW 8  ///< epochs whose earliest arrival makes one point of the fit
+#endif
+#ifndef GPS_CLOCK_POINTS
+#define GPS_CLOCK_POINTS 16  ///< points the offset and drift are fitted over, the oldest is replaced
+#endif
+#ifndef GPS_CLOCK_RESET_US
+#define GPS_CLOCK_RESET_US 1000000  ///< an epoch this far off the fit means a time jump, the fit starts over
+#endif
+
+#define GPS_DAY_US 86400000000LL  ///< microseconds in a UTC day
+#define GPS_CLOCK_MAX_PPB 1000000  ///< largest drift the fit reports, 1000 ppm, keeps every product inside 64 bits
+
+/// the fitted relation between UTC and the local clock, see ClockEstimator::Estimate()
+typedef struct {
+    int64_t offsetUs;    ///< local time_us_64() minus UTC at the newest point, first byte latency included
+    int32_t driftPpb;    ///< how much faster the local clock runs than UTC, parts per billion
+    uint32_t jitterUs;   ///< largest distance of a point from the fitted line
+    uint32_t latencyUs;  ///< mean arrival after the fitted line over the last window
+    uint32_t samples;    ///< epochs added since the fit last started over
+    uint16_t points;     ///< points in the fit, drift is known from 2
+    uint16_t resets;     ///< times a time jump made the fit start over
+} gps_clock_t;
+
+/*!
+    @brief Fits the local clock, time_us_64(), against the UTC time stamps of the receiver's epochs.
+
+    Each epoch is added with the local time the first byte of its first sentence was read. That byte leaves the
+    module some time after the UTC second it reports, and waits for the next I2C read, so every sample is the
+    true offset plus a latency that is never negative and varies from epoch to epoch. The earliest sample of
+    every GPS_CLOCK_WINDOW epochs is the one with the least latency; a least squares line through the last
+    GPS_CLOCK_POINTS of those gives the offset and the drift of the local crystal. It is all integer arithmetic,
+    the M0+ has no FPU: points relative to the newest one, UTC in milliseconds, drift in parts per billion.
+
+    What remains in the offset is the module's own output delay, the same for every epoch, which only a PPS pin
+    could show. Subtract it when it is known; between two sensors stamped with the same local clock it does not
+    matter.
+*/
+class ClockEstimator {
+   public:
+    /*!
+        @brief Add an epoch
+        @param utcMs UTC time of day of the epoch in milliseconds
+        @param localUs time_us_64() when its first byte was read
+        @return True if the fit was updated, at the end of each window
+    */
+    bool Add(uint32_t utcMs, uint64_t localUs) {
+        const int64_t utcUs = unwrap(utcMs);
+        const int64_t d = (int64_t)localUs - utcUs;
+        if (mStats.samples && valid()) {
+            const int64_t off = d - predict(utcUs);
+            if (off > GPS_CLOCK_RESET_US || off < -GPS_CLOCK_RESET_US) {
+                const uint16_t resets = mStats.resets + 1;
+                Reset();
+                mStats.resets = resets;
+                return Add(utcMs, localUs);
+            }
+            mLatencySum += off;
+        }
+        mLastUtcMs = utcMs;
+        mStats.samples++;
+        if (mWindow == 0 || d < mWindowMin) {
+            mWindowMin = d;
+            mWindowUtc = utcUs;
+        }
+        if (++mWindow < GPS_CLOCK_WINDOW) {
+            if (mPoints == 0) fit();  // a first estimate before the first window is complete
+            return false;
+        }
+        mUtc[mHead] = mWindowUtc;
+        mD[mHead] = mWindowMin;
+        mHead = (mHead + 1) % GPS_CLOCK_POINTS;
+        if (mPoints < GPS_CLOCK_POINTS) mPoints++;
+        mStats.latencyUs = mLatencySum > 0 ? (uint32_t)(mLatencySum / mWindow) : 0;
+        mWindow = 0;
+        mLatencySum = 0;
+        fit();
+        return true;
+    }
+
+    /*!
+        @brief Local time of a UTC time of day, within half a day of the last epoch
+        @param utcMs UTC time of day in milliseconds, e.g. gps_fix_t::timeMs
+        @param localUs Filled with the time_us_64() of it
+        @return False until the first epoch was added
+    */
+    bool ToLocal(uint32_t utcMs, uint64_t *localUs) const {
+        if (!valid()) return false;
+        int64_t utcUs = (int64_t)utcMs * 1000 + mDayUs;
+        if (utcMs + GPS_DAY_US / 2000 < mLastUtcMs) utcUs += GPS_DAY_US;
+        if (utcMs > mLastUtcMs + GPS_DAY_US / 2000) utcUs -= GPS_DAY_US;
+        *localUs = (uint64_t)(utcUs + predict(utcUs));
+        return true;
+    }
+
+    /*!
+        @brief UTC time of a local time, e.g. of an IMU sample
+        @param localUs time_us_64() of it
+        @param utcUs Filled with the UTC time of day in microseconds
+        @return False until the first epoch was added
+    */
+    bool ToUtc(uint64_t localUs, uint64_t *utcUs) const {
+        if (!valid()) return false;
+        // local = utc + offset + drift * (utc - ref), solved for utc as rel / (1 + drift), which is
+        // rel - rel * drift / (1 + drift) without an overflow
+        const int64_t rel = (int64_t)localUs - mRefUtc - mRefD;
+        int64_t utc = (mRefUtc + rel - divRound(rel * mDriftPpb, 1000000000 + mDriftPpb)) % GPS_DAY_US;
+        *utcUs = (uint64_t)(utc < 0 ? utc + GPS_DAY_US : utc);
+        return true;
+    }
+
+    /// @return The fit, its offset and drift are valid once samples is not 0
+    const gps_clock_t &Estimate() const { return mStats; }
+
+    /// Forget every epoch, e.g. after the local clock was set
+    void Reset() { *this = ClockEstimator(); }
+
+   private:
+    bool valid() const { return mStats.samples > 0; }
+
+    /// local minus UTC the fit expects at a UTC time
+    int64_t predict(int64_t utcUs) const { return mRefD + divRound((utcUs - mRefUtc) * mDriftPpb, 1000000000); }
+
+    /// a / d rounded to the nearest, d positive
+    static int64_t divRound(int64_t a, int64_t d) { return (a < 0 ? a - d / 2 : a + d / 2) / d; }
+
+    /// a * 1000000 / d rounded to the nearest, a thousand at a time so that nothing overflows; d positive
+    static int64_t scaleMillion(int64_t a, int64_t d) {
+        const uint64_t u = (uint64_t)(a < 0 ? -a : a);
+        uint64_t q = u / d, r = u % d * 1000;
+        q = q * 1000 + r / d;
+        q = q * 1000 + (r % d * 1000 + (uint64_t)d / 2) / d;
+        return a < 0 ? -(int64_t)q : (int64_t)q;
+    }
+
+    /// UTC time of day into microseconds since the first day, counting midnights
+    int64_t unwrap(uint32_t utcMs) {
+        if (mStats.samples && utcMs + GPS_DAY_US / 2000 < mLastUtcMs) mDayUs += GPS_DAY_US;
+        return (int64_t)utcMs * 1000 + mDayUs;
+    }
+
+    /// least squares line through the points, x in milliseconds and y in microseconds relative to the newest one
+    void fit() {
+        if (mPoints == 0) {
+            mRefUtc = mWindowUtc;
+            mRefD = mWindowMin;
+            mDriftPpb = 0;
+            mStats.offsetUs = mRefD;
+            return;
+        }
+        const uint8_t newest = (mHead + GPS_CLOCK_POINTS - 1) % GPS_CLOCK_POINTS;
+        const int64_t refUtc = mUtc[newest], refD = mD[newest];
+        // the sums are taken around a rough mean of x so that sxx stays small, the slope does not depend on it
+        int64_t sx = 0, sy = 0;
+        for (uint8_t i = 0; i < mPoints; i++) {
+            sx += (mUtc[i] - refUtc) / 1000;
+            sy += mD[i] - refD;
+        }
+        const int64_t n = mPoints, mean = sx / n;
+        int64_t cx = 0, cxx = 0, cxy = 0;
+        for (uint8_t i = 0; i < mPoints; i++) {
+            const int64_t x = (mUtc[i] - refUtc) / 1000 - mean, y = mD[i] - refD;
+            cx += x;
+            cxx += x * x;
+            cxy += x * y;
+        }
+        const int64_t den = n * cxx - cx * cx;
+        int64_t ppb = mPoints > 1 && den > 0 ? scaleMillion(n * cxy - cx * sy, den) : 0;  // microseconds per ms
+        if (ppb > GPS_CLOCK_MAX_PPB) ppb = GPS_CLOCK_MAX_PPB;
+        if (ppb < -GPS_CLOCK_MAX_PPB) ppb = -GPS_CLOCK_MAX_PPB;
+        mRefUtc = refUtc;
+        mRefD = refD + divRound(sy * 1000000 - ppb * sx, n * 1000000);  // the line at the newest point
+        mDriftPpb = ppb;
+        uint32_t jitter = 0;
+        for (uint8_t i = 0; i < mPoints; i++) {
+            const int64_t r = mD[i] - predict(mUtc[i]);
+            const uint32_t abs = (uint32_t)(r < 0 ? -r : r);
+            if (abs > jitter) jitter = abs;
+        }
+        mStats.offsetUs = mRefD;
+        mStats.driftPpb = (int32_t)ppb;
+        mStats.jitterUs = jitter;
+        mStats.points = mPoints;
+    }
+
+    int64_t mUtc[GPS_CLOCK_POINTS] = {};  ///< UTC of each point, microseconds since the first day
+    int64_t mD[GPS_CLOCK_POINTS] = {};    ///< local minus UTC of each point
+    int64_t mRefUtc = 0;                  ///< UTC the fit is relative to, the newest point
+    int64_t mRefD = 0;                    ///< local minus UTC the fit gives at mRefUtc
+    int64_t mDriftPpb = 0;                ///< slope of local minus UTC in parts per billion
+    int64_t mDayUs = 0;                   ///< midnights passed since the first epoch, in microseconds
+    int64_t mWindowMin = 0;               ///< smallest local minus UTC of the window being filled
+    int64_t mWindowUtc = 0;               ///< UTC of that sample
+    int64_t mLatencySum = 0;              ///< arrivals after the fit in the window being filled
+    uint32_t mLastUtcMs = 0;              ///< time of day of the last epoch
+    uint8_t mWindow = 0;                  ///< samples in the window being filled
+    uint8_t mPoints = 0;                  ///< points in mUtc and mD
+    uint8_t mHead = 0;                    ///< next point to replace
+    gps_clock_t mStats = {};              ///< the fit as reported
+};
+
+#endif
@@ -0,0 +1,290 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EPO_LOADER_HPP_
+#define EPO_LOADER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <NMEA_writer.hpp>
+#include <atomic>
+
+#include "pmtk_queue.hpp"
+
+#define EPO_RECORD_BYTES 72                                    ///< one satellite of one segment, 18 words
+#define EPO_SATELLITES 32                                      ///< GPS satellite slots per segment, PRN 1 to 32
+#define EPO_SEGMENT_BYTES (EPO_RECORD_BYTES * EPO_SATELLITES)  ///< one segment of an EPO file
+#define EPO_SEGMENT_HOURS 6                                    ///< each segment predicts the orbits for 6 hours
+#define EPO_SENTENCE_SIZE 180  ///< "$PMTK721,<prn>" and 18 words of 8 hex digits, checksum, CR LF and a 0
+
+static_assert(EPO_SENTENCE_SIZE <= 0xFF, "a $PMTK721 sentence must fit one SendCommand()");
+
+/*!
+    @brief Days since 1970-01-01 of a civil date, Howard Hinnant's days_from_civil
+    @param year Four digit year
+    @param month 1 to 12
+    @param day 1 to 31
+    @return The day number, negative before 1970
+*/
+static inline int32_t CivilDays(uint16_t year, uint8_t month, uint8_t day) {
+    const int32_t y = (int32_t)year - (month <= 2);
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = (uint32_t)(y - era * 400);
+    const uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+/*!
+    @brief GPS hours since 1980-01-06 00:00 UTC, the time base of EPO files
+    @param year Four digit year
+    @param month 1 to 12
+    @param day 1 to 31
+    @param hour 0 to 23
+    @return The hour, for EpoLoader::Begin()
+*/
+static inline uint32_t EpoGpsHour(uint16_t year, uint8_t month, uint8_t day, uint8_t hour) {
+    return (uint32_t)(CivilDays(year, month, day) - 3657) * 24 + hour;  // 1980-01-06 is day 3657
+}
+
+/*!
+    @brief Where an EPO file comes from: the flash of the Pico, an SD card, a file on the host
+*/
+class EpoSource {
+   public:
+    /// @return Size of the EPO file in bytes
+    virtual size_t Size() = 0;
+
+    /*!
+        @brief Read part of the file
+        @param offset Byte offset into the file
+        @param buf Filled with len bytes
+        @param len Number of bytes, at most EPO_RECORD_BYTES
+        @return false if the bytes could not be read, which fails the upload
+    */
+    virtual bool Read(uint32_t offset, uint8_t *buf, size_t len) = 0;
+};
+
+/*!
+    @brief EPO file that is already in the address space, e.g. linked into the flash image, which the RP2040 maps
+    through XIP, or a file the host has mapped
+*/
+class EpoMemorySource : public EpoSource {
+   public:
+    /*!
+        @param data First byte of the file
+        @param size Size of the file in bytes
+    */
+    EpoMemorySource(const uint8_t *data, size_t size) : mData(data), mSize(size) {}
+    size_t Size() override { return mSize; }
+    bool Read(uint32_t offset, uint8_t *buf, size_t len) override {
+        if (offset > mSize || len > mSize - offset) return false;
+        memcpy(buf, mData + offset, len);
+        return true;
+    }
+
+   private:
+    const uint8_t *mData;
+    size_t mSize;
+};
+
+/// how an upload went, see EpoLoader
+typedef struct {
+    uint32_t firstHour;  ///< GPS hour the first uploaded segment starts
+    uint32_t endHour;    ///< GPS hour the last uploaded segment ends, the data is no use after it
+    uint16_t slots;      ///< satellite slots in the uploaded segments
+    uint16_t records;    ///< records acknowledged by the module
+    uint16_t skipped;    ///< empty slots, no satellite, not sent
+    uint16_t resends;    ///< records sent again after a late acknowledgement or a failure flag
+    uint32_t bytes;      ///< characters sent, resends included
+} epo_upload_stats_t;
+
+/*!
+    @brief Streams the segments of a MediaTek EPO file to the module as $PMTK721 sentences, one satellite record
+    at a time.
+
+    A record is 18 little endian words, the first one holds the GPS hour the segment starts in its low 24 bits and
+    the PRN in the top 8, which is 0 for a slot without a satellite. Each record goes out as
+    $PMTK721,<prn>,<word 1>,...,<word 18> in hex, and the next one only once $PMTK001,721,3 has acknowledged it,
+    which is the flow control: the module is never handed more than it has stored, and only one record has to be
+    held, whatever the size of the file. A record whose acknowledgement is late, or that the module failed to
+    store, is sent again, and the upload fails after as many retries as PmtkQueue allows.
+
+    The acknowledgement names no record, so records can not be pipelined; PmtkQueue commands can be in flight at
+    the same time, their acknowledgements name another command.
+
+    Begin() from the same core as Poll(), Due() and Acknowledge() are called from Poll() and ReadData().
+*/
+class EpoLoader {
+   public:
+    /*!
+        @param timeoutMs How long to wait for an acknowledgement before sending a record again
+        @param retries How many times to send a record again before giving up
+    */
+    EpoLoader(uint16_t timeoutMs, uint8_t retries) : mTimeoutMs(timeoutMs), mRetries(retries) {}
+
+    /*!
+        @brief Start an upload, dropping any upload still going on
+        @param source The EPO file, must stay valid until the upload completes
+        @param gpsHour Now, see EpoGpsHour(), the upload starts with the segment that covers it. 0 starts with the
+        first segment of the file.
+        @param segments Segments to upload, 0 for all that are left. Four cover a day.
+        @return false if the file holds no whole segment, can not be read, or ended before gpsHour
+    */
+    bool Begin(EpoSource &source, uint32_t gpsHour = 0, uint16_t segments = 0) {
+        mResult.store(PMTK_RESULT_UNKNOWN, std::memory_order_relaxed);
+        const uint32_t count = (uint32_t)(source.Size() / EPO_SEGMENT_BYTES);
+        uint8_t first[4];
+        if (count == 0 || !source.Read(0, first, sizeof(first))) return false;
+        const uint32_t fileHour = first[0] | (uint32_t)first[1] << 8 | (uint32_t)first[2] << 16;
+        const uint32_t start = gpsHour > fileHour ? (gpsHour - fileHour) / EPO_SEGMENT_HOURS : 0;
+        if (start >= count) return false;  // the file is out of date
+        const uint32_t end = segments && start + segments < count ? start + segments : count;
+        mSource = &source;
+        mNext = start * EPO_SATELLITES;
+        mEnd = end * EPO_SATELLITES;
+        mTries = 0;
+        mStats = epo_upload_stats_t{};
+        mStats.firstHour = fileHour + start * EPO_SEGMENT_HOURS;
+        mStats.endHour = fileHour + end * EPO_SEGMENT_HOURS;
+        mStats.slots = (uint16_t)(mEnd - mNext);
+        mResult.store(PMTK_RESULT_QUEUED, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        @brief Find what should go out now: the next record once the last one is acknowledged, or the last one again
+        if its acknowledgement is late. Completes the upload after the last record, or when a record is out of
+        retries.
+        @param nowMs millis()
+        @param len Set to the length of the sentence
+        @return The $PMTK721 sentence to send, not terminated, or NULL if nothing is due
+    */
+    const char *Due(uint32_t nowMs, size_t *len) {
+        if (!Active()) return NULL;
+        if (mTries > 0) {
+            if (!mResend && nowMs - mSentMs < mTimeoutMs) return NULL;  // still waiting
+            if (mTries > mRetries) {
+                finish(PMTK_RESULT_TIMEOUT);
+                return NULL;
+            }
+            mStats.resends++;
+        } else if (!load()) {
+            return NULL;
+        }
+        mTries++;
+        mResend = false;
+        mSentMs = nowMs;
+        mStats.bytes += mLen;
+        mResult.store(PMTK_RESULT_SENT, std::memory_order_relaxed);
+        *len = mLen;
+        return mText;
+    }
+
+    /*!
+        @brief Match a received sentence against the record in flight
+        @param line A complete sentence
+        @return true if it was the acknowledgement of the record in flight
+    */
+    bool Acknowledge(const char *line) {
+        if (mTries == 0 || strncmp(line, "$PMTK001,721,", 13) || line[13] < '0' || line[13] > '3') return false;
+        switch (line[13]) {
+            case '3':
+                mStats.records++;
+                mNext++;
+                mTries = 0;
+                break;
+            case '2':  // valid but not stored, try again straight away
+                mResend = true;
+                break;
+            default:  // the module does not take EPO data this way, no point going on
+                finish((pmtk_result_t)(line[13] - '0'));
+        }
+        return true;
+    }
+
+    /// stop the upload, the module keeps the records it acknowledged
+    void Cancel() {
+        if (Active()) finish(PMTK_RESULT_FAILED);
+    }
+
+    /// @return true from Begin() until the upload completes
+    bool Active() const {
+        const pmtk_result_t r = mResult.load(std::memory_order_acquire);
+        return r == PMTK_RESULT_QUEUED || r == PMTK_RESULT_SENT;
+    }
+    /// @return PMTK_RESULT_QUEUED or PMTK_RESULT_SENT while uploading, then how it completed
+    pmtk_result_t Result() const { return mResult.load(std::memory_order_acquire); }
+    /// @return Counters of the upload so far
+    const epo_upload_stats_t &Stats() const { return mStats; }
+
+    /*!
+        @brief Change how long to wait for an acknowledgement
+        @param timeoutMs How long to wait before sending a record again
+        @param retries How many times to send a record again before giving up
+    */
+    void SetTimeout(uint16_t timeoutMs, uint8_t retries) {
+        mTimeoutMs = timeoutMs;
+        mRetries = retries;
+    }
+
+   private:
+    /// format the next record that holds a satellite into mText, completes the upload if there is none
+    bool load() {
+        uint8_t b[EPO_RECORD_BYTES];
+        for (; mNext < mEnd; mNext++) {
+            if (!mSource->Read(mNext * EPO_RECORD_BYTES, b, sizeof(b))) {
+                finish(PMTK_RESULT_FAILED);
+                return false;
+            }
+            if (b[3] == 0) {
+                mStats.skipped++;
+                continue;
+            }
+            NmeaWriter w(mText, sizeof(mText));
+            w.Begin("PMTK", "721").Hex(b[3], 2);
+            for (uint8_t i = 0; i < EPO_RECORD_BYTES; i += 4)
+                w.Comma().Hex(b[i] | (uint32_t)b[i + 1] << 8 | (uint32_t)b[i + 2] << 16 | (uint32_t)b[i + 3] << 24);
+            mLen = (uint8_t)w.Finish();
+            return true;
+        }
+        finish(PMTK_RESULT_SUCCESS);
+        return false;
+    }
+
+    void finish(pmtk_result_t result) {
+        mTries = 0;
+        mResult.store(result, std::memory_order_release);
+    }
+
+    EpoSource *mSource = nullptr;                             ///< file being uploaded
+    uint32_t mNext = 0;                                       ///< slot in flight or next to look at
+    uint32_t mEnd = 0;                                        ///< slot after the last one to upload
+    uint32_t mSentMs = 0;                                     ///< millis() of the last send
+    epo_upload_stats_t mStats = {};                           ///< counters of the upload so far
+    uint16_t mTimeoutMs;                                      ///< acknowledgement timeout
+    uint8_t mRetries;                                         ///< sends after the first before giving up
+    uint8_t mTries = 0;                                       ///< times the record in flight was sent, 0 for none
+    uint8_t mLen = 0;                                         ///< characters in mText
+    bool mResend = false;                                     ///< the module failed to store the record in flight
+    std::atomic<pmtk_result_t> mResult{PMTK_RESULT_UNKNOWN};  ///< how far the upload has got
+    char mText[EPO_SENTENCE_SIZE];                            ///< record in flight as a $PMTK721 sentence
+};
+
+#endif
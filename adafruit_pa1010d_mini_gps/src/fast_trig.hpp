@@ -0,0 +1,155 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAST_TRIG_HPP_
+#define FAST_TRIG_HPP_
+
+#include <stdint.h>
+
+/*!
+    @brief Table driven sine, cosine and arc tangent in degrees for the compound angles of the NMEA data layer.
+
+    The Cortex-M0+ has no FPU, so every sin(), cos() and atan2() call is a long soft float routine. Here each
+    function is one quadrant or octant reduction done on integers, then a linear interpolation between two
+    entries of a 257 entry Q15 table. The tables are built at compile time and end up in flash.
+
+    Worst case errors, checked over the whole circle by nmea_trig_benchmark:
+    - FastSinCos(): FAST_TRIG_SIN_ERROR, from interpolation (4.7e-6) and Q15 rounding
+    - FastAtan2(): FAST_TRIG_ATAN_ERROR_DEG degrees, from Q15 rounding of a 45 degree octant
+*/
+
+#define FAST_TRIG_SIN_ERROR 6e-5f       ///< largest difference between FastSinCos() and sin() / cos()
+#define FAST_TRIG_ATAN_ERROR_DEG 2e-3f  ///< largest difference in degrees between FastAtan2() and atan2()
+
+#define FAST_TRIG_TABLE_BITS 8                          ///< log2 of the intervals in a table
+#define FAST_TRIG_TABLE_SIZE (1 << FAST_TRIG_TABLE_BITS)  ///< intervals in a table, one more entry than that
+#define FAST_TRIG_Q15 32767                              ///< table value of 1.0
+
+/// Q15 tables, sin over one quadrant and atan over 0 to 1 scaled so that atan(1) = 45 degrees is FAST_TRIG_Q15
+struct FastTrigTables {
+    int16_t sin[FAST_TRIG_TABLE_SIZE + 1];
+    int16_t atan[FAST_TRIG_TABLE_SIZE + 1];
+};
+
+namespace fast_trig {
+constexpr double kPi = 3.14159265358979323846;
+
+/// sin(x) for 0 <= x <= pi/2 by its Taylor series, only used to build the table
+constexpr double Sin(double x) {
+    double term = x, sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+/// square root by Newton's method, only used to build the table
+constexpr double Sqrt(double x) {
+    double r = x > 1 ? x : 1;
+    for (int i = 0; i < 40; i++) r = (r + x / r) / 2;
+    return r;
+}
+
+/// atan(x) for 0 <= x <= 1, halving the angle once so that the series converges fast
+constexpr double Atan(double x) {
+    const double h = x / (1 + Sqrt(1 + x * x));  // tan of half the angle, at most tan(pi/8)
+    double term = h, sum = h;
+    for (int n = 1; n < 24; n++) {
+        term *= -h * h;
+        sum += term / (2 * n + 1);
+    }
+    return 2 * sum;
+}
+
+constexpr FastTrigTables BuildTables() {
+    FastTrigTables t{};
+    for (int i = 0; i <= FAST_TRIG_TABLE_SIZE; i++) {
+        t.sin[i] = (int16_t)(Sin(kPi / 2 * i / FAST_TRIG_TABLE_SIZE) * FAST_TRIG_Q15 + 0.5);
+        t.atan[i] = (int16_t)(Atan((double)i / FAST_TRIG_TABLE_SIZE) / (kPi / 4) * FAST_TRIG_Q15 + 0.5);
+    }
+    return t;
+}
+
+inline constexpr FastTrigTables kTables = BuildTables();
+
+/*!
+    @brief Interpolate a table
+    @param table One of the kTables arrays
+    @param pos Position from 0 to 1 << 24, the top 8 bits pick the interval and the low 16 the fraction
+    @return Q15 value
+*/
+inline int32_t Lookup(const int16_t *table, uint32_t pos) {
+    const uint32_t i = pos >> 16;
+    if (i >= FAST_TRIG_TABLE_SIZE) return table[FAST_TRIG_TABLE_SIZE];
+    const int32_t step = table[i + 1] - table[i];
+    return table[i] + ((step * (int32_t)(pos & 0xFFFF) + 0x8000) >> 16);
+}
+
+/*!
+    @brief Sine of a binary angle
+    @param bam Angle where 1 << 32 is a full turn
+    @return Q15 sine
+*/
+inline int32_t SinBam(uint32_t bam) {
+    const uint32_t pos = (bam >> 6) & 0xFFFFFF;  // position inside the quadrant
+    switch (bam >> 30) {
+        case 0:
+            return Lookup(kTables.sin, pos);
+        case 1:
+            return Lookup(kTables.sin, (1UL << 24) - pos);
+        case 2:
+            return -Lookup(kTables.sin, pos);
+        default:
+            return -Lookup(kTables.sin, (1UL << 24) - pos);
+    }
+}
+}  // namespace fast_trig
+
+/*!
+    @brief Sine and cosine of an angle in degrees
+    @param deg Angle, any value within +/-40000 degrees
+    @param s Set to the sine
+    @param c Set to the cosine
+*/
+inline void FastSinCos(float deg, float *s, float *c) {
+    // 1 << 24 per turn keeps the product exact in a float, shifting up then wraps negative angles for free
+    const uint32_t bam = (uint32_t)(int32_t)(deg * (16777216.0f / 360.0f)) << 8;
+    *s = fast_trig::SinBam(bam) * (1.0f / FAST_TRIG_Q15);
+    *c = fast_trig::SinBam(bam + (1UL << 30)) * (1.0f / FAST_TRIG_Q15);
+}
+
+/*!
+    @brief Angle of a sine and cosine pair, which need not be normalised, as atan2(s, c) does
+    @param s Sine, or any value proportional to it
+    @param c Cosine, scaled the same way
+    @return Angle in -180 to 180 degrees, 0 if both are 0
+*/
+inline float FastAtan2(float s, float c) {
+    const float as = s < 0 ? -s : s;
+    const float ac = c < 0 ? -c : c;
+    if (as == 0 && ac == 0) return 0;
+    // reduce to the first octant, where the ratio is between 0 and 1
+    const bool steep = as > ac;
+    const uint32_t pos = (uint32_t)((steep ? ac / as : as / ac) * 16777216.0f);
+    float deg = fast_trig::Lookup(fast_trig::kTables.atan, pos) * (45.0f / FAST_TRIG_Q15);
+    if (steep) deg = 90.0f - deg;
+    if (c < 0) deg = 180.0f - deg;
+    return s < 0 ? -deg : deg;
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef GPS_FLASH_STORE_HPP_
+#define GPS_FLASH_STORE_HPP_
+
+#include "flash_manager.hpp"
+#include "gps_state.hpp"
+
+#ifndef GPS_STATE_FLASH_SECTOR
+#define GPS_STATE_FLASH_SECTOR 1  ///< FlashManager sector of the warm start state, sector 0 is the BNO055 calibration
+#endif
+
+/*!
+    @brief Keeps the warm start state in its own flash sector through FlashManager, which adds a CRC. Link the
+    application with flash_manager to use it.
+
+    Every Save() erases the sector with interrupts off and the other core locked out through flash_safe_execute(),
+    so call Adafruit_GPS::SaveState() from the main loop, and if core 1 runs, have it call
+    flash_safe_execute_core_init(). Keep GPS_STATE_SAVE_INTERVAL_S long: at the default of 15 minutes a sector rated
+    for 100000 erases lasts nearly three years of continuous running.
+*/
+class GpsFlashStore : public GpsStateStore {
+   public:
+    GpsFlashStore() : mFlash(GPS_STATE_FLASH_SECTOR) {}
+    bool Load(gps_warm_state_t *state) override {
+        return mFlash.read_data(reinterpret_cast<uint8_t *>(state), sizeof(*state));
+    }
+    bool Save(const gps_warm_state_t &state) override {
+        return mFlash.write_data(reinterpret_cast<const uint8_t *>(&state), sizeof(state));
+    }
+
+   private:
+    FlashManager mFlash;
+};
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef GPS_STATE_HPP_
+#define GPS_STATE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GPS_STATE_MAGIC 0x54535047  ///< "GPST" little endian, first word of a saved gps_warm_state_t
+#define GPS_STATE_VERSION 1         ///< bumped whenever gps_warm_state_t changes
+
+/// what is kept across a power cycle so the next start can be aided, see Adafruit_GPS::SetStateStore()
+typedef struct {
+    uint32_t magic;       ///< GPS_STATE_MAGIC
+    uint16_t version;     ///< GPS_STATE_VERSION
+    uint16_t size;        ///< sizeof(gps_warm_state_t)
+    uint32_t utc;         ///< seconds since 1970-01-01 of the last fix
+    int32_t latitude;     ///< degrees * 10000000 of the last fix, negative south
+    int32_t longitude;    ///< degrees * 10000000 of the last fix, negative west
+    int32_t altitudeM;    ///< height in metres of the last fix
+    uint32_t almanacUtc;  ///< seconds since 1970-01-01 the receiver had last tracked long enough for a whole
+                          ///< almanac, 0 if never
+    uint32_t epoEndHour;  ///< GPS hour the last EPO upload runs out, 0 if none, see EpoLoader
+    uint32_t ttffMs;      ///< time to first fix of the run that saved it
+} gps_warm_state_t;
+
+/*!
+    @brief Where the warm start state lives between runs: flash through FlashManager (see gps_flash_store.hpp), an
+    SD card, battery backed RAM. Called from Init() to load, and only from Adafruit_GPS::SaveState() to save, which
+    the application calls where a store that blocks, like a flash erase, does no harm.
+*/
+class GpsStateStore {
+   public:
+    /*!
+        @brief Read the state saved last
+        @param state Filled in, checked by the caller for GPS_STATE_MAGIC, version and size
+        @return false if nothing was saved or it could not be read
+    */
+    virtual bool Load(gps_warm_state_t *state) = 0;
+
+    /*!
+        @brief Keep the state for the next run
+        @param state The state
+        @return false if it could not be saved
+    */
+    virtual bool Save(const gps_warm_state_t &state) = 0;
+};
+
+/// current UTC for aiding at start up, seconds since 1970-01-01, 0 if unknown, e.g. from an RTC or the network
+typedef uint32_t (*gps_utc_cb_t)(void *ctx);
+
+/// how the start went, see Adafruit_GPS::TimeToFirstFix()
+typedef struct {
+    uint32_t ttffMs;        ///< millis() from Init() to the first epoch with a fix, 0 until then
+    uint32_t searchEpochs;  ///< epochs without a fix before it
+    uint32_t stateAgeS;     ///< age of the restored fix at Init(), 0 if no clock told the time
+    uint32_t almanacAgeS;   ///< age of the restored almanac at Init(), 0 if no clock told the time or none
+    bool restored;          ///< Init() found a saved state
+    bool aided;             ///< Init() queued time and position aiding, which takes a clock
+} gps_ttff_t;
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef HISTORY_POOL_HPP_
+#define HISTORY_POOL_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "NMEA_data.hpp"
+
+/*!
+    @brief Fixed number of equally sized history blocks, each a nmea_history_t header and room for Values samples.
+
+    Replaces the two malloc() calls initHistory() made per tracked value, so adding and removing histories in a
+    long running deployment never fragments the heap. The whole pool is sized at compile time and lives wherever
+    its owner does; a free block is found with one scan of a bit mask.
+*/
+template <size_t Blocks, size_t Values>
+class HistoryPool {
+    static_assert(Blocks > 0 && Blocks <= 32, "HistoryPool tracks free blocks in a 32 bit mask");
+    static_assert(Values >= 10, "initHistory() never asks for fewer than 10 values");
+
+   public:
+    /// bytes one block takes, header and samples
+    static constexpr size_t kBlockBytes = sizeof(nmea_history_t) + Values * sizeof(int16_t);
+
+    /*!
+        @brief Take a free block
+        @param n Number of samples wanted, clamped to Values
+        @return Cleared history with data and n set, or NULL if every block is in use
+    */
+    nmea_history_t *Acquire(unsigned n) {
+        for (uint8_t b = 0; b < Blocks; b++) {
+            if (mUsed & (1UL << b)) continue;
+            mUsed |= 1UL << b;
+            uint8_t used = BlocksUsed();
+            if (used > mHighWater) mHighWater = used;
+            nmea_history_t *h = &mHeaders[b];
+            *h = nmea_history_t();
+            h->data = mData[b];
+            h->n = n < Values ? n : Values;
+            for (unsigned i = 0; i < h->n; i++) h->data[i] = 0;
+            return h;
+        }
+        return NULL;
+    }
+
+    /*!
+        @brief Return a block taken with Acquire()
+        @param h The history, ignored if it is not from this pool
+    */
+    void Release(nmea_history_t *h) {
+        if (h < mHeaders || h >= mHeaders + Blocks) return;
+        mUsed &= ~(1UL << (h - mHeaders));
+        h->data = NULL;
+    }
+
+    /// @return Blocks handed out
+    uint8_t BlocksUsed() const { return __builtin_popcountl(mUsed); }
+    /// @return Blocks still free
+    uint8_t BlocksFree() const { return Blocks - BlocksUsed(); }
+    /// @return Most blocks ever in use at once, to size Blocks for a product
+    uint8_t BlocksHighWater() const { return mHighWater; }
+    /// @return Bytes of the blocks handed out
+    size_t BytesUsed() const { return BlocksUsed() * kBlockBytes; }
+    /// @return Bytes of the blocks still free
+    size_t BytesFree() const { return BlocksFree() * kBlockBytes; }
+    /// @return Bytes of the whole pool
+    static constexpr size_t BytesTotal() { return Blocks * kBlockBytes; }
+    /// @return Most samples a single history can hold
+    static constexpr size_t Capacity() { return Values; }
+
+   private:
+    nmea_history_t mHeaders[Blocks];
+    int16_t mData[Blocks][Values];
+    uint32_t mUsed = 0;      ///< bit per block, set while handed out
+    uint8_t mHighWater = 0;  ///< most blocks used at once
+};
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOCUS_READER_HPP_
+#define LOCUS_READER_HPP_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LOCUS_LINE_BYTES 96      ///< data bytes in a full $PMTKLOX,1 line, 24 words of 8 hex digits
+#define LOCUS_SECTOR_BYTES 4096  ///< flash sector, each one starts with a header
+#define LOCUS_HEADER_BYTES 64    ///< sector header with the log settings, not records
+#define LOCUS_RECORD_BYTES 16    ///< one fix in the default content: UTC, VALID, LAT, LON, HGT and a checksum
+
+/// one fix from the LOCUS log
+typedef struct {
+    uint32_t utc;       ///< seconds since 1970-01-01 UTC
+    int32_t latitude;   ///< degrees * 10000000, negative south
+    int32_t longitude;  ///< degrees * 10000000, negative west
+    int16_t heightM;    ///< height in metres
+    uint8_t fix;        ///< 0 none, 1 GPS, 2 DGPS, 6 estimated
+} locus_record_t;
+
+/// how a dump went, see LocusReader
+typedef struct {
+    uint16_t expectedLines;  ///< data lines announced by $PMTKLOX,0
+    uint16_t lines;          ///< data lines that passed the checksum
+    uint16_t badLines;       ///< $PMTKLOX lines dropped for a bad checksum or format
+    uint16_t missingLines;   ///< data lines that never arrived intact, the bad ones included
+    uint32_t records;        ///< records handed to the callback
+    uint32_t badRecords;     ///< records dropped for a bad checksum
+    uint32_t emptyRecords;   ///< erased flash, all 0xFF
+    bool done;               ///< $PMTKLOX,2 seen
+} locus_dump_stats_t;
+
+/// the logger status answering PMTK_LOCUS_QUERY_STATUS, see LOCUS_ReadStatus()
+typedef struct {
+    uint16_t serial;   ///< log serial number
+    uint16_t records;  ///< number of records logged
+    uint8_t type;      ///< LOCUS_OVERLAP or LOCUS_FULLSTOP
+    uint8_t mode;      ///< logging mode, 0x08 interval logger
+    uint8_t config;    ///< contents of a record
+    uint8_t interval;  ///< interval setting
+    uint8_t distance;  ///< distance setting
+    uint8_t speed;     ///< speed setting
+    uint8_t status;    ///< 0: logging, 1: stopped
+    uint8_t percent;   ///< log life used percentage
+} locus_status_t;
+
+/// run for every valid record of a dump
+typedef void (*locus_record_cb_t)(const locus_record_t *record, void *ctx);
+
+/*!
+    @brief Decodes the $PMTKLOX lines a PMTK_LOCUS_DUMP produces, one character at a time.
+
+    The data lines are longer than MAXLINELENGTH, so the reader works on the raw stream rather than on assembled
+    sentences, and holds at most one line of data bytes until its checksum has been checked. Lines are placed by
+    their line number, so a lost line costs only its own six records. The first LOCUS_HEADER_BYTES of every
+    LOCUS_SECTOR_BYTES are the sector header and are skipped. Records are decoded in the default LOCUS content
+    (config 0x0F: UTC, VALID, LAT, LON, HGT), little endian, and dropped unless the XOR of their first 15
+    bytes matches the 16th.
+*/
+class LocusReader {
+   public:
+    /*!
+        @brief Start a new dump
+        @param onRecord Called for every valid record
+        @param ctx Opaque pointer passed through to onRecord
+    */
+    void Begin(locus_record_cb_t onRecord, void *ctx = nullptr) {
+        mOnRecord = onRecord;
+        mCtx = ctx;
+        mStats = locus_dump_stats_t{};
+        mNextLine = 0;
+        mState = LOCUS_IDLE;
+    }
+
+    /*!
+        @brief Feed the next received character
+        @param c The character
+        @return true if c completed a $PMTKLOX line that passed its checksum
+    */
+    bool Put(char c) {
+        if (c == '$') {  // always the start of a sentence, even in the middle of a broken one
+            mState = LOCUS_PREFIX;
+            mMatched = 1;
+            mSum = 0;
+            return false;
+        }
+        switch (mState) {
+            case LOCUS_IDLE:
+                return false;
+            case LOCUS_PREFIX:
+                if (c != kPrefix[mMatched]) {
+                    mState = LOCUS_IDLE;
+                    return false;
+                }
+                mSum ^= (uint8_t)c;
+                if (kPrefix[++mMatched] == 0) {
+                    mState = LOCUS_FIELDS;
+                    mField = 0;
+                    mValue = 0;
+                    mDigits = 0;
+                    mLen = 0;
+                }
+                return false;
+            case LOCUS_FIELDS:
+                if (c == '*') {
+                    mState = endField() ? LOCUS_CHECKSUM : LOCUS_IDLE;
+                    mDigits = 0;
+                    mValue = 0;
+                    return false;
+                }
+                mSum ^= (uint8_t)c;
+                if (c == ',') {
+                    if (!endField()) mState = LOCUS_IDLE;
+                    return false;
+                }
+                if (!addDigit(c)) {
+                    mState = LOCUS_IDLE;
+                    mStats.badLines++;
+                }
+                return false;
+            case LOCUS_CHECKSUM:
+                if (!addDigit(c)) {
+                    mState = LOCUS_IDLE;
+                    mStats.badLines++;
+                    return false;
+                }
+                if (mDigits < 2) return false;
+                mState = LOCUS_IDLE;
+                if (mValue != mSum) {
+                    mStats.badLines++;
+                    return false;
+                }
+                commit();
+                return true;
+        }
+        return false;
+    }
+
+    /// @return true once $PMTKLOX,2 ended the dump
+    bool Done() const { return mStats.done; }
+    /// @return Counters of the dump so far
+    const locus_dump_stats_t &Stats() const { return mStats; }
+
+   private:
+    typedef enum : uint8_t { LOCUS_IDLE, LOCUS_PREFIX, LOCUS_FIELDS, LOCUS_CHECKSUM } locus_state_t;
+
+    static constexpr char kPrefix[] = "$PMTKLOX,";
+
+    /// accumulate a hex digit of the current field, data words go straight into mData
+    bool addDigit(char c) {
+        uint8_t d;
+        if (c >= '0' && c <= '9')
+            d = c - '0';
+        else if (c >= 'A' && c <= 'F')
+            d = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f')
+            d = c - 'a' + 10;
+        else
+            return false;
+        if (mState == LOCUS_FIELDS && mField >= 2) {  // data word, two digits a byte
+            if (mDigits >= 8 || mLen >= LOCUS_LINE_BYTES) return false;
+            if (mDigits++ & 1)
+                mData[mLen++] |= d;
+            else
+                mData[mLen] = d << 4;
+            return true;
+        }
+        if (mState == LOCUS_FIELDS && d > 9) return false;  // type and line number are decimal
+        if (++mDigits > 5) return false;
+        mValue = mState == LOCUS_FIELDS ? mValue * 10 + d : mValue * 16 + d;
+        return true;
+    }
+
+    /// a field ended with ',' or '*', false if the line can not be a valid one
+    bool endField() {
+        bool ok = true;
+        if (mField == 0)
+            mType = mValue;
+        else if (mField == 1)
+            mLineNo = mValue;
+        else
+            ok = mDigits == 8;  // words are whole
+        if (mField == 0 && mType > 2) ok = false;
+        if (!ok) mStats.badLines++;
+        if (mField < 2) mValue = 0;
+        mField++;
+        mDigits = 0;
+        return ok;
+    }
+
+    /// act on a line whose checksum matched
+    void commit() {
+        if (mType == 0) {  // $PMTKLOX,0,<lines>, the dump starts (again)
+            const uint16_t expected = mField > 1 ? mLineNo : 0;
+            Begin(mOnRecord, mCtx);
+            mStats.expectedLines = expected;
+            return;
+        }
+        if (mType == 2) {
+            if (mNextLine < mStats.expectedLines) mStats.missingLines += mStats.expectedLines - mNextLine;
+            mStats.done = true;
+            return;
+        }
+        if (mLineNo < mNextLine) return;  // repeated line
+        mStats.missingLines += mLineNo - mNextLine;
+        mNextLine = mLineNo + 1;
+        mStats.lines++;
+        const uint32_t offset = (uint32_t)mLineNo * LOCUS_LINE_BYTES;  // lines hold whole records
+        for (uint16_t i = 0; i + LOCUS_RECORD_BYTES <= mLen; i += LOCUS_RECORD_BYTES)
+            if ((offset + i) % LOCUS_SECTOR_BYTES >= LOCUS_HEADER_BYTES) record(mData + i);
+    }
+
+    /// decode one 16 byte record
+    void record(const uint8_t *b) {
+        uint8_t sum = 0, ones = 0xFF;
+        for (uint8_t i = 0; i < LOCUS_RECORD_BYTES - 1; i++) {
+            sum ^= b[i];
+            ones &= b[i];
+        }
+        if (ones == 0xFF && b[LOCUS_RECORD_BYTES - 1] == 0xFF) {
+            mStats.emptyRecords++;
+            return;
+        }
+        if (sum != b[LOCUS_RECORD_BYTES - 1]) {
+            mStats.badRecords++;
+            return;
+        }
+        locus_record_t r;
+        float lat, lon;
+        r.utc = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+        r.fix = b[4];
+        memcpy(&lat, b + 5, sizeof(lat));  // IEEE 754 single, little endian like the RP2040
+        memcpy(&lon, b + 9, sizeof(lon));
+        r.heightM = (int16_t)(b[13] | b[14] << 8);
+        r.latitude = (int32_t)lrintf(lat * 1e7f);
+        r.longitude = (int32_t)lrintf(lon * 1e7f);
+        mStats.records++;
+        if (mOnRecord) mOnRecord(&r, mCtx);
+    }
+
+    locus_record_cb_t mOnRecord = nullptr;  ///< where records go
+    void *mCtx = nullptr;                   ///< passed to mOnRecord
+    locus_dump_stats_t mStats = {};         ///< counters of the dump so far
+    uint16_t mNextLine = 0;                 ///< data line expected next
+    uint16_t mLineNo = 0;                   ///< line number of the current line
+    uint32_t mValue = 0;                    ///< decimal or hex field being read
+    uint8_t mData[LOCUS_LINE_BYTES];        ///< data bytes of the current line
+    uint8_t mLen = 0;                       ///< bytes in mData
+    uint8_t mType = 0;                      ///< 0 start, 1 data, 2 end
+    uint8_t mField = 0;                     ///< field of the current line, 0 is the type
+    uint8_t mDigits = 0;                    ///< digits of the current field
+    uint8_t mMatched = 0;                   ///< characters of kPrefix seen
+    uint8_t mSum = 0;                       ///< XOR of the line after the $
+    locus_state_t mState = LOCUS_IDLE;      ///< where in a line the reader is
+};
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_CONTROLLER_HPP_
+#define OUTPUT_CONTROLLER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <NMEA_writer.hpp>
+
+#define GPS_NMEA_GLL 0x01     ///< PMTK314 sentence bit, position
+#define GPS_NMEA_RMC 0x02     ///< PMTK314 sentence bit, position, speed, course and date
+#define GPS_NMEA_VTG 0x04     ///< PMTK314 sentence bit, speed and course
+#define GPS_NMEA_GGA 0x08     ///< PMTK314 sentence bit, position, altitude, fix quality, satellites used and HDOP
+#define GPS_NMEA_GSA 0x10     ///< PMTK314 sentence bit, DOP and the satellites used, one per constellation
+#define GPS_NMEA_GSV 0x20     ///< PMTK314 sentence bit, satellites in view, a group per constellation
+#define GPS_NMEA_SENTENCES 6  ///< sentence bits PMTK314 is built from, in its field order
+
+#ifndef GPS_OUTPUT_WINDOW_MS
+#define GPS_OUTPUT_WINDOW_MS 10000  ///< GPS time the measured bytes per second are counted over, at least
+#endif
+
+#define GPS_WANT_POSITION 0x01    ///< latitude, longitude and time of day
+#define GPS_WANT_VELOCITY 0x02    ///< speed and course over ground
+#define GPS_WANT_DATE 0x04        ///< the date
+#define GPS_WANT_ALTITUDE 0x08    ///< altitude, geoid height, fix quality, satellites used and HDOP
+#define GPS_WANT_DOP 0x10         ///< PDOP, VDOP and 2D/3D fix
+#define GPS_WANT_SATELLITES 0x20  ///< satellites in view with their SNR, see Adafruit_GPS::Satellites()
+
+/// how the update rate follows the motion, see Adafruit_GPS::SetRatePolicy()
+typedef struct {
+    uint16_t stationaryPeriodMs;  ///< update period below movingSpeedMms
+    uint16_t movingPeriodMs;      ///< update period from movingSpeedMms
+    uint16_t fastPeriodMs;        ///< update period from fastSpeedMms
+    uint32_t movingSpeedMms;      ///< speed over ground in mm/s from which the receiver is moving
+    uint32_t fastSpeedMms;        ///< speed over ground in mm/s from which it is moving fast
+    uint32_t budgetBytesPerSec;   ///< most NMEA bytes per second the bus or power budget allows, 0 for no limit
+    uint8_t holdEpochs;           ///< epochs a slower rate must be called for before it is used, faster is at once
+    bool adjustBaud;              ///< also queue PMTK251 for the lowest baud rate that carries the output
+} gps_rate_policy_t;
+
+/// 5 s standing still, 1 Hz from walking pace, 5 Hz from 36 km/h
+static const gps_rate_policy_t kGpsRatePolicyDefault = {5000, 1000, 200, 500, 10000, 0, 5, false};
+
+/// what the output was set to and what it costs on the bus, see Adafruit_GPS::OutputStats()
+typedef struct {
+    uint8_t sentences;      ///< GPS_NMEA_ bits asked for with PMTK314, 0 before Subscribe()
+    uint8_t gsvEvery;       ///< GSV goes out with every so many fixes, to keep it at about 1 Hz
+    uint16_t periodMs;      ///< update period asked for with PMTK220, 1000 until changed
+    uint32_t baud;          ///< baud rate asked for with PMTK251, 0 if left alone
+    uint32_t estimatedBps;  ///< NMEA bytes per second the settings should produce
+    uint32_t measuredBps;   ///< NMEA bytes per second received over the last GPS_OUTPUT_WINDOW_MS or more
+    uint32_t rateChanges;   ///< times the update period was changed
+} gps_output_stats_t;
+
+/*!
+    @brief Works out the smallest PMTK314 sentence mask for what the application uses, the PMTK220 update period
+    for the speed over ground, and the bytes per second both produce.
+
+    The byte counts are those of a PA1010D tracking GPS and GLONASS: GSA comes once per constellation and GSV as a
+    group of about five sentences. Rates and sentences are only worked out here; Adafruit_GPS queues the commands
+    and calls Epoch() for every published epoch.
+*/
+class OutputController {
+   public:
+    /*!
+        @brief Smallest set of sentences that carries the data asked for
+        @param wants GPS_WANT_ bits
+        @return GPS_NMEA_ bits, RMC before GGA for a bare position as it also carries the date
+    */
+    static uint8_t SentencesFor(uint8_t wants) {
+        uint8_t s = 0;
+        if (wants & (GPS_WANT_VELOCITY | GPS_WANT_DATE)) s |= GPS_NMEA_RMC;
+        if (wants & GPS_WANT_ALTITUDE) s |= GPS_NMEA_GGA;
+        if (wants & GPS_WANT_DOP) s |= GPS_NMEA_GSA;
+        if (wants & GPS_WANT_SATELLITES) s |= GPS_NMEA_GSV;
+        if ((wants & GPS_WANT_POSITION) && !(s & (GPS_NMEA_RMC | GPS_NMEA_GGA))) s |= GPS_NMEA_RMC;
+        return s;
+    }
+
+    /// @return Fixes between GSV groups that keep them at about 1 Hz, the module takes 1 to 5
+    static uint8_t GsvEvery(uint16_t periodMs) {
+        const uint16_t every = periodMs >= 1000 ? 1 : (1000 + periodMs - 1) / periodMs;
+        return every > 5 ? 5 : (uint8_t)every;
+    }
+
+    /*!
+        @brief NMEA bytes per second a sentence mask produces
+        @param sentences GPS_NMEA_ bits
+        @param periodMs Update period
+        @param gsvEvery Fixes between GSV groups
+        @return Bytes per second, CR LF included
+    */
+    static uint32_t Estimate(uint8_t sentences, uint16_t periodMs, uint8_t gsvEvery) {
+        uint32_t perFix = 0;
+        for (uint8_t i = 0; i < GPS_NMEA_SENTENCES; i++)
+            if (sentences & (1 << i)) perFix += kBytesPerFix[i] / ((1 << i) == GPS_NMEA_GSV ? gsvEvery : 1);
+        return perFix * 1000 / periodMs;
+    }
+
+    /// @return Lowest baud rate PMTK251 takes that carries bytesPerSec with room to spare, 10 bits a byte
+    static uint32_t BaudFor(uint32_t bytesPerSec) {
+        static const uint32_t kBauds[] = {9600, 14400, 19200, 38400, 57600, 115200};
+        for (uint32_t baud : kBauds)
+            if (baud / 10 >= bytesPerSec * 2) return baud;
+        return 115200;
+    }
+
+    /*!
+        @brief Write the PMTK314 command for a sentence mask
+        @param buf Buffer for the command, without checksum
+        @param size Size of buf
+        @param sentences GPS_NMEA_ bits
+        @param gsvEvery Fixes between GSV groups
+        @return Length of the command, 0 if it did not fit
+    */
+    static size_t Pmtk314(char *buf, size_t size, uint8_t sentences, uint8_t gsvEvery) {
+        NmeaWriter w(buf, size);
+        w.Begin("PMTK", "314");
+        for (uint8_t i = 0; i < GPS_NMEA_SENTENCES; i++)
+            w.Uint(sentences & (1 << i) ? ((1 << i) == GPS_NMEA_GSV ? gsvEvery : 1) : 0).Comma();
+        for (uint8_t i = GPS_NMEA_SENTENCES; i < 18; i++) w.Char('0').Comma();  // reserved, ZDA, MCHN
+        w.Char('0');
+        return w.Finish(false);
+    }
+
+    /*!
+        @brief Follow the rate with this policy
+        @param policy The policy, copied, NULL to leave the rate alone
+    */
+    void SetPolicy(const gps_rate_policy_t *policy) {
+        mAdaptive = policy != nullptr;
+        if (policy) mPolicy = *policy;
+        mHold = 0;
+    }
+    /// @return true while a policy is set
+    bool Adaptive() const { return mAdaptive; }
+    /// @return The policy set last
+    const gps_rate_policy_t &Policy() const { return mPolicy; }
+
+    /*!
+        @brief A sentence arrived, for the measured bytes per second. Called by the producer, Poll() or ReadData(),
+        which may run on the other core than Epoch(), so it only ever adds to a running total.
+        @param len Its length, CR LF included
+    */
+    void Count(size_t len) {
+        // a load and a store rather than fetch_add(), which the Cortex-M0+ has no instruction for
+        mBytesIn.store(mBytesIn.load(std::memory_order_relaxed) + (uint32_t)len, std::memory_order_relaxed);
+    }
+
+    /*!
+        @brief A new epoch was published. Updates the measured bytes per second and picks the update period.
+        @param timeMs GPS time of day of the epoch in milliseconds
+        @param fix The epoch has a fix
+        @param speedMms Its speed over ground in millimetres per second
+        @return The period to change to, 0 to keep the current one
+    */
+    uint16_t Epoch(uint32_t timeMs, bool fix, uint32_t speedMms) {
+        const uint32_t bytesIn = mBytesIn.load(std::memory_order_relaxed);
+        if (!mWindowStarted) {
+            mWindowStarted = true;
+            mWindowMs = timeMs;
+            mWindowBytes = bytesIn;
+        } else {
+            const uint32_t elapsed = (timeMs + 86400000UL - mWindowMs) % 86400000UL;
+            if (elapsed >= GPS_OUTPUT_WINDOW_MS) {
+                mStats.measuredBps = (uint32_t)((uint64_t)(bytesIn - mWindowBytes) * 1000 / elapsed);
+                mWindowMs = timeMs;
+                mWindowBytes = bytesIn;
+            }
+        }
+        if (!mAdaptive || !fix) return 0;  // no speed without a fix, keep what there is
+
+        uint16_t want = speedMms >= mPolicy.fastSpeedMms     ? mPolicy.fastPeriodMs
+                        : speedMms >= mPolicy.movingSpeedMms ? mPolicy.movingPeriodMs
+                                                             : mPolicy.stationaryPeriodMs;
+        want = fitBudget(want);
+        if (want == mStats.periodMs) {
+            mHold = 0;
+            return 0;
+        }
+        if (want > mStats.periodMs) {  // slower, only once it has been called for long enough
+            if (want != mCandidate) mHold = 0;
+            mCandidate = want;
+            if (++mHold < mPolicy.holdEpochs) return 0;
+        }
+        mHold = 0;
+        return want;
+    }
+
+    /*!
+        @brief The commands for new settings were queued
+        @param sentences GPS_NMEA_ bits
+        @param periodMs Update period
+        @param baud Baud rate, 0 if left alone
+    */
+    void Commit(uint8_t sentences, uint16_t periodMs, uint32_t baud) {
+        if (periodMs != mStats.periodMs) mStats.rateChanges++;
+        mStats.sentences = sentences;
+        mStats.periodMs = periodMs;
+        mStats.gsvEvery = GsvEvery(periodMs);
+        if (baud) mStats.baud = baud;
+        mStats.estimatedBps = Estimate(sentences, periodMs, mStats.gsvEvery);
+    }
+
+    /// @return Settings and bytes per second
+    const gps_output_stats_t &Stats() const { return mStats; }
+
+   private:
+    /// NMEA bytes per fix of GLL, RMC, VTG, GGA, GSA and a GSV group, CR LF included
+    static constexpr uint16_t kBytesPerFix[GPS_NMEA_SENTENCES] = {52, 72, 39, 75, 105, 320};
+
+    /// the shortest period from the ladder the module takes that is no shorter than want and fits the budget
+    uint16_t fitBudget(uint16_t want) const {
+        static const uint16_t kPeriods[] = {100, 200, 500, 1000, 2000, 5000, 10000};
+        if (!mPolicy.budgetBytesPerSec) return want;
+        for (uint16_t p : kPeriods)
+            if (p >= want && Estimate(mStats.sentences, p, GsvEvery(p)) <= mPolicy.budgetBytesPerSec) return p;
+        return kPeriods[sizeof(kPeriods) / sizeof(kPeriods[0]) - 1];
+    }
+
+    gps_rate_policy_t mPolicy = kGpsRatePolicyDefault;     ///< policy set last
+    gps_output_stats_t mStats = {0, 1, 1000, 0, 0, 0, 0};  ///< settings and bytes per second
+    uint32_t mWindowMs = 0;                                ///< GPS time of day the byte count started
+    std::atomic<uint32_t> mBytesIn{0};                     ///< bytes counted, written by Count() alone
+    uint32_t mWindowBytes = 0;                             ///< mBytesIn at mWindowMs
+    uint16_t mCandidate = 0;                               ///< slower period being held for
+    uint8_t mHold = 0;                                     ///< epochs mCandidate has been called for
+    bool mWindowStarted = false;                           ///< mWindowMs is set
+    bool mAdaptive = false;                                ///< a policy is set
+};
+
+#endif
@@ -0,0 +1,222 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PMTK_QUEUE_HPP_
+#define PMTK_QUEUE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+/// outcome of a queued PMTK command, the first four are the flag of its $PMTK001 acknowledgement
+typedef enum {
+    PMTK_RESULT_INVALID = 0,      ///< the module did not recognise the command
+    PMTK_RESULT_UNSUPPORTED = 1,  ///< the module does not support the command
+    PMTK_RESULT_FAILED = 2,       ///< valid command, but the action failed
+    PMTK_RESULT_SUCCESS = 3,      ///< valid command and the action succeeded, or sent if no ACK is expected
+    PMTK_RESULT_QUEUED,           ///< waiting behind other commands
+    PMTK_RESULT_SENT,             ///< sent, waiting for the acknowledgement
+    PMTK_RESULT_TIMEOUT,          ///< no acknowledgement after every retry
+    PMTK_RESULT_UNKNOWN           ///< not a ticket, or so old that its slot was reused
+} pmtk_result_t;
+
+/// run once when a queued command completes, from the context that services the queue
+typedef void (*pmtk_done_cb_t)(uint16_t ticket, pmtk_result_t result, void *ctx);
+
+/*!
+    @brief Queue of PMTK commands that are sent one at a time and matched to their $PMTK001,<cmd>,<flag>
+    acknowledgements, with a retry when the acknowledgement does not come in time.
+
+    Only one command is in flight at once, so an acknowledgement always belongs to the oldest one. Commands that
+    are not $PMTKnnn, e.g. $PGCMD, get no acknowledgement and complete as soon as they are sent.
+
+    Single producer / single consumer: the application queues with Push() and only stores mHead, the receive side
+    (Poll(), ReadData()) calls Due() and Acknowledge() and only stores mTail. A completed slot keeps its result for
+    Result() until Slots more commands have been queued.
+*/
+template <size_t Slots, size_t CommandSize>
+class PmtkQueue {
+    static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "PmtkQueue slot count must be a power of two");
+    static_assert(Slots <= 0x80, "PmtkQueue slot count must fit an 8 bit index");
+    static_assert(CommandSize >= 16 && CommandSize <= 0xFF, "PmtkQueue commands are 16 to 255 bytes");
+
+   public:
+    /*!
+        @param timeoutMs How long to wait for an acknowledgement before sending again
+        @param retries How many times to send again before giving up
+    */
+    PmtkQueue(uint16_t timeoutMs, uint8_t retries) : mTimeoutMs(timeoutMs), mRetries(retries) {}
+
+    /*!
+        @brief Queue a command. Any checksum it has is replaced, and "*hh" and CR LF are added.
+        @param command The command, e.g. PMTK_SET_NMEA_UPDATE_5HZ or "$PMTK220,200"
+        @param done Optional callback run when the command completes
+        @param ctx Opaque pointer passed through to done
+        @return Ticket for Result(), 0 if the queue is full or the command too long
+    */
+    uint16_t Push(const char *command, pmtk_done_cb_t done = nullptr, void *ctx = nullptr) {
+        static const char kHex[] = "0123456789ABCDEF";
+        const uint8_t head = mHead.load(std::memory_order_relaxed);
+        if ((uint8_t)(head - mTail.load(std::memory_order_acquire)) >= Slots || command[0] != '$') return 0;
+        const size_t len = strcspn(command, "*\r\n");
+        if (len + 5 >= CommandSize) return 0;  // room for *hh, CR LF and the 0
+        Slot &slot = mSlots[head & kMask];
+        uint8_t sum = 0;
+        for (size_t i = 1; i < len; i++) sum ^= (uint8_t)command[i];
+        memcpy(slot.text, command, len);
+        memcpy(slot.text + len, "*hh\r\n", 6);
+        slot.text[len + 1] = kHex[sum >> 4];
+        slot.text[len + 2] = kHex[sum & 0xF];
+        slot.len = (uint8_t)(len + 5);
+        slot.ackId = kNoAck;
+        if (!strncmp(command, "$PMTK", 5) && command[5] >= '0' && command[5] <= '9') {
+            slot.ackId = 0;  // PMTK_TEST is acknowledged as command 0
+            for (const char *p = command + 5; *p >= '0' && *p <= '9'; p++) slot.ackId = slot.ackId * 10 + (*p - '0');
+        }
+        if (++mNextTicket == 0) mNextTicket = 1;
+        slot.ticket = mNextTicket;
+        slot.tries = 0;
+        slot.done = done;
+        slot.ctx = ctx;
+        slot.result.store(PMTK_RESULT_QUEUED, std::memory_order_relaxed);
+        mHead.store(head + 1, std::memory_order_release);
+        return slot.ticket;
+    }
+
+    /*!
+        @brief Find what should go out now: the next command once the one in flight is done with, or the one in
+        flight again if its acknowledgement is late. Completes commands that expect no acknowledgement and those out
+        of retries on the way.
+        @param nowMs millis()
+        @param len Set to the length of the command
+        @return The command to send, not terminated, or NULL if nothing is due
+    */
+    const char *Due(uint32_t nowMs, size_t *len) {
+        uint8_t tail;
+        while ((tail = mTail.load(std::memory_order_relaxed)) != mHead.load(std::memory_order_acquire)) {
+            Slot &slot = mSlots[tail & kMask];
+            if (slot.tries > 0) {
+                if (slot.ackId == kNoAck) {
+                    complete(slot, PMTK_RESULT_SUCCESS);
+                    continue;
+                }
+                if (nowMs - slot.sentMs < mTimeoutMs) return NULL;  // still waiting
+                if (slot.tries > mRetries) {
+                    complete(slot, PMTK_RESULT_TIMEOUT);
+                    continue;
+                }
+            }
+            slot.tries++;
+            slot.sentMs = nowMs;
+            slot.result.store(PMTK_RESULT_SENT, std::memory_order_relaxed);
+            *len = slot.len;
+            return slot.text;
+        }
+        return NULL;
+    }
+
+    /*!
+        @brief Match a received sentence against the command in flight
+        @param line A complete sentence
+        @return true if it acknowledged the command in flight, which is now complete
+    */
+    bool Acknowledge(const char *line) {
+        const uint8_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire) || strncmp(line, "$PMTK001,", 9)) return false;
+        Slot &slot = mSlots[tail & kMask];
+        if (slot.tries == 0 || slot.ackId == kNoAck) return false;
+        uint16_t id = 0;
+        const char *p = line + 9;
+        for (; *p >= '0' && *p <= '9'; p++) id = id * 10 + (*p - '0');
+        if (id != slot.ackId || p[0] != ',' || p[1] < '0' || p[1] > '3') return false;
+        complete(slot, (pmtk_result_t)(p[1] - '0'));
+        return true;
+    }
+
+    /*!
+        @brief The answer to the command in flight is still arriving, e.g. a long dump, so restart its timeout
+        @param nowMs millis()
+    */
+    void Touch(uint32_t nowMs) {
+        const uint8_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail != mHead.load(std::memory_order_acquire)) mSlots[tail & kMask].sentMs = nowMs;
+    }
+
+    /*!
+        @brief Where a queued command has got to
+        @param ticket From Push()
+        @return PMTK_RESULT_QUEUED or PMTK_RESULT_SENT while pending, then how it completed
+    */
+    pmtk_result_t Result(uint16_t ticket) const {
+        for (const Slot &slot : mSlots)
+            if (ticket && slot.ticket == ticket) return slot.result.load(std::memory_order_relaxed);
+        return PMTK_RESULT_UNKNOWN;
+    }
+
+    /// @return Number of commands queued or in flight
+    size_t Size() const {
+        return (uint8_t)(mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire));
+    }
+    /// @return true if no command is queued or in flight
+    bool Empty() const { return Size() == 0; }
+
+    /*!
+        @brief Change how long to wait for an acknowledgement, for the commands after the one in flight
+        @param timeoutMs How long to wait before sending again
+        @param retries How many times to send again before giving up
+    */
+    void SetTimeout(uint16_t timeoutMs, uint8_t retries) {
+        mTimeoutMs = timeoutMs;
+        mRetries = retries;
+    }
+
+   private:
+    static constexpr uint8_t kMask = Slots - 1;
+    static constexpr uint16_t kNoAck = 0xFFFF;  ///< ackId of a command nothing acknowledges
+
+    struct Slot {
+        char text[CommandSize];                                  ///< command with checksum and CR LF, not terminated
+        uint8_t len = 0;                                         ///< characters in text
+        uint8_t tries = 0;                                       ///< times sent so far
+        uint16_t ackId = kNoAck;                                 ///< PMTK number the acknowledgement names
+        uint16_t ticket = 0;                                     ///< handed out by Push(), 0 for a slot never used
+        uint32_t sentMs = 0;                                     ///< millis() of the last send
+        pmtk_done_cb_t done = nullptr;                           ///< run on completion
+        void *ctx = nullptr;                                     ///< passed to done
+        std::atomic<pmtk_result_t> result{PMTK_RESULT_UNKNOWN};  ///< how far the command has got
+    };
+
+    void complete(Slot &slot, pmtk_result_t result) {
+        const pmtk_done_cb_t done = slot.done;  // the producer may refill the slot once mTail moves on
+        const uint16_t ticket = slot.ticket;
+        void *ctx = slot.ctx;
+        slot.result.store(result, std::memory_order_relaxed);
+        mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        if (done) done(ticket, result, ctx);  // may queue another command
+    }
+
+    Slot mSlots[Slots];
+    std::atomic<uint8_t> mHead{0};  ///< next slot to fill, owned by the producer
+    std::atomic<uint8_t> mTail{0};  ///< command in flight or next to send, owned by the consumer
+    uint16_t mNextTicket = 0;       ///< last ticket handed out, owned by the producer
+    uint16_t mTimeoutMs;            ///< acknowledgement timeout
+    uint8_t mRetries;               ///< sends after the first before giving up
+};
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_BUFFER_HPP_
+#define RING_BUFFER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+/*!
+    @brief Single producer / single consumer ring buffer with a power of two capacity.
+
+    The producer only ever stores mHead and the consumer only ever stores mTail, so one side may live in an
+    interrupt handler or on the other core without a lock. Indices run freely and are masked on access, which
+    keeps every slot usable and makes Size() a single subtraction. Only plain atomic loads and stores are used,
+    so it stays lock-free on the Cortex-M0+ which has no exclusive access instructions.
+*/
+template <typename T, size_t N>
+class RingBuffer {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+    static_assert(N <= 0x8000, "RingBuffer capacity must fit a 16 bit index");
+
+   public:
+    /*!
+        @brief Append one element
+        @param aValue Element to store
+        @return false if the buffer is full
+    */
+    bool Push(const T &aValue) {
+        const uint16_t head = mHead.load(std::memory_order_relaxed);
+        if ((uint16_t)(head - mTail.load(std::memory_order_acquire)) >= N) return false;
+        mData[head & kMask] = aValue;
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        @brief Append up to aLen elements in one step
+        @param aSrc Elements to store
+        @param aLen Number of elements offered
+        @return Number of elements actually stored
+    */
+    size_t Write(const T *aSrc, size_t aLen) {
+        const uint16_t head = mHead.load(std::memory_order_relaxed);
+        const size_t space = N - (uint16_t)(head - mTail.load(std::memory_order_acquire));
+        if (aLen > space) aLen = space;
+        for (size_t i = 0; i < aLen; i++) mData[(head + i) & kMask] = aSrc[i];
+        mHead.store(head + aLen, std::memory_order_release);
+        return aLen;
+    }
+
+    /*!
+        @brief Remove the oldest element
+        @param aValue Filled with the element
+        @return false if the buffer is empty
+    */
+    bool Pop(T &aValue) {
+        const uint16_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire)) return false;
+        aValue = mData[tail & kMask];
+        mTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+        @brief Remove up to aLen of the oldest elements in one step
+        @param aDst Buffer to copy the elements to
+        @param aLen Capacity of aDst
+        @return Number of elements copied
+    */
+    size_t Read(T *aDst, size_t aLen) {
+        const uint16_t tail = mTail.load(std::memory_order_relaxed);
+        const size_t used = (uint16_t)(mHead.load(std::memory_order_acquire) - tail);
+        if (aLen > used) aLen = used;
+        for (size_t i = 0; i < aLen; i++) aDst[i] = mData[(tail + i) & kMask];
+        mTail.store(tail + aLen, std::memory_order_release);
+        return aLen;
+    }
+
+    /// @return Number of elements waiting to be read
+    size_t Size() const {
+        return (uint16_t)(mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire));
+    }
+    /// @return Number of elements that can still be written
+    size_t Free() const { return N - Size(); }
+    /// @return true if nothing is waiting to be read
+    bool Empty() const { return Size() == 0; }
+    /// @return Total number of slots
+    static constexpr size_t Capacity() { return N; }
+
+    /*!
+        @brief Drop everything in the buffer. Only safe from the consumer side.
+    */
+    void Clear() { mTail.store(mHead.load(std::memory_order_acquire), std::memory_order_release); }
+
+   private:
+    static constexpr uint16_t kMask = N - 1;
+
+    T mData[N];
+    std::atomic<uint16_t> mHead{0};  ///< next slot to write, owned by the producer
+    std::atomic<uint16_t> mTail{0};  ///< next slot to read, owned by the consumer
+};
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SATELLITE_TABLE_HPP_
+#define SATELLITE_TABLE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/// constellations kept apart in the satellite table, rows of its arrays
+typedef enum : uint8_t {
+    NMEA_SAT_GPS = 0,      ///< GP talker, and GN PRNs outside the GLONASS range (GPS 1-32, SBAS 33-64)
+    NMEA_SAT_GLONASS = 1,  ///< GL talker, and GN PRNs 65-96
+    NMEA_SAT_GALILEO = 2,  ///< GA talker
+    NMEA_SAT_SYSTEMS = 3   ///< number of rows
+} nmea_sat_system_t;
+
+#define NMEA_SAT_NO_ELEVATION -128  ///< elevation field was empty
+#define NMEA_SAT_NO_AZIMUTH 0xFFFF  ///< azimuth field was empty
+#define NMEA_SAT_GLONASS_FIRST 65   ///< lowest PRN a GN talker uses for GLONASS
+#define NMEA_SAT_GLONASS_LAST 96    ///< highest PRN a GN talker uses for GLONASS
+
+/*!
+    @brief Satellites in view per constellation, laid out as one array per attribute so that a scan over e.g. the
+    SNR of every satellite touches a single cache line. Row s holds count[s] satellites of constellation s.
+*/
+template <size_t PerSystem>
+struct SatelliteSet {
+    static_assert(PerSystem > 0 && PerSystem <= 0xFF, "SatelliteSet rows are counted in 8 bits");
+
+    uint32_t generation;                            ///< bumped every time a row is replaced
+    uint32_t timeMs[NMEA_SAT_SYSTEMS];              ///< time of day of the epoch each row was completed in
+    uint8_t inView[NMEA_SAT_SYSTEMS];               ///< satellites in view as reported, may exceed count
+    uint8_t count[NMEA_SAT_SYSTEMS];                ///< satellites stored in the row
+    uint8_t prn[NMEA_SAT_SYSTEMS][PerSystem];       ///< satellite ID
+    int8_t elevation[NMEA_SAT_SYSTEMS][PerSystem];  ///< degrees above the horizon, NMEA_SAT_NO_ELEVATION if empty
+    uint16_t azimuth[NMEA_SAT_SYSTEMS][PerSystem];  ///< degrees from true north, NMEA_SAT_NO_AZIMUTH if empty
+    uint8_t snr[NMEA_SAT_SYSTEMS][PerSystem];       ///< carrier to noise in dB-Hz, 0 when not tracked
+
+    /*!
+        @brief Find a satellite
+        @param system Constellation
+        @param id PRN as reported
+        @return Index into the row, or -1 if the satellite is not in view
+    */
+    int Find(nmea_sat_system_t system, uint8_t id) const {
+        for (uint8_t i = 0; i < count[system]; i++)
+            if (prn[system][i] == id) return i;
+        return -1;
+    }
+
+    /// @return Satellites stored over all constellations
+    uint8_t Total() const {
+        uint8_t n = 0;
+        for (uint8_t s = 0; s < NMEA_SAT_SYSTEMS; s++) n += count[s];
+        return n;
+    }
+};
+
+/*!
+    @brief Assembles multi sentence GSV groups into a SatelliteSet without touching the heap.
+
+    Every GSV sentence is written straight into a pending copy of the rows it belongs to. The published rows are
+    only replaced when the last sentence of a group arrives with none missing, so Snapshot() always returns whole
+    groups, never half of one cycle and half of the next. Groups are tracked per talker, a GN group may fill
+    several rows, which it tells apart by PRN.
+*/
+template <size_t PerSystem>
+class SatelliteTable {
+   public:
+    typedef SatelliteSet<PerSystem> Set;  ///< what Snapshot() copies out
+
+    SatelliteTable() { Clear(); }
+
+    /// forget every satellite
+    void Clear() {
+        memset(&mPublished, 0, sizeof(mPublished));
+        memset(&mPending, 0, sizeof(mPending));
+        memset(mGroups, 0, sizeof(mGroups));
+    }
+
+    /*!
+        @brief Start or continue a group, call once per GSV sentence before its satellites
+        @param talker Two letter source of the sentence, GP, GL, GA or GN
+        @param total Number of sentences in the group
+        @param number Number of this sentence, from 1
+        @param inView Satellites in view field
+        @return false if the talker is not tracked or the sentence is out of sequence
+    */
+    bool Begin(const char *talker, uint8_t total, uint8_t number, uint8_t inView) {
+        mCurrent = groupOf(talker);
+        if (mCurrent < 0) return false;
+        Group &g = mGroups[mCurrent];
+        if (number == 1) {
+            g.next = 1;
+            g.rows = 0;
+            if (mCurrent == kGroupGN) {
+                for (uint8_t s = 0; s < NMEA_SAT_SYSTEMS; s++) resetPending((nmea_sat_system_t)s);
+            } else {
+                resetPending((nmea_sat_system_t)mCurrent);
+                g.rows = 1 << mCurrent;  // a single constellation group replaces its row even when empty
+                mPending.inView[mCurrent] = inView;
+            }
+        }
+        if (total == 0 || number != g.next || number > total) {
+            g.next = 0;  // wait for the start of the next group
+            mCurrent = -1;
+            return false;
+        }
+        g.next++;
+        g.last = number == total;
+        return true;
+    }
+
+    /*!
+        @brief Add one satellite of the sentence passed to Begin()
+        @param id PRN
+        @param elevation Degrees, or NMEA_SAT_NO_ELEVATION
+        @param azimuth Degrees, or NMEA_SAT_NO_AZIMUTH
+        @param snr dB-Hz, 0 if not tracked
+    */
+    void Add(uint8_t id, int8_t elevation, uint16_t azimuth, uint8_t snr) {
+        if (mCurrent < 0 || id == 0) return;
+        nmea_sat_system_t s = (nmea_sat_system_t)mCurrent;
+        if (mCurrent == kGroupGN) {
+            s = (id >= NMEA_SAT_GLONASS_FIRST && id <= NMEA_SAT_GLONASS_LAST) ? NMEA_SAT_GLONASS : NMEA_SAT_GPS;
+            mGroups[mCurrent].rows |= 1 << s;
+            mPending.inView[s]++;  // GN reports one total over every constellation, count per row instead
+        }
+        uint8_t &n = mPending.count[s];
+        if (n >= PerSystem) return;
+        mPending.prn[s][n] = id;
+        mPending.elevation[s][n] = elevation;
+        mPending.azimuth[s][n] = azimuth;
+        mPending.snr[s][n] = snr;
+        n++;
+    }
+
+    /*!
+        @brief Finish the sentence passed to Begin(), publishing the group if it was the last one
+        @param timeMs Time of day of the current epoch, stored with the published rows
+        @return true if rows were published
+    */
+    bool End(uint32_t timeMs) {
+        if (mCurrent < 0) return false;
+        Group &g = mGroups[mCurrent];
+        mCurrent = -1;
+        if (!g.last) return false;
+        g.next = 0;
+        if (!g.rows) return false;
+        for (uint8_t s = 0; s < NMEA_SAT_SYSTEMS; s++) {
+            if (!(g.rows & (1 << s))) continue;
+            mPublished.timeMs[s] = timeMs;
+            mPublished.inView[s] = mPending.inView[s];
+            mPublished.count[s] = mPending.count[s];
+            memcpy(mPublished.prn[s], mPending.prn[s], sizeof(mPending.prn[s]));
+            memcpy(mPublished.elevation[s], mPending.elevation[s], sizeof(mPending.elevation[s]));
+            memcpy(mPublished.azimuth[s], mPending.azimuth[s], sizeof(mPending.azimuth[s]));
+            memcpy(mPublished.snr[s], mPending.snr[s], sizeof(mPending.snr[s]));
+        }
+        mPublished.generation++;
+        return true;
+    }
+
+    /*!
+        @brief Copy the satellites of the last complete groups
+        @param out Filled with the published rows
+    */
+    void Snapshot(Set *out) const { memcpy(out, &mPublished, sizeof(mPublished)); }
+
+    /// @return The published rows, valid until the next End()
+    const Set &Published() const { return mPublished; }
+
+    /// @return Number of times rows were published, to spot a new snapshot without copying it
+    uint32_t Generation() const { return mPublished.generation; }
+
+   private:
+    static constexpr int8_t kGroupGN = NMEA_SAT_SYSTEMS;  ///< GN groups come after one per constellation
+
+    /// state of the group a talker is sending
+    struct Group {
+        uint8_t next;  ///< number of the sentence expected next, 0 to wait for a new group
+        uint8_t rows;  ///< bit per constellation row the group wrote to
+        bool last;     ///< the sentence being added is the last of the group
+    };
+
+    static int8_t groupOf(const char *talker) {
+        if (talker[0] != 'G') return -1;
+        switch (talker[1]) {
+            case 'P':
+                return NMEA_SAT_GPS;
+            case 'L':
+                return NMEA_SAT_GLONASS;
+            case 'A':
+                return NMEA_SAT_GALILEO;
+            case 'N':
+                return kGroupGN;
+        }
+        return -1;
+    }
+
+    void resetPending(nmea_sat_system_t s) {
+        mPending.count[s] = 0;
+        mPending.inView[s] = 0;
+    }
+
+    Set mPublished;                       ///< rows of the last complete groups
+    Set mPending;                         ///< rows of the groups being received
+    Group mGroups[NMEA_SAT_SYSTEMS + 1];  ///< one per constellation talker, then GN
+    int8_t mCurrent = -1;                 ///< group of the sentence between Begin() and End()
+};
+
+#endif
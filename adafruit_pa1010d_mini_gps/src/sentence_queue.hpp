@@ -0,0 +1,121 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SENTENCE_QUEUE_HPP_
+#define SENTENCE_QUEUE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+/// when a sentence was read, both 0 if not known
+typedef struct {
+    uint64_t firstUs;  ///< time_us_64() when its first byte was read
+    uint64_t lastUs;   ///< time_us_64() when its last byte was read
+} nmea_stamp_t;
+
+/*!
+    @brief Fixed slot queue of complete NMEA sentences between the receive side and the application.
+
+    Single producer / single consumer: the producer (ReadData(), Poll(), an IRQ handler or core 1) only stores
+    mHead and the statistics, the consumer (TryPop() on core 0) only stores mTail. A full queue drops the
+    incoming sentence rather than overwriting one the consumer may be reading, and counts it.
+*/
+template <size_t Slots, size_t SlotSize>
+class SentenceQueue {
+    static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "SentenceQueue slot count must be a power of two");
+    static_assert(Slots <= 0x80, "SentenceQueue slot count must fit an 8 bit index");
+    static_assert(SlotSize <= 0xFF, "SentenceQueue slots are limited to 255 bytes");
+
+   public:
+    /*!
+        @brief Copy a finished sentence into the next free slot
+        @param aLine Pointer to the sentence, need not be terminated
+        @param aLen Length of the sentence, truncated to SlotSize - 1
+        @param aStamp When the sentence was read
+        @return false if the queue was full and the sentence was dropped
+    */
+    bool Push(const char *aLine, size_t aLen, const nmea_stamp_t &aStamp = nmea_stamp_t{}) {
+        const uint8_t head = mHead.load(std::memory_order_relaxed);
+        const uint8_t used = head - mTail.load(std::memory_order_acquire);
+        if (used >= Slots) {
+            mDropped.store(mDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+        if (aLen > SlotSize - 1) aLen = SlotSize - 1;
+        Slot &slot = mSlots[head & kMask];
+        memcpy(slot.data, aLine, aLen);
+        slot.data[aLen] = 0;
+        slot.len = aLen;
+        slot.stamp = aStamp;
+        mHead.store(head + 1, std::memory_order_release);
+        if (used + 1 > mHighWater.load(std::memory_order_relaxed))
+            mHighWater.store(used + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /*!
+        @brief Copy the oldest sentence out and free its slot
+        @param aBuff Buffer for the terminated sentence
+        @param aSize Capacity of aBuff, the sentence is truncated to fit
+        @param aStamp Filled with when the sentence was read, if not NULL
+        @return Length of the sentence copied, 0 if the queue was empty
+    */
+    size_t TryPop(char *aBuff, size_t aSize, nmea_stamp_t *aStamp = nullptr) {
+        const uint8_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire) || aSize == 0) return 0;
+        const Slot &slot = mSlots[tail & kMask];
+        size_t len = slot.len < aSize - 1 ? slot.len : aSize - 1;
+        memcpy(aBuff, slot.data, len);
+        aBuff[len] = 0;
+        if (aStamp) *aStamp = slot.stamp;
+        mTail.store(tail + 1, std::memory_order_release);
+        return len;
+    }
+
+    /// @return Number of sentences waiting
+    size_t Size() const {
+        return (uint8_t)(mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire));
+    }
+    /// @return true if no sentence is waiting
+    bool Empty() const { return Size() == 0; }
+    /// @return Number of sentences dropped because the queue was full
+    uint32_t Dropped() const { return mDropped.load(std::memory_order_relaxed); }
+    /// @return Largest number of sentences that were ever waiting at once
+    uint8_t HighWater() const { return mHighWater.load(std::memory_order_relaxed); }
+    /// @return Number of slots
+    static constexpr size_t Capacity() { return Slots; }
+
+   private:
+    static constexpr uint8_t kMask = Slots - 1;
+
+    struct Slot {
+        nmea_stamp_t stamp;
+        uint8_t len;
+        char data[SlotSize];
+    };
+
+    Slot mSlots[Slots];
+    std::atomic<uint8_t> mHead{0};       ///< next slot to fill, owned by the producer
+    std::atomic<uint8_t> mTail{0};       ///< next slot to drain, owned by the consumer
+    std::atomic<uint32_t> mDropped{0};   ///< written by the producer only
+    std::atomic<uint8_t> mHighWater{0};  ///< written by the producer only
+};
+
+#endif
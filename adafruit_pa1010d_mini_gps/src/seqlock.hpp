@@ -0,0 +1,76 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEQLOCK_HPP_
+#define SEQLOCK_HPP_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#define SEQLOCK_READ_TRIES 64  ///< attempts Read() makes before giving up on a writer that keeps publishing
+
+/*!
+    @brief Single writer, many reader publication of a plain struct without locks.
+
+    The writer makes the sequence odd, copies the value in and makes it even again. A reader copies the value
+    between two loads of the sequence and keeps the copy only if both loads are the same even number, so it can
+    never see half of one value and half of the next. Readers never block the writer, which makes this safe to
+    read from the other core or from a lower priority context while Parse() keeps publishing.
+*/
+template <typename T>
+class Seqlock {
+   public:
+    /*!
+        @brief Publish a new value, only ever call from one context
+        @param aValue Value to copy in
+    */
+    void Write(const T &aValue) {
+        const uint32_t seq = mSeq.load(std::memory_order_relaxed);
+        mSeq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy((void *)&mValue, &aValue, sizeof(T));
+        mSeq.store(seq + 2, std::memory_order_release);
+    }
+
+    /*!
+        @brief Copy the last published value out
+        @param aOut Filled with the value, left unspecified on failure
+        @return false if nothing was published yet or the writer kept publishing for SEQLOCK_READ_TRIES attempts
+    */
+    bool Read(T *aOut) const {
+        for (uint8_t tries = 0; tries < SEQLOCK_READ_TRIES; tries++) {
+            const uint32_t before = mSeq.load(std::memory_order_acquire);
+            if (before == 0) return false;
+            if (before & 1) continue;
+            memcpy(aOut, (const void *)&mValue, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (mSeq.load(std::memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+
+    /// @return Number of values published so far
+    uint32_t Published() const { return mSeq.load(std::memory_order_acquire) / 2; }
+
+   private:
+    std::atomic<uint32_t> mSeq{0};  ///< odd while a write is in progress, twice the number of writes otherwise
+    volatile T mValue{};            ///< the value, only copied with memcpy
+};
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ *   This file is part of embedded software pico playground project.
+ *
+ *   embedded software pico playground projec is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   embedded software pico playground project is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License v3.0
+ *   along with embedded software pico playground project.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SMOOTHING_HPP_
+#define SMOOTHING_HPP_
+
+#include <stdint.h>
+
+#include "NMEA_data.hpp"
+
+#ifndef NMEA_MEDIAN_MAX
+#define NMEA_MEDIAN_MAX 5  ///< most raw values a median filter keeps
+#endif
+
+#define NMEA_WEIGHT_ONE 65536  ///< Q16 weight that takes the new value as it is
+
+/// state of an alpha-beta or median filter, only the data values that use one get a block
+typedef struct {
+    uint8_t owner;  ///< mVal[] slot using the block, NMEA_UNTRACKED when free
+    uint8_t n;      ///< median of this many values
+    uint8_t head;   ///< where the next raw value goes in window
+    uint8_t count;  ///< raw values in window so far
+    union {
+        nmea_float_t rate;                     ///< alpha-beta, change per ms
+        nmea_float_t window[NMEA_MEDIAN_MAX];  ///< median, the last raw values
+    };
+} nmea_filter_state_t;
+
+namespace smoothing {
+/// exp(x) by its Taylor series, only used to build the table
+constexpr double Exp(double x) {
+    double term = 1, sum = 1;
+    for (int n = 1; n < 40; n++) {
+        term *= x / n;
+        sum += term;
+    }
+    return sum;
+}
+
+/// 1 - exp(-x) in Q16 for x from 0 to 8 in steps of 1/32, past that the weight is 1
+struct WeightTable {
+    uint16_t w[257];
+};
+
+constexpr WeightTable BuildWeights() {
+    WeightTable t{};
+    for (int i = 0; i <= 256; i++) t.w[i] = (uint16_t)((1 - 1 / Exp(i / 32.0)) * NMEA_WEIGHT_ONE + 0.5);
+    return t;
+}
+
+inline constexpr WeightTable kWeights = BuildWeights();
+}  // namespace smoothing
+
+/*!
+    @brief Weight of a new value in an exponential moving average, 1 - exp(-dt / response), with integers only
+    @param dtMs Time since the previous value
+    @param response Time constant in ms
+    @param decay NmeaDecayFor(response)
+    @return Weight in Q16, 0 to NMEA_WEIGHT_ONE
+*/
+inline uint32_t NmeaSmoothingWeight(uint32_t dtMs, uint16_t response, uint16_t decay) {
+    if (dtMs >= (uint32_t)response << 3) return NMEA_WEIGHT_ONE;  // exp(-8) is below the table resolution
+    const uint32_t pos = dtMs * decay;  // dt / response in Q20, less than 1 << 23 here
+    const uint32_t i = pos >> 15;
+    if (i >= 256) return smoothing::kWeights.w[256];
+    const uint32_t step = smoothing::kWeights.w[i + 1] - smoothing::kWeights.w[i];  // the table only rises
+    return smoothing::kWeights.w[i] + ((step * (pos & 0x7FFF)) >> 15);
+}
+
+/*!
+    @brief One alpha-beta filter step: predict from the tracked rate, then correct both by the residual
+    @param st Filter state
+    @param smoothed Previous output
+    @param v New raw value
+    @param w Weight from NmeaSmoothingWeight(), alpha in Q16, beta follows as alpha^2 / (2 - alpha)
+    @param dtMs Time since the previous value
+    @return New output
+*/
+inline nmea_float_t NmeaAlphaBeta(nmea_filter_state_t *st, nmea_float_t smoothed, nmea_float_t v, uint32_t w,
+                                  uint32_t dtMs) {
+    if (w >= NMEA_WEIGHT_ONE) {  // first value, or so long ago that the old trend means nothing
+        st->rate = 0;
+        return v;
+    }
+    if (dtMs == 0) return smoothed;
+    const nmea_float_t alpha = w * (1.0f / NMEA_WEIGHT_ONE);
+    const nmea_float_t predicted = smoothed + st->rate * dtMs;
+    const nmea_float_t residual = v - predicted;
+    st->rate += alpha * alpha / (2 - alpha) * residual / dtMs;
+    return predicted + alpha * residual;
+}
+
+/*!
+    @brief Add a raw value to a median filter
+    @param st Filter state
+    @param v New raw value
+    @return Median of the last st->n values, or of all of them until there are that many
+*/
+inline nmea_float_t NmeaMedian(nmea_filter_state_t *st, nmea_float_t v) {
+    st->window[st->head] = v;
+    st->head = st->head + 1 < st->n ? st->head + 1 : 0;
+    if (st->count < st->n) st->count++;
+    nmea_float_t sorted[NMEA_MEDIAN_MAX];
+    for (uint8_t i = 0; i < st->count; i++) {  // insertion sort, never more than NMEA_MEDIAN_MAX values
+        nmea_float_t x = st->window[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > x; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = x;
+    }
+    return sorted[st->count / 2];
+}
+
+#endif
@@ -1,6 +1,9 @@
 #include "flash_manager.hpp"
 
+#include <inttypes.h>
+
 #include "hardware/flash.h"
+#include "pico/flash.h"
 // #define FLASH_TOTAL_SIZE (16 * 1024 * 1024)  // 16MB flash
 // #define SAFE_FLASH_OFFSET (4 * 1024 * 1024)  // 4MB offset to stay safe
 #define STR_HELPER(x) #x
@@ -26,10 +29,37 @@
 #define STR_HELPER(x) #x
 #define STR(x) STR_HELPER(x)
 
-void FlashManager::write_data(const uint8_t *data, size_t size) {
+#ifndef FLASH_SAFE_TIMEOUT_MS
+#define FLASH_SAFE_TIMEOUT_MS 100  // how long write_data() waits for the other core to get out of flash
+#endif
+
+// Define FLASH_MANAGER_DEBUG to print the CRCs, offsets and raw contents of every read and write
+#ifdef FLASH_MANAGER_DEBUG
+#define FLASH_DEBUG(...) printf(__VA_ARGS__)
+#else
+#define FLASH_DEBUG(...)
+#endif
+
+namespace {
+struct flash_write_t {
+    uint32_t offset;
+    const uint8_t *page;
+};
+
+// runs through flash_safe_execute(), with interrupts off and the other core locked out of flash
+void erase_and_program(void *param) {
+    const flash_write_t *write = static_cast<const flash_write_t *>(param);
+    flash_range_erase(write->offset, FLASH_SECTOR_SIZE);
+    flash_range_program(write->offset, write->page, FLASH_PAGE_SIZE);
+}
+}  // namespace
+
+bool FlashManager::write_data(const uint8_t *data, size_t size) {
+    if (size + sizeof(uint32_t) > FLASH_PAGE_SIZE) return false;  // data and CRC have to fit one page
+
     // Calculate CRC32 of the data
     uint32_t crc_written = compute_crc32(data, size);
-    printf("CRC32 to write: 0x%08x\n", crc_written);
+    FLASH_DEBUG("CRC32 to write: 0x%08" PRIx32 "\n", crc_written);
 
     // Prepare flash page (data + crc)
     uint8_t buffer[FLASH_PAGE_SIZE];
@@ -37,44 +67,47 @@ void FlashManager::write_data(const uint8_t *data, size_t size) {
     memcpy(buffer, data, size);
     memcpy(buffer + size, &crc_written, sizeof(crc_written));  // Store CRC after data
 
-    // Erase sector
-    uint32_t interrupts = save_and_disable_interrupts();
-    flash_range_erase(SAFE_FLASH_OFFSET, FLASH_SECTOR_SIZE);
-    restore_interrupts(interrupts);
-
-    // Write page
-    interrupts = save_and_disable_interrupts();
-    flash_range_program(SAFE_FLASH_OFFSET, buffer, FLASH_PAGE_SIZE);
-    restore_interrupts(interrupts);
+    // Erase sector and write page, safe against code running from flash on the other core
+    flash_write_t write = {offset(), buffer};
+    if (flash_safe_execute(erase_and_program, &write, FLASH_SAFE_TIMEOUT_MS) != PICO_OK) {
+        FLASH_DEBUG("Flash write at offset 0x%08" PRIx32 " FAILED, the other core did not lock out.\n", offset());
+        return false;
+    }
 
-    printf("Data written to flash at offset 0x%08x.\n", SAFE_FLASH_OFFSET);
+    FLASH_DEBUG("Data written to flash at offset 0x%08" PRIx32 ".\n", offset());
+    return true;
 }
 
-void FlashManager::read_data(uint8_t *data, size_t size) {
-    const uint8_t *flash_memory = (const uint8_t *)(XIP_BASE + SAFE_FLASH_OFFSET);
+bool FlashManager::read_data(uint8_t *data, size_t size) {
+    const uint8_t *flash_memory = (const uint8_t *)(XIP_BASE + offset());
 
+#ifdef FLASH_MANAGER_DEBUG
     // Print raw flash contents
     printf("Data read from flash:\n");
     for (size_t i = 0; i < size; ++i) {
         printf("%02x ", flash_memory[i]);
     }
     printf("\n");
+#endif
 
     // Extract and validate CRC
     uint32_t read_crc;
     memcpy(&read_crc, flash_memory + size, sizeof(read_crc));
 
     uint32_t crc_read = compute_crc32(flash_memory, size);
-    printf("CRC32 read: 0x%08x\n", crc_read);
+    FLASH_DEBUG("CRC32 read: 0x%08" PRIx32 "\n", crc_read);
 
     if (crc_read == read_crc) {
         memcpy(data, flash_memory, size);
-        printf("✅ CRC check PASSED. Data integrity OK.\n");
-    } else {
-        printf("❌ CRC check FAILED. Data corrupted! NOT loading data.\n");
+        FLASH_DEBUG("✅ CRC check PASSED. Data integrity OK.\n");
+        return true;
     }
+    FLASH_DEBUG("❌ CRC check FAILED. Data corrupted! NOT loading data.\n");
+    return false;
 }
 
+uint32_t FlashManager::offset() const { return SAFE_FLASH_OFFSET + sector_ * FLASH_SECTOR_SIZE; }
+
 // Software CRC32 function
 uint32_t FlashManager::compute_crc32(const void *data, size_t length) {
     const uint8_t *bytes = (const uint8_t *)data;
@@ -11,10 +11,18 @@
 
 class FlashManager {
    public:
-    void write_data(const uint8_t *data, size_t size);
-    void read_data(uint8_t *data, size_t size);
+    // sector: which FLASH_SECTOR_SIZE sector after SAFE_FLASH_OFFSET to use, so that each user keeps its own
+    explicit FlashManager(uint32_t sector = 0) : sector_(sector) {}
+    // Erases the sector and writes data with its CRC through flash_safe_execute(). If the other core runs, it must
+    // have called flash_safe_execute_core_init() (or multicore_lockout_victim_init()). Returns false if data and
+    // CRC do not fit a page or the other core could not be locked out; call it outside interrupt handlers.
+    bool write_data(const uint8_t *data, size_t size);
+    bool read_data(uint8_t *data, size_t size);
 
    private:
     uint32_t compute_crc32(const void *data, size_t length);
+    uint32_t offset() const;
+
+    uint32_t sector_;
 };
 #endif
\ No newline at end of file